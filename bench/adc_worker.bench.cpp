@@ -0,0 +1,80 @@
+#include "bench.h"
+#include "fake_sysfs.h"
+#include "src/adc_worker.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    const auto CONSUMER_IDLE_DELAY = std::chrono::microseconds(100);
+
+    uint64_t GetMeasurementsCount(const TChannelGroup& group)
+    {
+        uint64_t res = 0;
+        for (const auto& channel : group.Channels) {
+            res += channel.Publisher.GetPublishedCount() + channel.Publisher.GetSuppressedCount();
+        }
+        return res;
+    }
+}
+
+void BenchAdcWorker(TBenchReport& report, const TBenchSettings& settings)
+{
+    WBMQTT::TLogger logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    for (auto channels : settings.ChannelCounts) {
+        TFakeSysfs sysfs(channels);
+        TStopEvent stopEvent;
+
+        // the publisher isn't started, its queue is drained by the consumer below instead of MQTT driver
+        TPublisher publisher(nullptr, nullptr, TPublisher::TSettings(), logger);
+
+        std::shared_ptr<TChannelGroup> group(new TChannelGroup());
+        group->SysfsIIODir = sysfs.GetIIODir();
+        for (uint32_t i = 0; i < channels; ++i) {
+            // no delay between readings, so the benchmark shows CPU cost of the cycle
+            group->Channels.push_back(TChannelDesc{"A" + std::to_string(i),
+                                                   false,
+                                                   {0.451660156,
+                                                    MAX_ADC_VALUE,
+                                                    sysfs.GetChannelSettings(i),
+                                                    0,
+                                                    logger,
+                                                    logger,
+                                                    group->SysfsIIODir,
+                                                    &stopEvent},
+                                                   std::chrono::milliseconds(0),
+                                                   TPublishPolicy(TPublishPolicy::TSettings())});
+        }
+        group->PublishQueue = publisher.CreateQueue();
+
+        // in-process stand-in for MQTT driver, it batches published values like TPublisher does
+        std::atomic<bool> consumerActive(true);
+        uint64_t          consumed = 0;
+        std::thread       consumer([&] {
+            TPublishBatch batch;
+            TPublishItem  item;
+            while (consumerActive || group->PublishQueue->Size()) {
+                while (group->PublishQueue->Pop(item)) {
+                    batch.Add(std::move(item));
+                    ++consumed;
+                }
+                batch.Clear();
+                std::this_thread::sleep_for(CONSUMER_IDLE_DELAY);
+            }
+        });
+
+        auto        start = std::chrono::steady_clock::now();
+        std::thread worker([&] { AdcWorker(stopEvent, group, logger, logger); });
+        std::this_thread::sleep_for(settings.MinDuration);
+        stopEvent.Set();
+        worker.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        consumerActive = false;
+        consumer.join();
+
+        report.Add("AdcWorker.Measurement", channels, GetMeasurementsCount(*group), elapsed.count());
+        report.Add("AdcWorker.Published", channels, consumed, elapsed.count());
+    }
+}
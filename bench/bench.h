@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+struct TBenchSettings
+{
+    //! Numbers of channels in generated fake sysfs trees and configs
+    std::vector<uint32_t> ChannelCounts = {1, 8, 64, 256};
+
+    //! Every benchmark runs at least the time
+    std::chrono::milliseconds MinDuration = std::chrono::milliseconds(200);
+
+    //! Config schema for LoadConfig benchmark
+    std::string SchemaFile = "data/wb-mqtt-adc.schema.json";
+
+    //! Recorded samples for sample history benchmark, lines "timestamp_us,raw_value".
+    //! If empty, a generated trace is used
+    std::string HistoryDataFile;
+};
+
+//! Results of all benchmarks in machine-readable form
+class TBenchReport
+{
+public:
+    TBenchReport();
+
+    /**
+     * @brief Add result of a benchmark
+     *
+     * @param name Name of the benchmark
+     * @param channels Number of channels used by the benchmark
+     * @param operations Number of performed operations
+     * @param seconds Time spent on the operations
+     */
+    void Add(const std::string& name, uint32_t channels, uint64_t operations, double seconds);
+
+    //! Add a value which is not a timing, e.g. compression ratio
+    void AddMetric(const std::string& name, const std::string& metric, double value);
+
+    const Json::Value& GetJson() const;
+
+private:
+    Json::Value Root;
+};
+
+/**
+ * @brief Call fn until settings.MinDuration is over and add results to report.
+ *
+ * @param fn Function returning number of performed operations
+ */
+template<class Fn>
+void RunBench(TBenchReport&         report,
+              const TBenchSettings& settings,
+              const std::string&    name,
+              uint32_t              channels,
+              Fn                    fn)
+{
+    uint64_t operations = 0;
+    auto     start      = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed;
+    do {
+        operations += fn();
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < settings.MinDuration);
+    report.Add(name, channels, operations, elapsed.count());
+}
+
+//! TChannelReader::Measure and ReadFromADC on fake sysfs
+void BenchSysfsAdc(TBenchReport& report, const TBenchSettings& settings);
+
+//! TMovingAverageCalculator::AddValue and GetFixedPointValue
+void BenchMovingAverage(TBenchReport& report, const TBenchSettings& settings);
+
+//! FindBestScale
+void BenchFindBestScale(TBenchReport& report, const TBenchSettings& settings);
+
+//! FormatDecimal compared with std::ostringstream
+void BenchValueFormat(TBenchReport& report, const TBenchSettings& settings);
+
+//! LoadConfig of generated configs
+void BenchConfig(TBenchReport& report, const TBenchSettings& settings);
+
+//! Full AdcWorker cycles on fake sysfs with in-process consumer of published values
+void BenchAdcWorker(TBenchReport& report, const TBenchSettings& settings);
+
+//! Size, encoding and decoding speed of TCompressedSampleStore compared with TSampleHistory
+void BenchCompressedHistory(TBenchReport& report, const TBenchSettings& settings);
+
+//! TExpression compilation and evaluation of one expression per channel
+void BenchExpression(TBenchReport& report, const TBenchSettings& settings);
+
+//! TSpectrumAnalyzer::Compute and Add for several FFT sizes
+void BenchSpectrum(TBenchReport& report, const TBenchSettings& settings);
@@ -0,0 +1,101 @@
+#include "bench.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+
+namespace
+{
+    const uint32_t MAX_CHANNELS = 256;
+
+    void PrintUsage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [options]" << std::endl
+                  << "Options:" << std::endl
+                  << "  --channels N[,N...]   numbers of channels in generated trees, 1-" << MAX_CHANNELS
+                  << " (default 1,8,64,256)" << std::endl
+                  << "  --min-duration-ms MS  minimum duration of every benchmark (default 200)" << std::endl
+                  << "  --schema FILE         config schema (default data/wb-mqtt-adc.schema.json)" << std::endl
+                  << "  --history-data FILE   recorded samples \"timestamp_us,raw_value\" per line for history"
+                  << " benchmark (default generated trace)" << std::endl
+                  << "  --output FILE         write JSON results to the file instead of stdout" << std::endl;
+    }
+
+    std::vector<uint32_t> ParseChannelCounts(const std::string& str)
+    {
+        std::vector<uint32_t> res;
+        std::istringstream    in(str);
+        std::string           item;
+        while (std::getline(in, item, ',')) {
+            unsigned long n = std::stoul(item);
+            if (n < 1 || n > MAX_CHANNELS) {
+                throw std::runtime_error("Number of channels must be from 1 to " + std::to_string(MAX_CHANNELS));
+            }
+            res.push_back(n);
+        }
+        return res;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    TBenchSettings settings;
+    std::string    outputFile;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (i + 1 == argc) {
+                PrintUsage(argv[0]);
+                return 2;
+            }
+            if (!strcmp(argv[i], "--channels")) {
+                settings.ChannelCounts = ParseChannelCounts(argv[++i]);
+            } else if (!strcmp(argv[i], "--min-duration-ms")) {
+                settings.MinDuration = std::chrono::milliseconds(std::stoul(argv[++i]));
+            } else if (!strcmp(argv[i], "--schema")) {
+                settings.SchemaFile = argv[++i];
+            } else if (!strcmp(argv[i], "--history-data")) {
+                settings.HistoryDataFile = argv[++i];
+            } else if (!strcmp(argv[i], "--output")) {
+                outputFile = argv[++i];
+            } else {
+                PrintUsage(argv[0]);
+                return 2;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    TBenchReport report;
+    try {
+        BenchSysfsAdc(report, settings);
+        BenchMovingAverage(report, settings);
+        BenchFindBestScale(report, settings);
+        BenchValueFormat(report, settings);
+        BenchConfig(report, settings);
+        BenchAdcWorker(report, settings);
+        BenchCompressedHistory(report, settings);
+        BenchExpression(report, settings);
+        BenchSpectrum(report, settings);
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    if (outputFile.empty()) {
+        std::cout << Json::writeString(builder, report.GetJson()) << std::endl;
+    } else {
+        std::ofstream out(outputFile);
+        out << Json::writeString(builder, report.GetJson()) << std::endl;
+        if (!out) {
+            std::cerr << "Can't write " << outputFile << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "bench.h"
+
+TBenchReport::TBenchReport()
+{
+    Root["benchmarks"] = Json::arrayValue;
+    Root["metrics"]    = Json::arrayValue;
+}
+
+void TBenchReport::Add(const std::string& name, uint32_t channels, uint64_t operations, double seconds)
+{
+    Json::Value res;
+    res["name"]       = name;
+    res["channels"]   = channels;
+    res["operations"] = Json::UInt64(operations);
+    res["seconds"]    = seconds;
+    res["ns_per_op"]  = operations ? seconds * 1e9 / operations : 0.0;
+    res["ops_per_s"]  = seconds > 0 ? operations / seconds : 0.0;
+    Root["benchmarks"].append(res);
+}
+
+void TBenchReport::AddMetric(const std::string& name, const std::string& metric, double value)
+{
+    Json::Value res;
+    res["name"]   = name;
+    res["metric"] = metric;
+    res["value"]  = value;
+    Root["metrics"].append(res);
+}
+
+const Json::Value& TBenchReport::GetJson() const
+{
+    return Root;
+}
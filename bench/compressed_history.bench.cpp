@@ -0,0 +1,104 @@
+#include "bench.h"
+#include "src/compressed_history.h"
+
+#include <fstream>
+#include <functional>
+#include <math.h>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+    const size_t GENERATED_SAMPLES = 200000;
+
+    //! Memory of compressed store per sample, it is enough for the worst case
+    const size_t COMPRESSED_BYTES_PER_SAMPLE = 14;
+
+    /**
+     * @brief Trace like a polled channel: 10 mS interval with scheduling jitter,
+     * slow changing 12-bit value with noise of a few LSB
+     */
+    std::vector<TSampleStore::TSample> GenerateSamples()
+    {
+        std::mt19937                     gen(1);
+        std::normal_distribution<double> jitter(0, 200);
+        std::normal_distribution<double> noise(0, 1.5);
+
+        std::vector<TSampleStore::TSample> res;
+        int64_t                            ts = 1600000000000000;
+        for (size_t i = 0; i < GENERATED_SAMPLES; ++i) {
+            double t     = i * 0.01;
+            double value = 2000 + 500 * sin(2 * M_PI * t / 600) + noise(gen);
+            res.push_back({ts + static_cast<int64_t>(i * 10000 + jitter(gen)), static_cast<int32_t>(lround(value))});
+        }
+        return res;
+    }
+
+    std::vector<TSampleStore::TSample> LoadSamples(const std::string& fileName)
+    {
+        std::ifstream f(fileName);
+        if (!f.is_open()) {
+            throw std::runtime_error("Can't open " + fileName);
+        }
+        std::vector<TSampleStore::TSample> res;
+        TSampleStore::TSample              sample;
+        char                               comma;
+        while (f >> sample.TimestampUs >> comma >> sample.Value) {
+            res.push_back(sample);
+        }
+        if (res.empty()) {
+            throw std::runtime_error("No samples in " + fileName);
+        }
+        return res;
+    }
+
+    template<class TStore> void BenchStore(TBenchReport&                             report,
+                                           const TBenchSettings&                     settings,
+                                           const std::string&                        name,
+                                           const std::vector<TSampleStore::TSample>& samples,
+                                           std::function<TStore*()>                  makeStore)
+    {
+        std::unique_ptr<TStore> store;
+        RunBench(report, settings, name + ".Add", 1, [&] {
+            store.reset(makeStore());
+            for (const auto& sample : samples) {
+                store->Add(sample.TimestampUs, sample.Value);
+            }
+            return samples.size();
+        });
+
+        RunBench(report, settings, name + ".Get", 1, [&] {
+            auto res = store->Get(INT64_MIN, INT64_MAX, SIZE_MAX);
+            if (res.size() != samples.size() || res.back().Value != samples.back().Value) {
+                throw std::runtime_error(name + " returned wrong samples");
+            }
+            return res.size();
+        });
+    }
+} // namespace
+
+void BenchCompressedHistory(TBenchReport& report, const TBenchSettings& settings)
+{
+    auto samples = settings.HistoryDataFile.empty() ? GenerateSamples() : LoadSamples(settings.HistoryDataFile);
+
+    BenchStore<TSampleHistory>(report, settings, "SampleHistory", samples, [&] {
+        return new TSampleHistory(samples.size());
+    });
+    report.AddMetric("SampleHistory", "bytes_per_sample", TSampleHistory::GetSampleSize());
+
+    size_t storeSize = samples.size() * COMPRESSED_BYTES_PER_SAMPLE + 2 * TCompressedSampleStore::GetBlockSize();
+    BenchStore<TCompressedSampleStore>(report, settings, "CompressedSampleStore", samples, [&] {
+        return new TCompressedSampleStore(storeSize);
+    });
+
+    TCompressedSampleStore store(storeSize);
+    for (const auto& sample : samples) {
+        store.Add(sample.TimestampUs, sample.Value);
+    }
+    if (store.GetSampleCount() != samples.size()) {
+        throw std::runtime_error("Samples don't fit into CompressedSampleStore");
+    }
+    report.AddMetric("CompressedSampleStore",
+                     "bytes_per_sample",
+                     static_cast<double>(store.GetUsedBytes()) / store.GetSampleCount());
+}
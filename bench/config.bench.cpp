@@ -0,0 +1,30 @@
+#include "bench.h"
+#include "fake_sysfs.h"
+#include "src/config.h"
+#include "src/file_utils.h"
+
+void BenchConfig(TBenchReport& report, const TBenchSettings& settings)
+{
+    for (auto channels : settings.ChannelCounts) {
+        TFakeSysfs sysfs(channels);
+
+        Json::Value config;
+        config["device_name"]  = "ADCs";
+        config["iio_channels"] = Json::arrayValue;
+        for (uint32_t i = 0; i < channels; ++i) {
+            Json::Value channel;
+            channel["id"]                 = "A" + std::to_string(i);
+            channel["channel_number"]     = i;
+            channel["voltage_multiplier"] = 8.3917;
+            channel["averaging_window"]   = 10;
+            config["iio_channels"].append(channel);
+        }
+        std::string configFile = sysfs.GetRoot() + "/wb-mqtt-adc.conf";
+        WriteToFile(configFile, Json::writeString(Json::StreamWriterBuilder(), config));
+
+        RunBench(report, settings, "LoadConfig", channels, [&] {
+            LoadConfig(configFile, "", sysfs.GetRoot() + "/wb-mqtt-adc.conf.d", settings.SchemaFile);
+            return 1;
+        });
+    }
+}
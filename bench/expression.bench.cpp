@@ -0,0 +1,86 @@
+#include "bench.h"
+#include "src/expression.h"
+
+namespace
+{
+    //! Typical derived values: power, ratio, difference, magnitude
+    std::string MakeExpression(uint32_t i, uint32_t channels)
+    {
+        std::string a = "A" + std::to_string(i);
+        std::string b = "A" + std::to_string((i + 1) % channels);
+        switch (i % 4) {
+            case 0:
+                return a + " * " + b;
+            case 1:
+                return a + " / " + b + " * 100";
+            case 2:
+                return "abs(" + a + " - " + b + ") - 0.5 * 2";
+            default:
+                return "sqrt(" + a + " ^ 2 + " + b + " ^ 2)";
+        }
+    }
+
+    struct TCompiledExpression
+    {
+        TExpression         Expression;
+        std::vector<size_t> Sources;
+        std::vector<double> Inputs;
+        std::vector<double> Stack;
+    };
+}
+
+void BenchExpression(TBenchReport& report, const TBenchSettings& settings)
+{
+    for (auto channels : settings.ChannelCounts) {
+        // one expression per channel
+        std::vector<std::string> texts;
+        for (uint32_t i = 0; i < channels; ++i) {
+            texts.push_back(MakeExpression(i, channels));
+        }
+
+        size_t codeSize = 0;
+        RunBench(report, settings, "Expression.Compile", channels, [&] {
+            for (const auto& text : texts) {
+                codeSize += TExpression(text).GetSize();
+            }
+            return texts.size();
+        });
+
+        std::vector<TCompiledExpression> expressions;
+        for (const auto& text : texts) {
+            TExpression         expression(text);
+            std::vector<size_t> sources;
+            for (const auto& name : expression.GetVariables()) {
+                sources.push_back(std::stoul(name.substr(1)));
+            }
+            expressions.push_back(TCompiledExpression{expression,
+                                                      sources,
+                                                      std::vector<double>(sources.size()),
+                                                      std::vector<double>(expression.GetStackSize())});
+        }
+        size_t instructions = 0;
+        for (const auto& e : expressions) {
+            instructions += e.Expression.GetSize();
+        }
+        report.AddMetric("Expression.Compile",
+                         "instructions_per_expression." + std::to_string(channels),
+                         static_cast<double>(instructions) / expressions.size());
+
+        std::vector<double> values(channels);
+        for (uint32_t i = 0; i < channels; ++i) {
+            values[i] = 1.0 + i * 0.01;
+        }
+
+        // inputs are gathered from measured values like the worker does after every measurement
+        double sum = 0;
+        RunBench(report, settings, "Expression.Evaluate", channels, [&] {
+            for (auto& e : expressions) {
+                for (size_t i = 0; i < e.Sources.size(); ++i) {
+                    e.Inputs[i] = values[e.Sources[i]];
+                }
+                sum += e.Expression.Evaluate(e.Inputs.data(), e.Stack.data());
+            }
+            return expressions.size();
+        });
+    }
+}
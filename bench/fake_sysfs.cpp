@@ -0,0 +1,67 @@
+#include "fake_sysfs.h"
+
+#include <ftw.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "src/file_utils.h"
+
+namespace
+{
+    const char* SCALES_AVAILABLE = "0.451660156 0.903320312 1.806640625 3.613281250";
+
+    int RemoveEntry(const char* path, const struct stat*, int, struct FTW*)
+    {
+        return remove(path);
+    }
+
+    void RemoveTree(const std::string& path)
+    {
+        nftw(path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+}
+
+TFakeSysfs::TFakeSysfs(uint32_t channels)
+{
+    char root[] = "/tmp/wb-mqtt-adc-bench-XXXXXX";
+    if (!mkdtemp(root)) {
+        throw std::runtime_error("Can't create temporary directory");
+    }
+    Root   = root;
+    IIODir = Root + "/iio:device0";
+    if (mkdir(IIODir.c_str(), 0700) != 0) {
+        RemoveTree(Root);
+        throw std::runtime_error("Can't create " + IIODir);
+    }
+    WriteToFile(IIODir + "/in_voltage_scale_available", SCALES_AVAILABLE);
+    WriteToFile(IIODir + "/in_voltage_scale", "0.451660156");
+    for (uint32_t i = 0; i < channels; ++i) {
+        // different values for different channels, all of them are in range with any available scale
+        WriteToFile(IIODir + "/in_voltage" + std::to_string(i) + "_raw", std::to_string((i * 397) % 800 + 1));
+    }
+}
+
+TFakeSysfs::~TFakeSysfs()
+{
+    RemoveTree(Root);
+}
+
+const std::string& TFakeSysfs::GetRoot() const
+{
+    return Root;
+}
+
+const std::string& TFakeSysfs::GetIIODir() const
+{
+    return IIODir;
+}
+
+TChannelReader::TSettings TFakeSysfs::GetChannelSettings(uint32_t n) const
+{
+    TChannelReader::TSettings cfg;
+    cfg.ChannelNumber     = "voltage" + std::to_string(n);
+    cfg.VoltageMultiplier = 8.3917;
+    return cfg;
+}
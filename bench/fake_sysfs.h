@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "src/sysfs_adc.h"
+
+/**
+ * @brief Temporary directory with files of a fake IIO device: in_voltageN_raw for every channel,
+ * in_voltage_scale and in_voltage_scale_available. The directory is removed by destructor.
+ */
+class TFakeSysfs
+{
+public:
+    /**
+     * @brief Create fake IIO device. Throws std::runtime_error on failure.
+     *
+     * @param channels Number of channels, in_voltage0_raw ... in_voltage{channels - 1}_raw
+     */
+    explicit TFakeSysfs(uint32_t channels);
+    ~TFakeSysfs();
+
+    TFakeSysfs(const TFakeSysfs&) = delete;
+    TFakeSysfs& operator=(const TFakeSysfs&) = delete;
+
+    //! Root of the temporary tree
+    const std::string& GetRoot() const;
+
+    //! Folder of the fake IIO device
+    const std::string& GetIIODir() const;
+
+    //! Settings of the channel number n
+    TChannelReader::TSettings GetChannelSettings(uint32_t n) const;
+
+private:
+    std::string Root;
+    std::string IIODir;
+};
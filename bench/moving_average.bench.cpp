@@ -0,0 +1,36 @@
+#include "bench.h"
+#include "src/moving_average.h"
+
+namespace
+{
+    const uint32_t SAMPLES_PER_CALL = 100000;
+
+    //! Results are read once per readings_number samples like TChannelReader::Measure does
+    const uint32_t SAMPLES_PER_RESULT = 10;
+}
+
+void BenchMovingAverage(TBenchReport& report, const TBenchSettings& settings)
+{
+    for (size_t windowSize : {10, 1000}) {
+        for (uint32_t fractionalBits : {0, 8}) {
+            TMovingAverageCalculator c(windowSize);
+            int64_t                  check = 0;
+            uint32_t                 n     = 0;
+            RunBench(report,
+                     settings,
+                     "MovingAverage.AddValue.window" + std::to_string(windowSize) + ".bits" +
+                         std::to_string(fractionalBits),
+                     1,
+                     [&] {
+                         for (uint32_t i = 0; i < SAMPLES_PER_CALL; ++i, ++n) {
+                             // 24-bit ADC values
+                             c.AddValue((n * 2654435761u) >> 8);
+                             if (i % SAMPLES_PER_RESULT == 0) {
+                                 check += c.GetFixedPointValue(fractionalBits);
+                             }
+                         }
+                         return SAMPLES_PER_CALL;
+                     });
+        }
+    }
+}
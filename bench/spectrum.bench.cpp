@@ -0,0 +1,45 @@
+#include "bench.h"
+#include "src/spectrum.h"
+
+#include <math.h>
+
+namespace
+{
+    const uint32_t FFT_SIZES[] = {256, 1024, 4096};
+
+    //! Vibration-like signal: rotation frequency, its harmonic and broadband noise
+    double Value(uint32_t i)
+    {
+        double t = i * 1e-4;
+        return 2048 + 500 * sin(2 * M_PI * 49.5 * t) + 120 * sin(2 * M_PI * 99 * t) + ((i * 7919) % 64) - 32;
+    }
+}
+
+void BenchSpectrum(TBenchReport& report, const TBenchSettings& settings)
+{
+    for (auto size : FFT_SIZES) {
+        TSpectrumSettings spectrumSettings;
+        spectrumSettings.FftSize    = size;
+        spectrumSettings.SampleRate = 10000;
+        spectrumSettings.Bands      = {{"rotation", 40, 60}, {"harmonics", 60, 500}, {"bearing", 500, 5000}};
+
+        TSpectrumAnalyzer analyzer(spectrumSettings);
+        for (uint32_t i = 0; i < size; ++i) {
+            analyzer.Add(i * 100, Value(i));
+        }
+        double sum = 0;
+        RunBench(report, settings, "Spectrum.Compute." + std::to_string(size), 1, [&] {
+            sum += analyzer.Compute().DominantFrequency;
+            return 1;
+        });
+
+        // samples are taken from the input by the analysis thread one by one
+        uint32_t i = size;
+        RunBench(report, settings, "Spectrum.Add." + std::to_string(size), 1, [&] {
+            for (uint32_t n = 0; n < size; ++n, ++i) {
+                analyzer.Add(i * 100, Value(i));
+            }
+            return size;
+        });
+    }
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "fake_sysfs.h"
+
+#include <memory>
+
+namespace
+{
+    //! Readings of one Measure call in ReadFromADC benchmark
+    const uint32_t READINGS_PER_MEASURE = 1000;
+
+    const std::vector<std::string> SCALES = {"0.451660156", "0.903320312", "1.806640625", "3.613281250",
+                                             "7.226562500", "14.453125000"};
+}
+
+void BenchSysfsAdc(TBenchReport& report, const TBenchSettings& settings)
+{
+    WBMQTT::TLogger logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    for (auto channels : settings.ChannelCounts) {
+        TFakeSysfs sysfs(channels);
+
+        std::vector<std::unique_ptr<TChannelReader>> readers;
+        for (uint32_t i = 0; i < channels; ++i) {
+            readers.emplace_back(new TChannelReader(0.451660156,
+                                                    MAX_ADC_VALUE,
+                                                    sysfs.GetChannelSettings(i),
+                                                    0,
+                                                    logger,
+                                                    logger,
+                                                    sysfs.GetIIODir()));
+        }
+        RunBench(report, settings, "ChannelReader.Measure", channels, [&] {
+            for (auto& reader : readers) {
+                reader->Measure();
+            }
+            return readers.size();
+        });
+
+        // one reading per sample, averaging and conversion are done once per READINGS_PER_MEASURE samples
+        auto cfg           = sysfs.GetChannelSettings(0);
+        cfg.ReadingsNumber = READINGS_PER_MEASURE;
+        cfg.AveragingWindow = 1;
+        TChannelReader reader(0.451660156, MAX_ADC_VALUE, cfg, 0, logger, logger, sysfs.GetIIODir());
+        RunBench(report, settings, "ChannelReader.ReadFromADC", channels, [&] {
+            reader.Measure();
+            return READINGS_PER_MEASURE;
+        });
+    }
+}
+
+void BenchFindBestScale(TBenchReport& report, const TBenchSettings& settings)
+{
+    uint64_t found = 0;
+    RunBench(report, settings, "FindBestScale", 1, [&] {
+        found += FindBestScale(SCALES, 2.0).size();
+        found += FindBestScale(SCALES, 0).size();
+        return 2;
+    });
+}
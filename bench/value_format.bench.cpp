@@ -0,0 +1,40 @@
+#include "bench.h"
+#include "src/value_format.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    const uint32_t VALUES_PER_CALL = 10000;
+    const uint32_t DECIMAL_PLACES  = 3;
+
+    double Value(uint32_t i)
+    {
+        return (i % 4096) * 2.54 * 8.3917 / 1000.0;
+    }
+}
+
+void BenchValueFormat(TBenchReport& report, const TBenchSettings& settings)
+{
+    size_t totalLength = 0;
+    RunBench(report, settings, "ValueFormat.ostringstream", 1, [&] {
+        for (uint32_t i = 0; i < VALUES_PER_CALL; ++i) {
+            std::ostringstream out;
+            out << std::setprecision(DECIMAL_PLACES) << std::fixed << Value(i);
+            totalLength += out.str().size();
+        }
+        return VALUES_PER_CALL;
+    });
+
+    std::string value;
+    RunBench(report, settings, "ValueFormat.FormatDecimal", 1, [&] {
+        for (uint32_t i = 0; i < VALUES_PER_CALL; ++i) {
+            char   buf[64];
+            size_t len = FormatDecimal(Value(i), DECIMAL_PLACES, buf, sizeof(buf));
+            value.assign(buf, len);
+            totalLength += value.size();
+        }
+        return VALUES_PER_CALL;
+    });
+}
@@ -0,0 +1,113 @@
+#include "ac_analyzer.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+    //! Hysteresis of crossing detection relative to peak-to-peak of the previous window
+    const double HYSTERESIS_RATIO = 0.1;
+}
+
+const char* GetAcControlSuffix(TAcQuantity quantity)
+{
+    switch (quantity) {
+        case TAcQuantity::PeakToPeak:
+            return "_peak_to_peak";
+        case TAcQuantity::Dc:
+            return "_dc";
+        case TAcQuantity::Frequency:
+            return "_frequency";
+    }
+    return "";
+}
+
+TAcAnalyzer::TAcAnalyzer(int64_t windowUs)
+    : WindowUs(windowUs), HasLevel(false), Level(0), Hysteresis(0), WindowStartUs(0), Count(0)
+{}
+
+bool TAcAnalyzer::Add(int64_t timestampUs, double value)
+{
+    if (Count == 0) {
+        StartWindow(timestampUs);
+        if (!HasLevel) {
+            Level = value;
+        }
+    }
+    if (HasLevel) {
+        if (value < Level - Hysteresis) {
+            Armed = true;
+        } else if (Armed && value >= Level && Count != 0) {
+            // samples after the crossing belong to the next period, so the snapshot is taken before adding
+            Armed = false;
+            double    fraction = (Level - PrevValue) / (value - PrevValue);
+            TSnapshot snapshot{Count, Sum, SumSquares, PrevTimestampUs + fraction * (timestampUs - PrevTimestampUs)};
+            if (Crossings == 0) {
+                FirstCrossing = snapshot;
+            }
+            LastCrossing = snapshot;
+            ++Crossings;
+        }
+    }
+    double d = value - Level;
+    Sum += d;
+    SumSquares += d * d;
+    Min = std::min(Min, value);
+    Max = std::max(Max, value);
+    ++Count;
+    PrevTimestampUs = timestampUs;
+    PrevValue       = value;
+
+    if (timestampUs - WindowStartUs < WindowUs) {
+        return false;
+    }
+    bool hadLevel = HasLevel;
+    Complete();
+    return hadLevel;
+}
+
+const TAcResult& TAcAnalyzer::GetResult() const
+{
+    return Result;
+}
+
+void TAcAnalyzer::StartWindow(int64_t timestampUs)
+{
+    WindowStartUs = timestampUs;
+    Sum           = 0;
+    SumSquares    = 0;
+    Min           = INFINITY;
+    Max           = -INFINITY;
+    Armed         = false;
+    Crossings     = 0;
+}
+
+void TAcAnalyzer::Complete()
+{
+    uint64_t count      = Count;
+    double   sum        = Sum;
+    double   sumSquares = SumSquares;
+    double   frequency  = 0;
+    uint32_t periods    = 0;
+    if (Crossings >= 2) {
+        periods    = Crossings - 1;
+        count      = LastCrossing.Count - FirstCrossing.Count;
+        sum        = LastCrossing.Sum - FirstCrossing.Sum;
+        sumSquares = LastCrossing.SumSquares - FirstCrossing.SumSquares;
+        frequency  = periods * 1e6 / (LastCrossing.TimeUs - FirstCrossing.TimeUs);
+    }
+    double mean = sum / count;
+
+    Result.Dc         = Level + mean;
+    Result.Rms        = sqrt(std::max(0.0, sumSquares / count - mean * mean));
+    Result.Min        = Min;
+    Result.Max        = Max;
+    Result.PeakToPeak = Max - Min;
+    Result.Frequency  = frequency;
+    Result.Periods    = periods;
+
+    HasLevel   = true;
+    Level      = Result.Dc;
+    Hysteresis = HYSTERESIS_RATIO * Result.PeakToPeak;
+    Count      = 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//! Quantities of AC signal published as controls next to the channel, the channel's value is RMS
+enum class TAcQuantity
+{
+    PeakToPeak,
+    Dc,
+    Frequency
+};
+
+const size_t AC_QUANTITY_COUNT = 3;
+
+//! Suffix of control id of the quantity, e.g. "_frequency"
+const char* GetAcControlSuffix(TAcQuantity quantity);
+
+//! Result of AC measurement window in units of input values
+struct TAcResult
+{
+    //! RMS of AC component of the signal, DC offset is excluded
+    double Rms = 0;
+
+    double PeakToPeak = 0;
+
+    //! Mean value of the signal
+    double Dc = 0;
+
+    //! Frequency in Hz, 0 if the window has less than one whole period
+    double Frequency = 0;
+
+    //! Number of whole periods used for RMS and DC, 0 if the whole window is used
+    uint32_t Periods = 0;
+
+    double Min = 0;
+    double Max = 0;
+};
+
+/**
+ * @brief The class computes RMS, peak-to-peak, DC offset and frequency of AC signal by streaming
+ * accumulators, samples are not stored. Periods are delimited by rising crossings of the DC level
+ * of the previous window with hysteresis, so RMS and DC are computed over a whole number of periods
+ * and don't depend on the phase of the window. Crossing times are interpolated between samples for
+ * frequency estimation. The first window only measures the DC level and has no result.
+ */
+class TAcAnalyzer
+{
+public:
+    /**
+     * @brief Construct a new TAcAnalyzer object
+     *
+     * @param windowUs Duration of a measurement window in uS. It should include several periods
+     */
+    explicit TAcAnalyzer(int64_t windowUs);
+
+    /**
+     * @brief Add a sample
+     *
+     * @param timestampUs Time of the sample in uS, it must not decrease
+     * @param value Sample value
+     * @return true The window is complete, GetResult() returns its result until the next window is complete
+     */
+    bool Add(int64_t timestampUs, double value);
+
+    const TAcResult& GetResult() const;
+
+private:
+    //! Accumulators at a crossing of DC level
+    struct TSnapshot
+    {
+        uint64_t Count;
+        double   Sum;
+        double   SumSquares;
+        double   TimeUs;
+    };
+
+    int64_t WindowUs;
+
+    //! Crossing level and hysteresis from the previous window
+    bool   HasLevel;
+    double Level;
+    double Hysteresis;
+
+    int64_t  WindowStartUs;
+    uint64_t Count;
+
+    //! Sums of values relative to Level to reduce rounding errors
+    double Sum;
+    double SumSquares;
+
+    double Min;
+    double Max;
+
+    //! The signal has been below Level - Hysteresis since the last crossing
+    bool    Armed;
+    int64_t PrevTimestampUs;
+    double  PrevValue;
+
+    uint32_t  Crossings;
+    TSnapshot FirstCrossing;
+    TSnapshot LastCrossing;
+
+    TAcResult Result;
+
+    void Complete();
+    void StartWindow(int64_t timestampUs);
+};
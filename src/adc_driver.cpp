@@ -1,14 +1,23 @@
 #include "adc_driver.h"
 
+#include <algorithm>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <set>
 #include <vector>
 
-#include "sysfs_adc.h"
+#include "adc_worker.h"
+#include "compressed_history.h"
+#include "history_rpc.h"
+#include "value_format.h"
 
 /*
 "/devices/" DriverId "/meta/name"                                       = Config.DeviceName
 "/devices/" DriverId "/controls/" Config.Channels[i].Id                 = measured voltage
 "/devices/" DriverId "/controls/" Config.Channels[i].Id "/meta/order"   = i from Config.Channels[i]
 "/devices/" DriverId "/controls/" Config.Channels[i].Id "/meta/type"    = string "voltage"
+"/devices/" DriverId "/controls/" Config.Channels[i].Id "/meta/ts"      = measurement time in mS since the epoch
 */
 
 //! default scale for file "in_voltageNUMBER_scale"
@@ -16,128 +25,1013 @@
 
 namespace
 {
-    const char* DriverId = "wb-adc";
+    const char* DriverId      = "wb-adc";
+    const char* StatsDriverId = "wb-adc-stats";
 
-    struct TChannelDesc
+    const char* IIO_DEVICES_DIR = "/sys/bus/iio/devices";
+
+    //! Sysfs doesn't notify about devices created by the kernel, so the folder is rescanned periodically
+    const auto IIO_DEVICES_RESCAN_INTERVAL = std::chrono::milliseconds(1000);
+
+    //! Interval of taking samples from spectrum inputs. Inputs keep SPECTRUM_INPUT_WINDOWS FFT windows,
+    //! so samples are not lost if a window is captured faster than in SPECTRUM_INPUT_WINDOWS intervals
+    const auto   SPECTRUM_POLL_INTERVAL = std::chrono::milliseconds(50);
+    const size_t SPECTRUM_INPUT_WINDOWS = 4;
+
+    //! Frequency is published with the precision regardless of channel settings
+    const uint32_t FREQUENCY_DECIMAL_PLACES = 2;
+
+    WBMQTT::TControlArgs MakeControlArgs(const TADCChannelSettings& channel, size_t order, bool hasDevice)
+    {
+        return WBMQTT::TControlArgs{}
+            .SetId(channel.Id)
+            .SetType(channel.ReaderCfg.Conversion.empty() ? "voltage" : "value")
+            .SetOrder(order)
+            .SetReadonly(true)
+            .SetError(hasDevice ? "" : "r");
+    }
+
+    //! Control published in addition to the value of a channel
+    struct TExtraControl
+    {
+        std::string Id;
+        std::string Type;
+    };
+
+    //! Controls of AC signal quantities and spectral features of the channel
+    std::vector<TExtraControl> GetExtraControls(const TADCChannelSettings& channel)
     {
-        std::string    MqttId;
-        bool           Error;
-        TChannelReader Reader;
+        std::vector<TExtraControl> res;
+        if (channel.ReaderCfg.AcMode) {
+            for (size_t i = 0; i < AC_QUANTITY_COUNT; ++i) {
+                auto quantity = static_cast<TAcQuantity>(i);
+                res.push_back({channel.Id + GetAcControlSuffix(quantity),
+                               (quantity == TAcQuantity::Frequency) ? "value" : "voltage"});
+            }
+        }
+        if (channel.Spectrum.FftSize > 0) {
+            res.push_back({channel.Id + DOMINANT_FREQUENCY_SUFFIX, "value"});
+            for (const auto& band : channel.Spectrum.Bands) {
+                res.push_back({channel.Id + "_" + band.Id, "voltage"});
+            }
+        }
+        return res;
+    }
+
+    //! Additional controls have the order of the channel, so they are shown next to it
+    WBMQTT::TControlArgs MakeControlArgs(const TExtraControl& control, size_t order, bool hasDevice)
+    {
+        return WBMQTT::TControlArgs{}
+            .SetId(control.Id)
+            .SetType(control.Type)
+            .SetOrder(order)
+            .SetReadonly(true)
+            .SetError(hasDevice ? "" : "r");
+    }
+
+    WBMQTT::TControlArgs MakeControlArgs(const TVirtualChannelSettings& channel, size_t order, bool hasSources)
+    {
+        return WBMQTT::TControlArgs{}
+            .SetId(channel.Id)
+            .SetType(channel.Type)
+            .SetOrder(order)
+            .SetReadonly(true)
+            .SetError(hasSources ? "" : "r");
+    }
+
+    /**
+     * @brief Get trigger of IIO buffer from sample groups of its channels. Throws std::runtime_error if
+     * the channels belong to sample groups with different triggers.
+     */
+    TIIOTriggerSettings GetBufferTrigger(const TConfig& config, const std::vector<size_t>& channelIndexes)
+    {
+        const TSampleGroupSettings* res = nullptr;
+        for (auto i : channelIndexes) {
+            const auto* group = config.FindSampleGroup(config.Channels[i].SampleGroup);
+            if (!group) {
+                continue;
+            }
+            if (res && res->Trigger != group->Trigger) {
+                throw std::runtime_error("Sample groups " + res->Id + " and " + group->Id +
+                                         " of the same IIO device have different triggers");
+            }
+            res = group;
+        }
+        return res ? res->Trigger : TIIOTriggerSettings();
+    }
+
+    //! Channel analyzed by the spectrum worker
+    struct TSpectrumChannel
+    {
+        std::shared_ptr<TSpectrumInput> Input;
+        TSpectrumAnalyzer               Analyzer;
+
+        //! Id of dominant frequency control and ids of band controls in order of bands
+        std::string              DominantFrequencyId;
+        std::vector<std::string> BandIds;
+
+        uint32_t                              DecimalPlaces;
+        std::chrono::milliseconds             PublishInterval;
+        std::chrono::steady_clock::time_point NextPublish;
+
+        //! Index of the next sample to take from the input
+        uint64_t NextIndex;
     };
 
-    void AdcWorker(bool*                                      active,
-                   WBMQTT::PLocalDevice                       device,
-                   WBMQTT::PDeviceDriver                      mqttDriver,
-                   std::shared_ptr<std::vector<TChannelDesc>> channels,
-                   WBMQTT::TLogger&                           infoLogger,
-                   WBMQTT::TLogger&                           errorLogger)
+    //! Input of spectrum analysis of the channel, nullptr if the analysis is disabled
+    std::shared_ptr<TSpectrumInput> MakeSpectrumInput(const TADCChannelSettings& channel)
+    {
+        if (channel.Spectrum.FftSize == 0) {
+            return nullptr;
+        }
+        return std::make_shared<TSpectrumInput>(SPECTRUM_INPUT_WINDOWS * channel.Spectrum.FftSize);
+    }
+
+    void SpectrumAnalysisWorker(const TStopEvent&             stopEvent,
+                                std::vector<TSpectrumChannel> channels,
+                                WBMQTT::PDeviceDriver         mqttDriver,
+                                WBMQTT::PLocalDevice          device,
+                                WBMQTT::TLogger&              errorLogger)
     {
-        infoLogger.Log() << "ADC worker thread is started";
-        while (*active) {
-            for (auto& channel : *channels) {
+        // SCHED_IDLE threads run only when sampling threads don't need CPU
+        sched_param param{};
+        if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+            errorLogger.Log() << "Can't lower priority of spectrum analysis thread";
+        }
+        std::string text;
+        try {
+            while (stopEvent.WaitFor(SPECTRUM_POLL_INTERVAL)) {
                 try {
-                    channel.Reader.Measure(channel.MqttId + " ");
-                    channel.Error = false;
-                } catch (const std::exception& er) {
-                    channel.Error = true;
-                    errorLogger.Log() << er.what();
+                    auto                               now = std::chrono::steady_clock::now();
+                    WBMQTT::PDriverTx                  tx;
+                    std::vector<WBMQTT::TFuture<void>> futures;
+                    for (auto& channel : channels) {
+                        const auto& samples = channel.Input->Samples;
+                        // samples of a burst read can have equal timestamps, so they are taken by index
+                        for (const auto& sample :
+                             samples.GetSince(channel.NextIndex, samples.GetCapacity(), channel.NextIndex))
+                        {
+                            channel.Analyzer.Add(sample.TimestampUs, sample.Value);
+                        }
+                        if (now < channel.NextPublish || !channel.Analyzer.IsReady()) {
+                            continue;
+                        }
+                        channel.NextPublish = now + channel.PublishInterval;
+                        const auto& res     = channel.Analyzer.Compute();
+                        double      k       = channel.Input->RawValueMultiplier;
+                        if (!tx) {
+                            tx = mqttDriver->BeginTx();
+                        }
+                        FormatDecimal(res.DominantFrequency, FREQUENCY_DECIMAL_PLACES, text);
+                        futures.push_back(device->GetControl(channel.DominantFrequencyId)->SetRawValue(tx, text));
+                        for (size_t i = 0; i < channel.BandIds.size(); ++i) {
+                            FormatDecimal(res.BandRms[i] * k, channel.DecimalPlaces, text);
+                            futures.push_back(device->GetControl(channel.BandIds[i])->SetRawValue(tx, text));
+                        }
+                    }
+                    // values of a transaction are published in order, so it is enough to wait for the last one
+                    if (!futures.empty()) {
+                        futures.back().Wait();
+                    }
+                } catch (const std::exception& e) {
+                    errorLogger.Log() << "Can't publish spectral features: " << e.what();
                 }
             }
+        } catch (const std::exception& e) {
+            errorLogger.Log() << "Spectrum analysis thread failed: " << e.what();
+        }
+    }
 
-            auto tx = mqttDriver->BeginTx();
-            for (auto& channel : *channels) {
-                WBMQTT::PControl control = device->GetControl(channel.MqttId);
-                if (channel.Error) {
-                    auto future = control->SetError(tx, "r");
-                    future.Wait();
-                } else {
-                    auto future = control->SetRawValue(tx, channel.Reader.GetValue());
-                    future.Wait();
+    void StatisticsWorker(const TStopEvent&                     stopEvent,
+                          std::shared_ptr<TStatisticsCollector> collector,
+                          WBMQTT::PDeviceDriver                 mqttDriver,
+                          WBMQTT::PLocalDevice                  device,
+                          std::chrono::milliseconds             interval,
+                          WBMQTT::TLogger&                      errorLogger)
+    {
+        try {
+            while (stopEvent.WaitFor(interval)) {
+                try {
+                    auto                               tx = mqttDriver->BeginTx();
+                    std::vector<WBMQTT::TFuture<void>> futures;
+                    for (const auto& value : collector->Collect(std::chrono::steady_clock::now())) {
+                        futures.push_back(device->GetControl(value.first)->SetRawValue(tx, value.second));
+                    }
+                    // values of a transaction are published in order, so it is enough to wait for the last one
+                    if (!futures.empty()) {
+                        futures.back().Wait();
+                    }
+                } catch (const std::exception& e) {
+                    errorLogger.Log() << "Can't publish statistics: " << e.what();
                 }
             }
+        } catch (const std::exception& e) {
+            errorLogger.Log() << "Statistics thread failed: " << e.what();
         }
-        infoLogger.Log() << "ADC worker thread is stopped";
     }
 } // namespace
 
-TADCDriver::TADCDriver(const WBMQTT::PDeviceDriver& mqttDriver,
-                       const TConfig&               config,
-                       WBMQTT::TLogger&             errorLogger,
-                       WBMQTT::TLogger&             debugLogger,
-                       WBMQTT::TLogger&             infoLogger)
-    : MqttDriver(mqttDriver), ErrorLogger(errorLogger), DebugLogger(debugLogger),
-      InfoLogger(infoLogger)
+TADCDriver::TADCDriver(const WBMQTT::PDeviceDriver&  mqttDriver,
+                       const TConfig&                config,
+                       WBMQTT::TLogger&              errorLogger,
+                       WBMQTT::TLogger&              debugLogger,
+                       WBMQTT::TLogger&              infoLogger,
+                       const WBMQTT::PMqttRpcServer& rpcServer,
+                       const WBMQTT::PMqttClient&    mqttClient)
+    : Config(config), MqttDriver(mqttDriver), IIODevices(IIO_DEVICES_DIR), HistoryRpc(new THistoryRpcHandler()),
+      ErrorLogger(errorLogger), DebugLogger(debugLogger), InfoLogger(infoLogger)
 {
-    InfoLogger.Log() << "Creating driver MQTT controls";
-    auto tx = MqttDriver->BeginTx();
-    Device  = tx->CreateDevice(WBMQTT::TLocalDeviceArgs{}
-                                  .SetId(DriverId)
-                                  .SetTitle(config.DeviceName)
-                                  .SetIsVirtual(true)
-                                  .SetDoLoadPrevious(false))
-                 .GetValue();
+    auto startTime = std::chrono::steady_clock::now();
 
+    InfoLogger.Log() << "Creating driver MQTT controls";
     size_t n = 0;
+    {
+        auto tx = MqttDriver->BeginTx();
+        Device  = tx->CreateDevice(WBMQTT::TLocalDeviceArgs{}
+                                      .SetId(DriverId)
+                                      .SetTitle(config.DeviceName)
+                                      .SetIsVirtual(true)
+                                      .SetDoLoadPrevious(false))
+                     .GetValue();
+
+        // /sys/bus/iio/devices is scanned once for all channels
+        IIODevices.Rescan();
+        std::vector<WBMQTT::TFuture<WBMQTT::PControl>> controlFutures;
+        for (const auto& channel : config.Channels) {
+            std::string sysfsIIODir = IIODevices.Find(channel.MatchIIO);
+            if (sysfsIIODir.empty()) {
+                ErrorLogger.Log() << "Can't fild matching sysfs IIO: " + channel.MatchIIO;
+            }
+            controlFutures.push_back(Device->CreateControl(tx, MakeControlArgs(channel, n, !sysfsIIODir.empty())));
+            for (const auto& control : GetExtraControls(channel)) {
+                controlFutures.push_back(Device->CreateControl(tx, MakeControlArgs(control, n, !sysfsIIODir.empty())));
+            }
+            ++n;
+            ChannelStates.push_back(CreateChannelState(channel));
+        }
+        for (const auto& channel : config.VirtualChannels) {
+            controlFutures.push_back(Device->CreateControl(tx, MakeControlArgs(channel, n, HasSources(channel))));
+            ++n;
+        }
+        // controls of a transaction are created in order, so it is enough to wait for the last one
+        if (!controlFutures.empty()) {
+            controlFutures.back().Wait();
+        }
+        Device->RemoveUnusedControls(tx);
+    }
+    auto controlsTime = std::chrono::steady_clock::now();
+    InfoLogger.Log() << n << " MQTT controls are created, " << IIODevices.GetDeviceCount()
+                     << " IIO devices found";
+
+    Publisher.reset(new TPublisher(MqttDriver, Device, config.PublisherCfg, ErrorLogger, mqttClient, DriverId));
+    Publisher->Start();
+    if (!mqttClient && std::any_of(config.Channels.begin(), config.Channels.end(), [](const TADCChannelSettings& channel) {
+            return channel.PublishTimestamp;
+        }))
+    {
+        ErrorLogger.Log() << "MQTT client is not available, measurement time can't be published";
+    }
+
+    // scale files shared by channels of an IIO device are read once
+    TFileContentsCache scaleFiles;
+    UpdateGroups(scaleFiles);
+    auto readersTime = std::chrono::steady_clock::now();
+
+    // the method is registered even without history, channels with history can be added by reload
+    if (rpcServer) {
+        auto historyRpc = HistoryRpc;
+        rpcServer->RegisterMethod("history", "get", [=](const Json::Value& request) {
+            return historyRpc->GetHistory(request);
+        });
+    } else if (std::any_of(config.Channels.begin(), config.Channels.end(), [](const TADCChannelSettings& channel) {
+                   return channel.HistorySizeKb > 0;
+               }))
+    {
+        ErrorLogger.Log() << "MQTT RPC is not available, sample history can't be requested";
+    }
+
+    if (config.StatsIntervalMs > 0) {
+        CreateStatistics(std::chrono::milliseconds(config.StatsIntervalMs));
+    }
+    StartSpectrum();
+
+    try {
+        DeviceMonitor.reset(new TIIODeviceMonitor(IIO_DEVICES_DIR, IIO_DEVICES_RESCAN_INTERVAL));
+        if (!DeviceMonitor->IsWatching()) {
+            InfoLogger.Log() << IIO_DEVICES_DIR << " can't be watched, it is rescanned every "
+                             << IIO_DEVICES_RESCAN_INTERVAL.count() << " ms";
+        }
+        DeviceWatcher = WBMQTT::MakeThread("ADC hotplug", {[this] { WatchDevices(); }});
+    } catch (const std::exception& e) {
+        ErrorLogger.Log() << "IIO devices hotplug is disabled: " << e.what();
+    }
+
+    auto toMs = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    InfoLogger.Log() << "Driver is started in " << toMs(std::chrono::steady_clock::now() - startTime)
+                     << " ms (controls: " << toMs(controlsTime - startTime)
+                     << " ms, readers: " << toMs(readersTime - controlsTime) << " ms, "
+                     << scaleFiles.GetReadCount() << " scale files read)";
+}
+
+bool TADCDriver::HasSources(const TVirtualChannelSettings& channel)
+{
+    for (const auto& source : channel.Expression->GetVariables()) {
+        auto it = std::find_if(Config.Channels.begin(), Config.Channels.end(), [&](const TADCChannelSettings& c) {
+            return c.Id == source;
+        });
+        if (it == Config.Channels.end() || IIODevices.Find(it->MatchIIO).empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TADCDriver::TChannelState TADCDriver::CreateChannelState(const TADCChannelSettings& channel)
+{
+    TChannelState state;
+    if (Config.StatsIntervalMs > 0) {
+        state.Statistics = std::make_shared<TReadStatistics>();
+    }
+    if (channel.ShmRingSize > 0) {
+        try {
+            state.SampleExport = std::make_shared<TShmRingWriter>(channel.Id, channel.ShmRingSize);
+        } catch (const std::exception& e) {
+            ErrorLogger.Log() << "Can't export samples of " << channel.Id << ": " << e.what();
+        }
+    }
+    CreateHistory(channel, state);
+    state.Spectrum = MakeSpectrumInput(channel);
+    return state;
+}
+
+void TADCDriver::CreateHistory(const TADCChannelSettings& channel, TChannelState& state)
+{
+    state.History.reset();
+    if (channel.HistorySizeKb > 0) {
+        size_t budget = static_cast<size_t>(channel.HistorySizeKb) * 1024;
+        if (channel.CompressHistory) {
+            state.History.reset(new TCompressedSampleStore(budget));
+        } else {
+            state.History.reset(new TSampleHistory(TSampleHistory::GetCapacityForBudget(budget)));
+        }
+    }
+}
+
+void TADCDriver::UpdateGroups(TFileContentsCache& scaleFiles, const std::set<std::string>& changedChannels)
+{
+    // channels are grouped by IIO device and acquisition mode, every group has its own worker
+    std::map<TGroupKey, std::vector<size_t>> groupChannels;
+    std::set<std::string>                    sampledChannels;
+    std::map<std::string, std::string>       sampleGroupDirs;
+    for (size_t i = 0; i < Config.Channels.size(); ++i) {
+        const auto& channel     = Config.Channels[i];
+        std::string sysfsIIODir = IIODevices.Find(channel.MatchIIO);
+        if (!sysfsIIODir.empty()) {
+            groupChannels[std::make_pair(sysfsIIODir, channel.UseIIOBuffer)].push_back(i);
+            sampledChannels.insert(channel.Id);
+            if (!channel.SampleGroup.empty()) {
+                auto dir = sampleGroupDirs.emplace(channel.SampleGroup, sysfsIIODir).first;
+                if (dir->second != sysfsIIODir) {
+                    ErrorLogger.Log() << "Channels of sample group " << channel.SampleGroup << " are on " << dir->second
+                                      << " and " << sysfsIIODir << ", they are not sampled synchronously";
+                }
+            }
+        }
+    }
+
+    // a virtual channel is computed by the worker sampling all its sources
+    std::map<TGroupKey, std::vector<size_t>> groupVirtualChannels;
+    for (size_t i = 0; i < Config.VirtualChannels.size(); ++i) {
+        const auto&           channel = Config.VirtualChannels[i];
+        std::set<TGroupKey>   keys;
+        bool                  sampled = true;
+        for (const auto& source : channel.Expression->GetVariables()) {
+            auto it = std::find_if(groupChannels.begin(), groupChannels.end(), [&](const auto& group) {
+                return std::any_of(group.second.begin(), group.second.end(), [&](size_t n) {
+                    return Config.Channels[n].Id == source;
+                });
+            });
+            if (it == groupChannels.end()) {
+                sampled = false;
+            } else {
+                keys.insert(it->first);
+            }
+        }
+        if (!sampled) {
+            continue;
+        }
+        if (keys.size() > 1) {
+            ErrorLogger.Log() << "Sources of virtual channel " << channel.Id
+                              << " are sampled by different workers, it is not computed";
+            continue;
+        }
+        groupVirtualChannels[*keys.begin()].push_back(i);
+        sampledChannels.insert(channel.Id);
+    }
+
+    auto getVirtualChannels = [&](const TGroupKey& key) {
+        auto it = groupVirtualChannels.find(key);
+        return (it != groupVirtualChannels.end()) ? it->second : std::vector<size_t>();
+    };
+
+    auto isSameGroup = [&](const TGroupKey& key, const std::vector<std::string>& channelIds) {
+        auto channels = groupChannels.find(key);
+        if (channels == groupChannels.end() || channels->second.size() != channelIds.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < channelIds.size(); ++i) {
+            const auto& id = Config.Channels[channels->second[i]].Id;
+            if (id != channelIds[i] || changedChannels.count(id)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto isSameVirtualChannels = [&](const TGroupKey& key, const std::vector<std::string>& channelIds) {
+        auto indexes = getVirtualChannels(key);
+        if (indexes.size() != channelIds.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < channelIds.size(); ++i) {
+            const auto& id = Config.VirtualChannels[indexes[i]].Id;
+            if (id != channelIds[i] || changedChannels.count(id)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // stopped groups give readers of unchanged channels, IIO buffers and queues to restarted ones
+    std::map<TGroupKey, TGroupWorker> stoppedGroups;
+    for (auto it = Groups.begin(); it != Groups.end();) {
+        if (isSameGroup(it->first, it->second.ChannelIds) &&
+            isSameVirtualChannels(it->first, it->second.VirtualChannelIds))
+        {
+            ++it;
+            continue;
+        }
+        StopWorker(it->second);
+        // errors are queued after the last values of channels, so they are published later
+        std::vector<std::string> stoppedIds;
+        for (const auto& channel : it->second.Group->Channels) {
+            stoppedIds.push_back(channel.MqttId);
+        }
+        for (const auto& channel : it->second.Group->VirtualChannels) {
+            stoppedIds.push_back(channel.MqttId);
+        }
+        for (const auto& id : stoppedIds) {
+            if (!sampledChannels.count(id)) {
+                TPublishItem item;
+                item.ControlId = id;
+                item.Error     = true;
+                it->second.Group->PublishQueue->Push(std::move(item));
+            }
+        }
+        stoppedGroups.emplace(it->first, std::move(it->second));
+        it = Groups.erase(it);
+    }
+
+    for (auto it = FailedGroups.begin(); it != FailedGroups.end();) {
+        if (isSameGroup(it->first, it->second)) {
+            ++it;
+        } else {
+            it = FailedGroups.erase(it);
+        }
+    }
+
+    std::vector<std::string> failedChannels;
+    for (const auto& groupDesc : groupChannels) {
+        if (Groups.count(groupDesc.first) || FailedGroups.count(groupDesc.first)) {
+            continue;
+        }
+        auto stopped         = stoppedGroups.find(groupDesc.first);
+        auto virtualChannels = getVirtualChannels(groupDesc.first);
+        if (!StartGroup(groupDesc.first,
+                        groupDesc.second,
+                        virtualChannels,
+                        scaleFiles,
+                        changedChannels,
+                        (stopped != stoppedGroups.end()) ? &stopped->second : nullptr))
+        {
+            auto& failed = FailedGroups[groupDesc.first];
+            for (auto i : groupDesc.second) {
+                failed.push_back(Config.Channels[i].Id);
+                failedChannels.push_back(Config.Channels[i].Id);
+            }
+            for (auto i : virtualChannels) {
+                failedChannels.push_back(Config.VirtualChannels[i].Id);
+            }
+        }
+    }
+    if (!failedChannels.empty()) {
+        auto                               tx = MqttDriver->BeginTx();
+        std::vector<WBMQTT::TFuture<void>> errorFutures;
+        for (const auto& id : failedChannels) {
+            errorFutures.push_back(Device->GetControl(id)->SetError(tx, "r"));
+        }
+        errorFutures.back().Wait();
+    }
+
+    for (auto& stopped : stoppedGroups) {
+        if (stopped.second.Group->PublishQueue) {
+            InfoLogger.Log() << "Channels of " << stopped.first.first << " are stopped";
+            FreeQueues.push_back(stopped.second.Group->PublishQueue);
+        }
+    }
+}
+
+bool TADCDriver::StartGroup(const TGroupKey&             key,
+                            const std::vector<size_t>&   channelIndexes,
+                            const std::vector<size_t>&   virtualIndexes,
+                            TFileContentsCache&          scaleFiles,
+                            const std::set<std::string>& changedChannels,
+                            TGroupWorker*                previous)
+{
+    TGroupWorker worker;
+    worker.Group = std::make_shared<TChannelGroup>();
+    if (previous) {
+        // kept readers and IIO buffer refer to the stop event
+        worker.StopEvent = previous->StopEvent;
+        worker.StopEvent->Reset();
+    } else {
+        worker.StopEvent = std::make_shared<TStopEvent>();
+    }
+
+    auto& group       = *worker.Group;
+    group.SysfsIIODir = key.first;
+
+    // groups appeared after creation of statistics controls have no cycle statistics
+    if (Config.StatsIntervalMs > 0) {
+        auto it = CycleDurations.find(key);
+        if (it != CycleDurations.end()) {
+            group.CycleDuration = it->second;
+        } else if (!StatsWorker) {
+            group.CycleDuration = std::make_shared<TLatencyHistogram>();
+            CycleDurations[key] = group.CycleDuration;
+        }
+    }
+
+    // readers of unchanged channels keep their filters and publication state
+    std::map<std::string, TChannelDesc*> previousChannels;
+    std::vector<std::string>             previousNumbers;
+    if (previous) {
+        for (auto& channel : previous->Group->Channels) {
+            previousChannels[channel.MqttId] = &channel;
+            previousNumbers.push_back(channel.Reader.GetChannelNumber());
+        }
+    }
+
+    size_t keptCount = 0;
+    try {
+        std::vector<std::string> channelNumbers;
+        for (auto i : channelIndexes) {
+            const auto& channel = Config.Channels[i];
+            const auto& state   = ChannelStates[i];
+            worker.ChannelIds.push_back(channel.Id);
+            auto prev = previousChannels.find(channel.Id);
+            if (prev != previousChannels.end() && !changedChannels.count(channel.Id)) {
+                group.Channels.push_back(std::move(*prev->second));
+                ++keptCount;
+            } else {
+                // FIXME: delay ???
+                group.Channels.push_back(TChannelDesc{channel.Id,
+                                                      false,
+                                                      {MXS_LRADC_DEFAULT_SCALE_FACTOR,
+                                                       MAX_ADC_VALUE,
+                                                       channel.ReaderCfg,
+                                                       10,
+                                                       DebugLogger,
+                                                       InfoLogger,
+                                                       group.SysfsIIODir,
+                                                       worker.StopEvent.get(),
+                                                       &scaleFiles},
+                                                      std::chrono::milliseconds(channel.PollIntervalMs),
+                                                      TPublishPolicy(channel.PublishCfg)});
+                if (channel.ReaderCfg.AcMode) {
+                    for (size_t q = 0; q < AC_QUANTITY_COUNT; ++q) {
+                        auto quantity = static_cast<TAcQuantity>(q);
+                        group.Channels.back().AcControls.push_back(
+                            TAcControlDesc{channel.Id + GetAcControlSuffix(quantity), quantity, TPublishPolicy(channel.PublishCfg)});
+                    }
+                }
+                group.Channels.back().PublishTimestamp = channel.PublishTimestamp;
+                auto& reader = group.Channels.back().Reader;
+                reader.SetStatistics(state.Statistics);
+                reader.SetSampleExport(state.SampleExport);
+                reader.SetSpectrumInput(state.Spectrum);
+                if (state.History) {
+                    reader.SetHistory(state.History);
+                    HistoryRpc->AddChannel(channel.Id, state.History, reader.GetRawValueMultiplier());
+                }
+            }
+            group.ReadingsNumber = std::max(group.ReadingsNumber, channel.ReaderCfg.ReadingsNumber);
+            channelNumbers.push_back(channel.ReaderCfg.ChannelNumber);
+        }
+        if (key.second) {
+            auto trigger = GetBufferTrigger(Config, channelIndexes);
+            if (trigger.Type == TIIOTriggerType::Sysfs) {
+                group.PollInterval = std::chrono::milliseconds(Config.Channels[channelIndexes.front()].PollIntervalMs);
+                for (auto i : channelIndexes) {
+                    group.PollInterval = std::min(group.PollInterval,
+                                                  std::chrono::milliseconds(Config.Channels[i].PollIntervalMs));
+                }
+            }
+            // the buffer keeps collecting scans while the worker is restarted, so no samples are lost
+            if (previous && previous->Group->Buffer && previous->IIOBufferLength == Config.IIOBufferLength &&
+                previousNumbers == channelNumbers && previous->Trigger == trigger)
+            {
+                group.Trigger = std::move(previous->Group->Trigger);
+                group.Buffer  = std::move(previous->Group->Buffer);
+            } else {
+                // scan elements and trigger can't be changed while the buffer is enabled
+                if (previous) {
+                    previous->Group->Buffer.reset();
+                    previous->Group->Trigger.reset();
+                }
+                if (trigger.Type != TIIOTriggerType::None) {
+                    try {
+                        group.Trigger.reset(new TIIOTrigger(trigger, group.SysfsIIODir, IIO_DEVICES_DIR));
+                    } catch (const std::exception& e) {
+                        throw std::runtime_error("Can't set trigger of " + group.SysfsIIODir + ": " + e.what());
+                    }
+                    InfoLogger.Log() << "Trigger of " << group.SysfsIIODir << " is set to " << trigger.Name;
+                }
+                std::string devNode = "/dev/" + group.SysfsIIODir.substr(group.SysfsIIODir.rfind('/') + 1);
+                try {
+                    group.Buffer.reset(new TIIOBuffer(group.SysfsIIODir,
+                                                      devNode,
+                                                      channelNumbers,
+                                                      Config.IIOBufferLength,
+                                                      worker.StopEvent.get()));
+                } catch (const std::exception& e) {
+                    throw std::runtime_error("Can't enable IIO buffer of " + group.SysfsIIODir + ": " + e.what());
+                }
+                InfoLogger.Log() << "IIO buffer of " << group.SysfsIIODir << " is enabled";
+            }
+            worker.IIOBufferLength = Config.IIOBufferLength;
+            worker.Trigger         = trigger;
+        }
+    } catch (const std::exception& e) {
+        ErrorLogger.Log() << e.what();
+        return false;
+    }
+
+    // unchanged virtual channels keep their publication state, sources are looked up again
+    std::map<std::string, TVirtualChannelDesc*> previousVirtualChannels;
+    if (previous) {
+        for (auto& channel : previous->Group->VirtualChannels) {
+            previousVirtualChannels[channel.MqttId] = &channel;
+        }
+    }
+    for (auto& channel : group.Channels) {
+        channel.VirtualChannels.clear();
+    }
+    for (auto i : virtualIndexes) {
+        const auto& settings = Config.VirtualChannels[i];
+        worker.VirtualChannelIds.push_back(settings.Id);
+        auto prev = previousVirtualChannels.find(settings.Id);
+        if (prev != previousVirtualChannels.end() && !changedChannels.count(settings.Id)) {
+            group.VirtualChannels.push_back(std::move(*prev->second));
+        } else {
+            group.VirtualChannels.push_back(
+                TVirtualChannelDesc{settings.Id, settings.Expression, {}, settings.DecimalPlaces, settings.PublishCfg});
+        }
+        auto& channel = group.VirtualChannels.back();
+        channel.Sources.clear();
+        for (const auto& source : settings.Expression->GetVariables()) {
+            auto it = std::find_if(group.Channels.begin(), group.Channels.end(), [&](const TChannelDesc& c) {
+                return c.MqttId == source;
+            });
+            channel.Sources.push_back(it - group.Channels.begin());
+            it->VirtualChannels.push_back(group.VirtualChannels.size() - 1);
+        }
+        channel.Inputs.resize(channel.Sources.size());
+        channel.Stack.resize(settings.Expression->GetStackSize());
+    }
+
+    if (previous && previous->Group->PublishQueue) {
+        group.PublishQueue = previous->Group->PublishQueue;
+        previous->Group->PublishQueue.reset();
+    } else if (FreeQueues.empty()) {
+        group.PublishQueue = Publisher->CreateQueue();
+    } else {
+        group.PublishQueue = FreeQueues.back();
+        FreeQueues.pop_back();
+    }
+    group.PublishQueue->SetStopEvent(worker.StopEvent);
+
+    std::string threadName = "ADC " + group.SysfsIIODir.substr(group.SysfsIIODir.rfind('/') + 1);
+    auto        stopEvent  = worker.StopEvent;
+    auto        groupPtr   = worker.Group;
+    worker.Thread          = WBMQTT::MakeThread(threadName,
+                                       {[=] { AdcWorker(*stopEvent, groupPtr, InfoLogger, ErrorLogger); }});
+    Groups[key]            = std::move(worker);
+    if (previous) {
+        InfoLogger.Log() << "Channels of " << key.first << " are restarted, " << keptCount << " of "
+                         << channelIndexes.size() << " keep their state";
+    } else {
+        InfoLogger.Log() << "Channels of " << key.first << " are started";
+    }
+    return true;
+}
+
+void TADCDriver::StopWorker(TGroupWorker& worker)
+{
+    worker.StopEvent->Set();
+    if (worker.Thread->joinable()) {
+        worker.Thread->join();
+    }
+}
+
+void TADCDriver::WatchDevices()
+{
+    try {
+        while (DeviceMonitor->Wait(StopEvent)) {
+            try {
+                std::lock_guard<std::mutex> lg(GroupsMutex);
+                if (IIODevices.Rescan()) {
+                    InfoLogger.Log() << "IIO devices are changed, " << IIODevices.GetDeviceCount() << " found";
+                    TFileContentsCache scaleFiles;
+                    UpdateGroups(scaleFiles);
+                }
+            } catch (const std::exception& e) {
+                ErrorLogger.Log() << "Can't update IIO devices: " << e.what();
+            }
+        }
+    } catch (const std::exception& e) {
+        ErrorLogger.Log() << "IIO devices monitoring failed: " << e.what();
+    }
+}
+
+void TADCDriver::Reload(const TConfig& config)
+{
+    std::lock_guard<std::mutex> lg(GroupsMutex);
+    if (StopEvent.IsSet()) {
+        return;
+    }
+
+    auto diff = DiffConfigs(Config, config);
+    if (diff.RestartRequired) {
+        InfoLogger.Log() << "Device name, publication and statistics settings are applied after restart";
+    }
+    if (config.EnableDebugMessages != Config.EnableDebugMessages) {
+        DebugLogger.SetEnabled(config.EnableDebugMessages);
+    }
+    Config.EnableDebugMessages  = config.EnableDebugMessages;
+    Config.HistoryMemoryLimitKb = config.HistoryMemoryLimitKb;
+    Config.IIOBufferLength      = config.IIOBufferLength;
+    if (diff.IsEmpty()) {
+        InfoLogger.Log() << "Channels are not changed";
+        return;
+    }
+
+    std::map<std::string, size_t> runningChannels;
+    for (size_t i = 0; i < Config.Channels.size(); ++i) {
+        runningChannels[Config.Channels[i].Id] = i;
+    }
 
-    std::shared_ptr<std::vector<TChannelDesc>> readers(new std::vector<TChannelDesc>());
+    // additional controls of channels are matched by id like channels
+    std::set<std::string> runningControls;
+    std::set<std::string> reloadedControls;
+    for (const auto& channel : Config.Channels) {
+        for (const auto& control : GetExtraControls(channel)) {
+            runningControls.insert(control.Id);
+        }
+    }
     for (const auto& channel : config.Channels) {
-        std::string sysfsIIODir = FindSysfsIIODir(channel.MatchIIO);
-        if (sysfsIIODir.empty()) {
-            ErrorLogger.Log() << "Can't fild matching sysfs IIO: " + channel.MatchIIO;
-        }
-        auto futureControl = Device->CreateControl(tx,
-                                                   WBMQTT::TControlArgs{}
-                                                       .SetId(channel.Id)
-                                                       .SetType("voltage")
-                                                       .SetOrder(n)
-                                                       .SetReadonly(true)
-                                                       .SetError(sysfsIIODir.empty() ? "r" : ""));
+        for (const auto& control : GetExtraControls(channel)) {
+            reloadedControls.insert(control.Id);
+        }
+    }
+
+    std::vector<TChannelState> states;
+    {
+        auto                                           tx = MqttDriver->BeginTx();
+        std::vector<WBMQTT::TFuture<WBMQTT::PControl>> controlFutures;
+        for (size_t i = 0; i < config.Channels.size(); ++i) {
+            const auto& channel   = config.Channels[i];
+            auto        it        = runningChannels.find(channel.Id);
+            bool        isNew     = (it == runningChannels.end());
+            bool        hasDevice = !IIODevices.Find(channel.MatchIIO).empty();
+            if (isNew) {
+                controlFutures.push_back(Device->CreateControl(tx, MakeControlArgs(channel, i, hasDevice)));
+            }
+            for (const auto& control : GetExtraControls(channel)) {
+                if (!runningControls.count(control.Id)) {
+                    controlFutures.push_back(Device->CreateControl(tx, MakeControlArgs(control, i, hasDevice)));
+                }
+            }
+            if (isNew) {
+                // controls of the statistics device are created on start only
+                auto state = CreateChannelState(channel);
+                if (state.Statistics) {
+                    state.Statistics.reset();
+                    InfoLogger.Log() << "Statistics of " << channel.Id << " is published after restart";
+                }
+                states.push_back(state);
+                continue;
+            }
+            // shared memory object can't be recreated while the old writer exists
+            const auto& running = Config.Channels[it->second];
+            auto        state   = ChannelStates[it->second];
+            if (running.ShmRingSize != channel.ShmRingSize) {
+                InfoLogger.Log() << "shm_ring_size of " << channel.Id << " is applied after restart";
+            }
+            if (running.HistorySizeKb != channel.HistorySizeKb || running.CompressHistory != channel.CompressHistory) {
+                CreateHistory(channel, state);
+                if (!state.History) {
+                    HistoryRpc->RemoveChannel(channel.Id);
+                }
+            }
+            if (running.Spectrum.FftSize != channel.Spectrum.FftSize) {
+                state.Spectrum = MakeSpectrumInput(channel);
+            }
+            states.push_back(state);
+        }
+        for (size_t i = 0; i < config.VirtualChannels.size(); ++i) {
+            const auto& channel = config.VirtualChannels[i];
+            auto        running = std::find_if(Config.VirtualChannels.begin(),
+                                        Config.VirtualChannels.end(),
+                                        [&](const TVirtualChannelSettings& c) { return c.Id == channel.Id; });
+            if (running == Config.VirtualChannels.end()) {
+                controlFutures.push_back(
+                    Device->CreateControl(tx, MakeControlArgs(channel, config.Channels.size() + i, false)));
+            }
+        }
+        if (!controlFutures.empty()) {
+            controlFutures.back().Wait();
+        }
+    }
+
+    // the spectrum worker refers to channels, so it is restarted with the new configuration
+    StopSpectrum();
+    Config.Channels        = config.Channels;
+    Config.VirtualChannels = config.VirtualChannels;
+    Config.SampleGroups    = config.SampleGroups;
+    ChannelStates          = std::move(states);
+    TFileContentsCache scaleFiles;
+    UpdateGroups(scaleFiles, std::set<std::string>(diff.Changed.begin(), diff.Changed.end()));
+
+    // controls are removed after workers of the channels are stopped
+    auto                               tx = MqttDriver->BeginTx();
+    std::vector<WBMQTT::TFuture<void>> removeFutures;
+    for (const auto& id : diff.Removed) {
+        HistoryRpc->RemoveChannel(id);
+        removeFutures.push_back(Device->RemoveControl(tx, id));
+    }
+    for (const auto& id : runningControls) {
+        if (!reloadedControls.count(id)) {
+            removeFutures.push_back(Device->RemoveControl(tx, id));
+        }
+    }
+    if (!removeFutures.empty()) {
+        removeFutures.back().Wait();
+    }
+    StartSpectrum();
+
+    InfoLogger.Log() << "Config is reloaded: " << diff.Added.size() << " channels added, " << diff.Removed.size()
+                     << " removed, " << diff.Changed.size() << " changed";
+}
+
+void TADCDriver::CreateStatistics(std::chrono::milliseconds interval)
+{
+    std::shared_ptr<TStatisticsCollector> collector(new TStatisticsCollector());
+    for (size_t i = 0; i < Config.Channels.size(); ++i) {
+        // sampling jitter is for diagnostics of the system, so it is published in debug mode only
+        collector->AddChannel(Config.Channels[i].Id, ChannelStates[i].Statistics, Config.EnableDebugMessages);
+    }
+    for (const auto& cycle : CycleDurations) {
+        const auto& sysfsIIODir = cycle.first.first;
+        std::string cycleId     = sysfsIIODir.substr(sysfsIIODir.rfind('/') + 1);
+        if (cycle.first.second) {
+            cycleId += "_buffer";
+        }
+        collector->AddCycle(cycleId, cycle.second);
+    }
+    auto publisher = Publisher.get();
+    collector->SetQueueDepthSource([=] { return publisher->GetQueueDepth(); });
+
+    auto tx     = MqttDriver->BeginTx();
+    auto device = tx->CreateDevice(WBMQTT::TLocalDeviceArgs{}
+                                       .SetId(StatsDriverId)
+                                       .SetTitle("ADC statistics")
+                                       .SetIsVirtual(true)
+                                       .SetDoLoadPrevious(false))
+                      .GetValue();
+    size_t                             n = 0;
+    std::vector<WBMQTT::TFuture<WBMQTT::PControl>> futures;
+    for (const auto& id : collector->GetControlIds()) {
+        futures.push_back(device->CreateControl(
+            tx,
+            WBMQTT::TControlArgs{}.SetId(id).SetType("value").SetOrder(n).SetReadonly(true)));
         ++n;
-        futureControl.Wait();
+    }
+    for (auto& f : futures) {
+        f.Wait();
+    }
 
-        if (!sysfsIIODir.empty()) {
-            // FIXME: delay ???
-            readers->push_back(TChannelDesc{channel.Id,
-                                            false,
-                                            {MXS_LRADC_DEFAULT_SCALE_FACTOR,
-                                             MAX_ADC_VALUE,
-                                             channel.ReaderCfg,
-                                             10,
-                                             DebugLogger,
-                                             InfoLogger,
-                                             sysfsIIODir}});
-            infoLogger.Log() << "Channel " << channel.Id << " MQTT controls are created";
-        }
-    }
-
-    Device->RemoveUnusedControls(tx);
-
-    Active = true;
-    Worker = WBMQTT::MakeThread(
-        "ADC worker",
-        {[=] { AdcWorker(&Active, Device, MqttDriver, readers, InfoLogger, ErrorLogger); }});
+    InfoLogger.Log() << "Statistics is published to " << StatsDriverId << " every " << interval.count() << " ms";
+    auto mqttDriver = MqttDriver;
+    StatsWorker     = WBMQTT::MakeThread(
+        "ADC stats",
+        {[=] { StatisticsWorker(StopEvent, collector, mqttDriver, device, interval, ErrorLogger); }});
+}
+
+void TADCDriver::StartSpectrum()
+{
+    std::vector<TSpectrumChannel> channels;
+    for (size_t i = 0; i < Config.Channels.size(); ++i) {
+        const auto& channel = Config.Channels[i];
+        if (!ChannelStates[i].Spectrum) {
+            continue;
+        }
+        TSpectrumChannel spectrumChannel{ChannelStates[i].Spectrum,
+                                         TSpectrumAnalyzer(channel.Spectrum),
+                                         channel.Id + DOMINANT_FREQUENCY_SUFFIX,
+                                         {},
+                                         channel.ReaderCfg.DecimalPlaces,
+                                         std::chrono::milliseconds(channel.Spectrum.PublishIntervalMs),
+                                         std::chrono::steady_clock::now(),
+                                         0};
+        for (const auto& band : channel.Spectrum.Bands) {
+            spectrumChannel.BandIds.push_back(channel.Id + "_" + band.Id);
+        }
+        channels.push_back(std::move(spectrumChannel));
+    }
+    if (channels.empty()) {
+        return;
+    }
+    InfoLogger.Log() << "Spectrum analysis of " << channels.size() << " channels is started";
+    SpectrumStopEvent.Reset();
+    auto mqttDriver = MqttDriver;
+    auto device     = Device;
+    SpectrumWorker  = WBMQTT::MakeThread(
+        "ADC spectrum",
+        {[=] { SpectrumAnalysisWorker(SpectrumStopEvent, channels, mqttDriver, device, ErrorLogger); }});
+}
+
+void TADCDriver::StopSpectrum()
+{
+    if (SpectrumWorker) {
+        SpectrumStopEvent.Set();
+        if (SpectrumWorker->joinable()) {
+            SpectrumWorker->join();
+        }
+        SpectrumWorker.reset();
+    }
 }
 
 void TADCDriver::Stop()
 {
     {
-        std::lock_guard<std::mutex> lg(ActiveMutex);
-        if (!Active) {
+        std::lock_guard<std::mutex> lg(StopMutex);
+        if (StopEvent.IsSet()) {
             ErrorLogger.Log() << "Attempt to stop already stopped TADCDriver";
             return;
         }
-        Active = false;
+        StopEvent.Set();
     }
 
     InfoLogger.Log() << "Stopping...";
 
-    if (Worker->joinable()) {
-        Worker->join();
+    // groups are changed only by the watcher, so it is stopped first
+    if (DeviceWatcher && DeviceWatcher->joinable()) {
+        DeviceWatcher->join();
     }
-    Worker.reset();
+
+    std::unique_lock<std::mutex> groupsLock(GroupsMutex);
+
+    // all waits of workers are interrupted by their stop events, so they finish without completing current cycles
+    for (auto& group : Groups) {
+        group.second.StopEvent->Set();
+    }
+    for (auto& group : Groups) {
+        if (group.second.Thread->joinable()) {
+            group.second.Thread->join();
+        }
+    }
+    Groups.clear();
+    groupsLock.unlock();
+    if (StatsWorker && StatsWorker->joinable()) {
+        StatsWorker->join();
+    }
+    StopSpectrum();
+
+    // publish results measured before stop
+    Publisher->Stop();
+    auto stats = Publisher->GetStatistics();
+    InfoLogger.Log() << "Publisher: published " << stats.Published << " in " << stats.Batches
+                     << " transactions, coalesced " << stats.Coalesced << ", dropped " << stats.Dropped
+                     << ", blocked " << stats.Blocked;
 
     try {
         MqttDriver->BeginTx()->RemoveDeviceById(DriverId).Sync();
+        if (StatsWorker) {
+            MqttDriver->BeginTx()->RemoveDeviceById(StatsDriverId).Sync();
+        }
     } catch (const std::exception& e) {
         ErrorLogger.Log() << "Exception during TADCDriver::Stop: " << e.what();
     } catch (...) {
@@ -1,29 +1,173 @@
 #pragma once
 
 #include <functional>
+#include <wblib/rpc.h>
 #include <wblib/wbmqtt.h>
 
+#include <map>
+#include <set>
 #include <thread>
+#include <vector>
 
 #include "config.h"
+#include "iio_device_monitor.h"
+#include "publisher.h"
+#include "sample_history.h"
+#include "shm_ring_writer.h"
+#include "statistics.h"
+#include "stop_event.h"
+#include "sysfs_adc.h"
+
+struct TChannelGroup;
+class THistoryRpcHandler;
 
 class TADCDriver
 {
 public:
-    TADCDriver(const WBMQTT::PDeviceDriver& mqttDriver,
-               const TConfig&               config,
-               WBMQTT::TLogger&             errorLogger,
-               WBMQTT::TLogger&             debugLogger,
-               WBMQTT::TLogger&             infoLogger);
+    /**
+     * @brief Create MQTT controls and start sampling. Channels of IIO devices appeared later are
+     * started at runtime, channels of removed devices are stopped and marked with error.
+     *
+     * @param rpcServer Server to register history/get RPC of channels with sample history.
+     * If nullptr, the history is not available
+     * @param mqttClient Client to publish measurement time to meta/ts of controls. If nullptr,
+     * the time is not published
+     */
+    TADCDriver(const WBMQTT::PDeviceDriver&  mqttDriver,
+               const TConfig&                config,
+               WBMQTT::TLogger&              errorLogger,
+               WBMQTT::TLogger&              debugLogger,
+               WBMQTT::TLogger&              infoLogger,
+               const WBMQTT::PMqttRpcServer& rpcServer  = nullptr,
+               const WBMQTT::PMqttClient&    mqttClient = nullptr);
 
     void Stop();
 
+    /**
+     * @brief Apply reloaded configuration. Workers of IIO devices without changed channels continue
+     * sampling. Other workers are stopped between cycles and restarted, readers of their unchanged
+     * channels keep filters and publication state. Controls of added channels are created, controls
+     * of removed ones are deleted.
+     */
+    void Reload(const TConfig& config);
+
 private:
+    //! IIO device folder and acquisition mode of channels sampled by one worker
+    typedef std::pair<std::string, bool> TGroupKey;
+
+    //! Data of a channel kept while its IIO device is absent
+    struct TChannelState
+    {
+        std::shared_ptr<TReadStatistics> Statistics;
+        std::shared_ptr<TSampleStore>    History;
+        std::shared_ptr<TShmRingWriter>  SampleExport;
+        std::shared_ptr<TSpectrumInput>  Spectrum;
+    };
+
+    //! Running worker of a group
+    struct TGroupWorker
+    {
+        //! Ids of channels in order of TConfig::Channels
+        std::vector<std::string> ChannelIds;
+
+        //! Ids of virtual channels computed by the worker in order of TConfig::VirtualChannels
+        std::vector<std::string> VirtualChannelIds;
+
+        //! Length of IIO buffer, if the channels are captured through it
+        uint32_t IIOBufferLength = 0;
+
+        //! Trigger of IIO buffer, if the channels are captured through it
+        TIIOTriggerSettings Trigger;
+
+        //! Stops the worker when the device is removed
+        std::shared_ptr<TStopEvent>    StopEvent;
+        std::shared_ptr<TChannelGroup> Group;
+        std::unique_ptr<std::thread>   Thread;
+    };
+
+    //! Check if IIO devices of all sources of the virtual channel are present
+    bool HasSources(const TVirtualChannelSettings& channel);
+
+    //! Create storages of channel data according to its settings
+    TChannelState CreateChannelState(const TADCChannelSettings& channel);
+    void          CreateHistory(const TADCChannelSettings& channel, TChannelState& state);
+
+    /**
+     * @brief Start and stop workers according to present IIO devices and TConfig::Channels.
+     * Workers of groups without changes continue sampling.
+     *
+     * @param changedChannels Ids of channels whose readers must be recreated
+     */
+    void UpdateGroups(TFileContentsCache& scaleFiles, const std::set<std::string>& changedChannels = {});
+
+    /**
+     * @brief Create readers of the channels and start a worker. Returns false if the group can't be started
+     *
+     * @param virtualIndexes Indexes in TConfig::VirtualChannels of virtual channels computed from the group
+     * @param previous Stopped worker of the same group. Its readers of unchanged channels, IIO buffer
+     * and publish queue are reused. Can be nullptr
+     */
+    bool StartGroup(const TGroupKey&             key,
+                    const std::vector<size_t>&   channelIndexes,
+                    const std::vector<size_t>&   virtualIndexes,
+                    TFileContentsCache&          scaleFiles,
+                    const std::set<std::string>& changedChannels,
+                    TGroupWorker*                previous);
+
+    void StopWorker(TGroupWorker& worker);
+
+    //! Rescan IIO devices on changes until the driver is stopped
+    void WatchDevices();
+
+    //! Create wb-adc-stats device and start a thread publishing statistics of the channels
+    void CreateStatistics(std::chrono::milliseconds interval);
+
+    //! Start a low priority thread computing spectral features of channels, if a channel has spectrum settings
+    void StartSpectrum();
+    void StopSpectrum();
+
+    TConfig                      Config;
     WBMQTT::PDeviceDriver        MqttDriver;
     WBMQTT::PLocalDevice         Device;
-    bool                         Active;
-    std::mutex                   ActiveMutex;
-    std::unique_ptr<std::thread> Worker;
+
+    //! Interrupts all waits of driver threads, so Stop doesn't wait for the end of sampling cycles
+    TStopEvent                   StopEvent;
+    std::mutex                   StopMutex;
+
+    //! Guards groups and channels changed by hotplug and reload
+    std::mutex                   GroupsMutex;
+
+    TIIODeviceIndex              IIODevices;
+    std::vector<TChannelState>   ChannelStates;
+
+    //! One worker thread per IIO device, so independent ADCs are sampled concurrently
+    std::map<TGroupKey, TGroupWorker> Groups;
+
+    //! Channels of groups which can't be started. They are retried after a change of the group
+    std::map<TGroupKey, std::vector<std::string>> FailedGroups;
+
+    //! Queues of stopped groups, publisher can't remove queues
+    std::vector<TPublisher::PQueue> FreeQueues;
+
+    //! Cycle durations of groups started with the driver, statistics controls are created once
+    std::map<TGroupKey, std::shared_ptr<TLatencyHistogram>> CycleDurations;
+
+    std::shared_ptr<THistoryRpcHandler> HistoryRpc;
+
+    //! Publishes results of all workers
+    std::unique_ptr<TPublisher> Publisher;
+
+    //! Periodically publishes sampling statistics, it is created if TConfig::StatsIntervalMs > 0
+    std::unique_ptr<std::thread> StatsWorker;
+
+    //! Computes and publishes spectral features, so FFT doesn't delay sampling threads
+    std::unique_ptr<std::thread> SpectrumWorker;
+    TStopEvent                   SpectrumStopEvent;
+
+    //! Waits for IIO devices hotplug, it is not created if inotify is not available
+    std::unique_ptr<TIIODeviceMonitor> DeviceMonitor;
+    std::unique_ptr<std::thread>       DeviceWatcher;
+
     WBMQTT::TLogger&             ErrorLogger;
     WBMQTT::TLogger&             DebugLogger;
     WBMQTT::TLogger&             InfoLogger;
@@ -0,0 +1,469 @@
+#include "adc_worker.h"
+
+#include <math.h>
+
+#include "scheduler.h"
+#include "value_format.h"
+
+namespace
+{
+    //! Maximum time to wait for a scan from IIO buffer
+    const uint32_t IIO_BUFFER_READ_TIMEOUT_MS = 1000;
+
+    //! Older IIO timestamps are considered to be taken by another clock than CLOCK_REALTIME
+    const int64_t MAX_SCAN_AGE_US = 10000000;
+
+    //! Maximum time to wait for a scheduled channel before checking if the worker must stop
+    const auto SCHEDULER_MAX_WAIT = std::chrono::milliseconds(100);
+
+    //! Scheduler statistics are reported to log not more often than the interval
+    const auto SCHEDULER_REPORT_INTERVAL = std::chrono::minutes(1);
+
+    //! Error meta of a control after a failed measurement
+    const std::string READ_ERROR = "r";
+
+    //! Meta of a control with state of the channel's circuit breaker
+    const std::string BREAKER_META = "breaker";
+
+
+    /**
+     * @brief Count a failure. Returns true if it must be logged: the first failure of a series and the
+     * failure opening the breaker are logged, so a dead input gives at most one message per backoff.
+     */
+    bool RecordFailure(TCircuitBreaker& breaker)
+    {
+        auto prevState = breaker.GetState();
+        breaker.RecordFailure(TCircuitBreaker::TClock::now());
+        return breaker.GetState() == TCircuitBreaker::TState::Open ||
+               (prevState == TCircuitBreaker::TState::Closed && breaker.GetFailureCount() == 1);
+    }
+
+    void LogFailure(WBMQTT::TLogger&       logger,
+                    const TCircuitBreaker& breaker,
+                    const std::string&     error,
+                    const std::string&     name)
+    {
+        if (breaker.GetState() == TCircuitBreaker::TState::Open) {
+            logger.Log() << error << ", " << name << " is suspended for " << breaker.GetBackoff().count() << " ms";
+        } else {
+            logger.Log() << error;
+        }
+    }
+
+    void FailChannel(TChannelDesc& channel, WBMQTT::TLogger& errorLogger)
+    {
+        channel.Error = true;
+        if (RecordFailure(channel.Breaker)) {
+            LogFailure(errorLogger, channel.Breaker, channel.Reader.GetLastError(), channel.MqttId + " measurement");
+        }
+    }
+
+    void RecoverChannel(TChannelDesc& channel, WBMQTT::TLogger& infoLogger)
+    {
+        if (channel.Breaker.GetState() != TCircuitBreaker::TState::Closed) {
+            infoLogger.Log() << channel.MqttId << " is measured again after " << channel.Breaker.GetFailureCount()
+                             << " failures";
+        }
+        channel.Breaker.RecordSuccess();
+        channel.Error = false;
+    }
+
+    //! Pushes items to a queue so that all of them are published in one transaction
+    class TTransactionBuilder
+    {
+    public:
+        TTransactionBuilder(TPublisher::TQueue& queue) : Queue(queue), HasPending(false) {}
+
+        //! The last item is pushed without More flag
+        ~TTransactionBuilder()
+        {
+            if (HasPending) {
+                Queue.Push(std::move(Pending));
+            }
+        }
+
+        template<class... TArgs> void Add(TArgs&... args)
+        {
+            // an item is pushed when the next one is known, so only the last item has no More flag
+            TPublishItem item;
+            if (!MakePublishItem(args..., item)) {
+                return;
+            }
+            if (HasPending) {
+                Pending.More = true;
+                Queue.Push(std::move(Pending));
+            }
+            Pending    = std::move(item);
+            HasPending = true;
+        }
+
+    private:
+        TPublisher::TQueue& Queue;
+        TPublishItem        Pending;
+        bool                HasPending;
+    };
+
+    void LogPublishStatistics(WBMQTT::TLogger& logger, const TChannelGroup& group)
+    {
+        for (const auto& channel : group.Channels) {
+            logger.Log() << channel.MqttId << ": published " << channel.Publisher.GetPublishedCount()
+                         << ", suppressed " << channel.Publisher.GetSuppressedCount();
+        }
+    }
+
+    void LogSchedulerStatistics(WBMQTT::TLogger&                 logger,
+                                const std::string&               sysfsIIODir,
+                                const TScheduler::TStatistics&   stats)
+    {
+        logger.Log() << "Scheduler of " << sysfsIIODir << ": runs " << stats.Runs << ", missed deadlines "
+                     << stats.MissedDeadlines << ", average lateness "
+                     << (stats.Runs ? stats.TotalLateness.count() / stats.Runs : 0) << " us, max lateness "
+                     << stats.MaxLateness.count() << " us";
+    }
+
+    void RecordCycle(TChannelGroup& group, std::chrono::steady_clock::time_point start)
+    {
+        if (group.CycleDuration) {
+            group.CycleDuration->Record(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    void BufferedWorker(const TStopEvent&              stopEvent,
+                        std::shared_ptr<TChannelGroup> group,
+                        WBMQTT::TLogger&               infoLogger,
+                        WBMQTT::TLogger&               errorLogger)
+    {
+        // cycles of a buffer fired by the driver are scheduled like sysfs polling
+        std::unique_ptr<TScheduler> scheduler;
+        if (group->PollInterval.count()) {
+            scheduler.reset(new TScheduler(&stopEvent));
+            scheduler->AddTask(0, group->PollInterval);
+        }
+        while (!stopEvent.IsSet()) {
+            size_t id;
+            if (scheduler && !scheduler->WaitNext(id, SCHEDULER_MAX_WAIT)) {
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            MeasureBuffered(*group, stopEvent, infoLogger, errorLogger);
+            if (stopEvent.IsSet()) {
+                break;
+            }
+            PublishGroup(*group);
+            RecordCycle(*group, start);
+        }
+    }
+
+    void SysfsWorker(const TStopEvent&              stopEvent,
+                     std::shared_ptr<TChannelGroup> group,
+                     WBMQTT::TLogger&               infoLogger,
+                     WBMQTT::TLogger&               errorLogger)
+    {
+        TScheduler scheduler(&stopEvent);
+        for (size_t i = 0; i < group->Channels.size(); ++i) {
+            scheduler.AddTask(i, group->Channels[i].PollInterval);
+        }
+
+        auto     lastReport     = TScheduler::TClock::now();
+        uint64_t reportedMissed = 0;
+        while (!stopEvent.IsSet()) {
+            size_t i;
+            if (scheduler.WaitNext(i, SCHEDULER_MAX_WAIT)) {
+                auto  start   = std::chrono::steady_clock::now();
+                auto& channel = group->Channels[i];
+                MeasureSysfs(channel, infoLogger, errorLogger);
+                // measurement interrupted by stop has no result
+                if (stopEvent.IsSet()) {
+                    break;
+                }
+                // the suspended channel isn't woken up until its probe
+                if (channel.Breaker.GetState() == TCircuitBreaker::TState::Open) {
+                    scheduler.Postpone(i, channel.Breaker.GetRetryTime());
+                }
+                PublishChannel(*group, i);
+                RecordCycle(*group, start);
+            }
+
+            const auto& stats = scheduler.GetStatistics();
+            if (stats.MissedDeadlines != reportedMissed &&
+                TScheduler::TClock::now() - lastReport >= SCHEDULER_REPORT_INTERVAL)
+            {
+                infoLogger.Log() << "Channels of " << group->SysfsIIODir
+                                 << " can't be measured in time, poll intervals are too short";
+                LogSchedulerStatistics(infoLogger, group->SysfsIIODir, stats);
+                lastReport     = TScheduler::TClock::now();
+                reportedMissed = stats.MissedDeadlines;
+            }
+        }
+        LogSchedulerStatistics(infoLogger, group->SysfsIIODir, scheduler.GetStatistics());
+    }
+} // namespace
+
+void MeasureSysfs(TChannelDesc& channel, WBMQTT::TLogger& infoLogger, WBMQTT::TLogger& errorLogger)
+{
+    if (!channel.Breaker.AllowRequest(TCircuitBreaker::TClock::now())) {
+        return;
+    }
+    switch (channel.Reader.Measure(channel.MqttId + " ")) {
+        case TMeasureStatus::Ok:
+        case TMeasureStatus::NotReady:
+            RecoverChannel(channel, infoLogger);
+            break;
+        case TMeasureStatus::ReadError:
+        case TMeasureStatus::Overflow:
+            FailChannel(channel, errorLogger);
+            break;
+        case TMeasureStatus::Interrupted:
+            break;
+    }
+}
+
+void MeasureBuffered(TChannelGroup&     group,
+                     const TStopEvent&  stopEvent,
+                     WBMQTT::TLogger&   infoLogger,
+                     WBMQTT::TLogger&   errorLogger)
+{
+    auto& breaker = group.BufferBreaker;
+    auto  start   = TCircuitBreaker::TClock::now();
+    if (!breaker.AllowRequest(start)) {
+        stopEvent.WaitFor(std::chrono::duration_cast<std::chrono::microseconds>(breaker.GetRetryTime() - start));
+        return;
+    }
+    for (uint32_t i = 0; i < group.ReadingsNumber; ++i) {
+        bool fired = !group.Trigger || !group.Trigger->NeedsFiring() || group.Trigger->Fire();
+        if (!fired || !group.Buffer->ReadScan(group.Values, IIO_BUFFER_READ_TIMEOUT_MS)) {
+            if (stopEvent.IsSet()) {
+                return;
+            }
+            bool logged = RecordFailure(breaker);
+            for (auto& channel : group.Channels) {
+                // the channels share the state of the buffer, so their controls show it
+                channel.Error   = true;
+                channel.Breaker = breaker;
+                const auto& stats = channel.Reader.GetStatistics();
+                if (stats) {
+                    stats->Errors.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (logged) {
+                LogFailure(errorLogger, breaker, "Can't read scan from IIO buffer of " + group.SysfsIIODir, "reading");
+            }
+            return;
+        }
+        // IIO timestamps are in CLOCK_REALTIME by default, the time of reading is used if the device has no timestamps.
+        // Monotonic time of the scan is shifted back by the age of IIO timestamp
+        auto    sampleTime  = TChannelReader::TClock::now();
+        auto    now         = std::chrono::system_clock::now().time_since_epoch();
+        int64_t nowUs       = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        int64_t timestampUs = group.Buffer->GetTimestamp() / 1000;
+        if (timestampUs == 0) {
+            timestampUs = nowUs;
+        } else if (timestampUs < nowUs && nowUs - timestampUs < MAX_SCAN_AGE_US) {
+            sampleTime -= std::chrono::microseconds(nowUs - timestampUs);
+        }
+        for (size_t n = 0; n < group.Channels.size(); ++n) {
+            group.Channels[n].Reader.AddSample(group.Values[n], timestampUs, sampleTime, group.Channels[n].MqttId + " ");
+        }
+    }
+    if (breaker.GetState() != TCircuitBreaker::TState::Closed) {
+        infoLogger.Log() << "IIO buffer of " << group.SysfsIIODir << " is read again";
+    }
+    breaker.RecordSuccess();
+
+    auto now = TCircuitBreaker::TClock::now();
+    for (auto& channel : group.Channels) {
+        if (!channel.Breaker.AllowRequest(now)) {
+            continue;
+        }
+        if (channel.Reader.ConvertValue(channel.MqttId + " ") == TMeasureStatus::Overflow) {
+            FailChannel(channel, errorLogger);
+        } else {
+            RecoverChannel(channel, infoLogger);
+        }
+    }
+}
+
+bool MakePublishItem(TChannelDesc& channel, TPublishItem& item)
+{
+    auto now = TPublishPolicy::TClock::now();
+    if (channel.Error) {
+        if (!channel.Publisher.ShouldPublishError(now, READ_ERROR)) {
+            return false;
+        }
+        item.ControlId = channel.MqttId;
+        item.Value     = READ_ERROR;
+        item.Error     = true;
+    } else {
+        const std::string& value = channel.Reader.GetValue();
+        if (!channel.Publisher.ShouldPublishValue(channel.Reader.GetNumericValue(), value, now)) {
+            return false;
+        }
+        item.ControlId = channel.MqttId;
+        item.Value     = value;
+        item.Error     = false;
+    }
+    item.TimestampMs = 0;
+    if (channel.PublishTimestamp && !channel.Error) {
+        // the measurement time is monotonic, its age is subtracted from the system time
+        auto time        = std::chrono::system_clock::now() - (now - channel.Reader.GetMeasurementTime());
+        item.TimestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    }
+    item.More = false;
+    return true;
+}
+
+bool MakePublishItem(TVirtualChannelDesc& channel, TPublishItem& item)
+{
+    if (!channel.Ready) {
+        return false;
+    }
+    auto now = TPublishPolicy::TClock::now();
+    if (channel.Error) {
+        if (!channel.Publisher.ShouldPublishError(now, READ_ERROR)) {
+            return false;
+        }
+        item.Value = READ_ERROR;
+    } else {
+        if (!channel.Publisher.ShouldPublishValue(channel.Value, channel.Text, now)) {
+            return false;
+        }
+        item.Value = channel.Text;
+    }
+    item.ControlId   = channel.MqttId;
+    item.Error       = channel.Error;
+    item.TimestampMs = 0;
+    item.More        = false;
+    return true;
+}
+
+bool MakePublishItem(TChannelDesc& channel, TAcControlDesc& control, TPublishItem& item)
+{
+    auto now = TPublishPolicy::TClock::now();
+    if (channel.Error) {
+        if (!control.Publisher.ShouldPublishError(now, READ_ERROR)) {
+            return false;
+        }
+        item.Value = READ_ERROR;
+    } else {
+        // the channel hasn't been measured yet
+        if (channel.Reader.GetValue().empty()) {
+            return false;
+        }
+        const std::string& value = channel.Reader.GetAcText(control.Quantity);
+        if (!control.Publisher.ShouldPublishValue(channel.Reader.GetAcValue(control.Quantity), value, now)) {
+            return false;
+        }
+        item.Value = value;
+    }
+    item.ControlId   = control.MqttId;
+    item.Error       = channel.Error;
+    item.TimestampMs = 0;
+    item.More        = false;
+    return true;
+}
+
+bool MakePublishItem(TChannelDesc& channel, TBreakerMetaDesc& meta, TPublishItem& item)
+{
+    auto state = channel.Breaker.GetState();
+    if (meta.Published && meta.PublishedState == state) {
+        return false;
+    }
+    meta.Published      = true;
+    meta.PublishedState = state;
+    item.ControlId      = channel.MqttId;
+    item.Value          = GetStateName(state);
+    item.Error          = false;
+    item.TimestampMs    = 0;
+    item.More           = false;
+    item.Meta           = BREAKER_META;
+    return true;
+}
+
+void EvaluateVirtualChannel(const TChannelGroup& group, TVirtualChannelDesc& channel)
+{
+    channel.Ready = true;
+    channel.Error = false;
+    for (size_t i = 0; i < channel.Sources.size(); ++i) {
+        const auto& source = group.Channels[channel.Sources[i]];
+        if (source.Error) {
+            channel.Error = true;
+        } else if (source.Reader.GetValue().empty()) {
+            channel.Ready = false;
+        }
+        channel.Inputs[i] = source.Reader.GetNumericValue();
+    }
+    if (channel.Error || !channel.Ready) {
+        return;
+    }
+    channel.Value = channel.Expression->Evaluate(channel.Inputs.data(), channel.Stack.data());
+    if (!std::isfinite(channel.Value)) {
+        channel.Error = true;
+        return;
+    }
+    // Text keeps its capacity, so formatting doesn't allocate memory after the first evaluation
+    FormatDecimal(channel.Value, channel.DecimalPlaces, channel.Text);
+}
+
+void PublishChannel(TPublisher::TQueue& queue, TChannelDesc& channel)
+{
+    TPublishItem item;
+    if (MakePublishItem(channel, item)) {
+        queue.Push(std::move(item));
+    }
+}
+
+void PublishChannel(TChannelGroup& group, size_t channelIndex)
+{
+    auto&       channel        = group.Channels[channelIndex];
+    const auto& breaker        = channel.BreakerMeta;
+    bool        breakerChanged = !breaker.Published || breaker.PublishedState != channel.Breaker.GetState();
+    if (channel.VirtualChannels.empty() && channel.AcControls.empty() && !breakerChanged) {
+        PublishChannel(*group.PublishQueue, channel);
+        return;
+    }
+    TTransactionBuilder tx(*group.PublishQueue);
+    tx.Add(channel);
+    tx.Add(channel, channel.BreakerMeta);
+    for (auto& control : channel.AcControls) {
+        tx.Add(channel, control);
+    }
+    for (auto i : channel.VirtualChannels) {
+        EvaluateVirtualChannel(group, group.VirtualChannels[i]);
+        tx.Add(group.VirtualChannels[i]);
+    }
+}
+
+void PublishGroup(TChannelGroup& group)
+{
+    TTransactionBuilder tx(*group.PublishQueue);
+    for (auto& channel : group.Channels) {
+        tx.Add(channel);
+        tx.Add(channel, channel.BreakerMeta);
+        for (auto& control : channel.AcControls) {
+            tx.Add(channel, control);
+        }
+    }
+    for (auto& channel : group.VirtualChannels) {
+        EvaluateVirtualChannel(group, channel);
+        tx.Add(channel);
+    }
+}
+
+void AdcWorker(const TStopEvent&              stopEvent,
+               std::shared_ptr<TChannelGroup> group,
+               WBMQTT::TLogger&               infoLogger,
+               WBMQTT::TLogger&               errorLogger)
+{
+    infoLogger.Log() << "ADC worker thread for " << group->SysfsIIODir << " is started";
+    try {
+        if (group->Buffer) {
+            BufferedWorker(stopEvent, group, infoLogger, errorLogger);
+        } else {
+            SysfsWorker(stopEvent, group, infoLogger, errorLogger);
+        }
+    } catch (const std::exception& e) {
+        errorLogger.Log() << "ADC worker thread for " << group->SysfsIIODir << " failed: " << e.what();
+    }
+    LogPublishStatistics(infoLogger, *group);
+    infoLogger.Log() << "ADC worker thread for " << group->SysfsIIODir << " is stopped";
+}
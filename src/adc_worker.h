@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wblib/log.h>
+
+#include "circuit_breaker.h"
+#include "expression.h"
+#include "iio_buffer.h"
+#include "iio_trigger.h"
+#include "publish_policy.h"
+#include "publisher.h"
+#include "statistics.h"
+#include "stop_event.h"
+#include "sysfs_adc.h"
+
+//! Additional control of AC channel with a quantity of the signal
+struct TAcControlDesc
+{
+    std::string MqttId;
+    TAcQuantity Quantity;
+
+    //! Decides which values of the quantity are published
+    TPublishPolicy Publisher;
+};
+
+//! State of the channel's circuit breaker published to meta/breaker: "closed", "open" or "half-open"
+struct TBreakerMetaDesc
+{
+    //! The state is published on changes only
+    bool                    Published      = false;
+    TCircuitBreaker::TState PublishedState = TCircuitBreaker::TState::Closed;
+};
+
+//! Channel sampled by a worker
+struct TChannelDesc
+{
+    std::string    MqttId;
+    bool           Error;
+    TChannelReader Reader;
+
+    //! Interval between channel's measurements. If 0, the channel is measured continuously
+    std::chrono::milliseconds PollInterval;
+
+    //! Decides which measurements are published
+    TPublishPolicy Publisher;
+
+    //! Suspends measurements of the failing channel
+    TCircuitBreaker Breaker;
+
+    //! Indexes in TChannelGroup::VirtualChannels of virtual channels computed from the channel
+    std::vector<size_t> VirtualChannels;
+
+    //! Controls of AC signal quantities, empty if AC mode is disabled
+    std::vector<TAcControlDesc> AcControls;
+
+    //! Publish measurement time of values with them
+    bool PublishTimestamp = false;
+
+    TBreakerMetaDesc BreakerMeta;
+};
+
+//! Control computed from channels of a group right after their measurement
+struct TVirtualChannelDesc
+{
+    std::string MqttId;
+
+    std::shared_ptr<const TExpression> Expression;
+
+    //! Indexes in TChannelGroup::Channels of variables of the expression
+    std::vector<size_t> Sources;
+
+    //! Number of digits after point in published value
+    uint32_t DecimalPlaces;
+
+    //! Decides which computed values are published
+    TPublishPolicy Publisher;
+
+    //! A source has failed or the result is not finite
+    bool Error = false;
+
+    //! All sources have been measured
+    bool Ready = false;
+
+    double      Value = 0;
+    std::string Text;
+
+    //! Preallocated buffers, so evaluation doesn't allocate memory
+    std::vector<double> Inputs;
+    std::vector<double> Stack;
+};
+
+/*! Channels of one IIO device sampled by a dedicated worker thread.
+    All channels of the group are either polled through sysfs or captured through IIO buffer.
+*/
+struct TChannelGroup
+{
+    std::string               SysfsIIODir;
+    std::vector<TChannelDesc> Channels;
+
+    //! Virtual channels with all sources in the group
+    std::vector<TVirtualChannelDesc> VirtualChannels;
+
+    //! Trigger of IIO buffer, nullptr if the device's trigger is not changed. It outlives the buffer
+    std::unique_ptr<TIIOTrigger> Trigger;
+
+    //! IIO buffer of the device, if the channels are captured through it
+    std::unique_ptr<TIIOBuffer> Buffer;
+
+    //! Interval between cycles of a buffer fired by the driver. If 0, cycles follow one another
+    std::chrono::milliseconds PollInterval{0};
+
+    //! Number of scans to read from IIO buffer during one cycle. Every scan is added to all channels
+    uint32_t ReadingsNumber = 1;
+
+    //! Decoded values of the last scan
+    std::vector<int32_t> Values;
+
+    //! Suspends reading of IIO buffer after failed scans
+    TCircuitBreaker BufferBreaker;
+
+    //! Measurement results of the group waiting for publication
+    TPublisher::PQueue PublishQueue;
+
+    //! Duration of measurement and publication of a channel or a scan, nullptr if it is not collected
+    std::shared_ptr<TLatencyHistogram> CycleDuration;
+};
+
+/**
+ * @brief Measure channel through sysfs unless its circuit breaker is open. Errors are stored in
+ * channel.Error and logged when a series of failures starts and when the breaker opens.
+ */
+void MeasureSysfs(TChannelDesc& channel, WBMQTT::TLogger& infoLogger, WBMQTT::TLogger& errorLogger);
+
+/**
+ * @brief Read ReadingsNumber scans from IIO buffer of the group and convert values of all its channels.
+ * The group's trigger is fired before every scan if needed. All channels get the scan's timestamp.
+ * After failed scans the buffer is not read until the backoff of the group's breaker is over.
+ */
+void MeasureBuffered(TChannelGroup&     group,
+                     const TStopEvent&  stopEvent,
+                     WBMQTT::TLogger&   infoLogger,
+                     WBMQTT::TLogger&   errorLogger);
+
+/**
+ * @brief Compute the virtual channel from the last measurement results of its sources. It gets an error
+ * if a source has failed. The value is not ready until all sources are measured.
+ */
+void EvaluateVirtualChannel(const TChannelGroup& group, TVirtualChannelDesc& channel);
+
+/**
+ * @brief Make publication of the last measurement result of the channel if the publish policy allows it.
+ * Error meta is "r" after a failed measurement, the breaker state is published to meta/breaker.
+ * A value of a channel with PublishTimestamp gets its measurement time converted to the system clock.
+ *
+ * @return false Nothing is to be published
+ */
+bool MakePublishItem(TChannelDesc& channel, TPublishItem& item);
+
+//! Make publication of the last computed value of the virtual channel if the publish policy allows it
+bool MakePublishItem(TVirtualChannelDesc& channel, TPublishItem& item);
+
+//! Make publication of the quantity of AC channel's last measurement if the publish policy allows it
+bool MakePublishItem(TChannelDesc& channel, TAcControlDesc& control, TPublishItem& item);
+
+//! Make publication of the state of channel's circuit breaker if it has changed since the last publication
+bool MakePublishItem(TChannelDesc& channel, TBreakerMetaDesc& meta, TPublishItem& item);
+
+//! Push the last measurement result of the channel to the queue if the publish policy allows it
+void PublishChannel(TPublisher::TQueue& queue, TChannelDesc& channel);
+
+/**
+ * @brief Compute virtual channels depending on the channel and push results of the channel, its AC
+ * controls, breaker state and the virtual channels to the group's queue to be published in one transaction
+ */
+void PublishChannel(TChannelGroup& group, size_t channelIndex);
+
+/**
+ * @brief Compute virtual channels of the group and push results of all channels of the group to its
+ * queue to be published in one transaction
+ */
+void PublishGroup(TChannelGroup& group);
+
+/**
+ * @brief Sample channels of the group and push results to its publish queue until the stop event is set.
+ * Channels captured through IIO buffer are read scan by scan, others are polled by a deadline scheduler.
+ */
+void AdcWorker(const TStopEvent&              stopEvent,
+               std::shared_ptr<TChannelGroup> group,
+               WBMQTT::TLogger&               infoLogger,
+               WBMQTT::TLogger&               errorLogger);
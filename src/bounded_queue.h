@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free bounded queue based on cells with sequence numbers (D. Vyukov's algorithm).
+ * Every cell is claimed by a position counter before its data is touched, so several threads may
+ * pop concurrently. It allows a single producer to drop the oldest element of a full queue while
+ * a consumer is reading from it.
+ *
+ * @tparam T Type of elements
+ */
+template <class T> class TBoundedQueue
+{
+public:
+    /**
+     * @brief Construct a new TBoundedQueue object
+     *
+     * @param capacity Maximum number of elements. It is rounded up to a power of two
+     */
+    explicit TBoundedQueue(size_t capacity) : EnqueuePos(0), DequeuePos(0)
+    {
+        if (capacity == 0) {
+            throw std::runtime_error("Queue capacity can't be zero");
+        }
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        Mask = size - 1;
+        Cells.reset(new TCell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            Cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    TBoundedQueue(const TBoundedQueue&) = delete;
+    TBoundedQueue& operator=(const TBoundedQueue&) = delete;
+
+    /**
+     * @brief Add an element to the end of the queue
+     *
+     * @return true The element is added
+     * @return false The queue is full
+     */
+    bool TryPush(T&& item)
+    {
+        size_t pos = EnqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            TCell&   cell = Cells[pos & Mask];
+            size_t   seq  = cell.Sequence.load(std::memory_order_acquire);
+            intptr_t dif  = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.Data = std::move(item);
+                    cell.Sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = EnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Remove an element from the beginning of the queue
+     *
+     * @return true The element is removed and returned in item
+     * @return false The queue is empty
+     */
+    bool TryPop(T& item)
+    {
+        size_t pos = DequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            TCell&   cell = Cells[pos & Mask];
+            size_t   seq  = cell.Sequence.load(std::memory_order_acquire);
+            intptr_t dif  = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (dif == 0) {
+                if (DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.Data);
+                    cell.Sequence.store(pos + Mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = DequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! Approximate number of elements in the queue
+    size_t Size() const
+    {
+        size_t enqueuePos = EnqueuePos.load(std::memory_order_relaxed);
+        size_t dequeuePos = DequeuePos.load(std::memory_order_relaxed);
+        return (enqueuePos > dequeuePos) ? enqueuePos - dequeuePos : 0;
+    }
+
+    size_t Capacity() const
+    {
+        return Mask + 1;
+    }
+
+private:
+    struct TCell
+    {
+        std::atomic<size_t> Sequence;
+        T                   Data;
+    };
+
+    std::unique_ptr<TCell[]> Cells;
+    size_t                   Mask;
+
+    // positions are modified by different threads, keep them in different cache lines
+    std::atomic<size_t> EnqueuePos;
+    char                Padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> DequeuePos;
+};
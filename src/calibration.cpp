@@ -0,0 +1,160 @@
+#include "calibration.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    const double ZERO_CELSIUS = 273.15;
+
+    double ApplyTable(const std::vector<std::pair<double, double>>& points, double input)
+    {
+        if (input <= points.front().first) {
+            return points.front().second;
+        }
+        if (input >= points.back().first) {
+            return points.back().second;
+        }
+        auto it = std::upper_bound(points.begin(),
+                                   points.end(),
+                                   input,
+                                   [](double v, const std::pair<double, double>& p) { return v < p.first; });
+        const auto& p1 = *(it - 1);
+        const auto& p2 = *it;
+        return p1.second + (p2.second - p1.second) * (input - p1.first) / (p2.first - p1.first);
+    }
+
+    double ApplyPolynomial(const std::vector<double>& coefficients, double input)
+    {
+        double res = 0;
+        for (auto it = coefficients.rbegin(); it != coefficients.rend(); ++it) {
+            res = res * input + *it;
+        }
+        return res;
+    }
+
+    double ApplySteinhartHart(const TConversionStage& stage, double input)
+    {
+        if (input <= 0 || input >= stage.SupplyVoltage) {
+            return NAN;
+        }
+        double r = stage.NtcToGround ? stage.SeriesResistance * input / (stage.SupplyVoltage - input)
+                                     : stage.SeriesResistance * (stage.SupplyVoltage - input) / input;
+        double lnR = log(r);
+        double invT = stage.A + stage.B * lnR + stage.C * lnR * lnR * lnR;
+        if (invT <= 0) {
+            return NAN;
+        }
+        return 1.0 / invT - ZERO_CELSIUS;
+    }
+} // namespace
+
+TConversionType ParseConversionType(const std::string& name)
+{
+    if (name == "table") {
+        return TConversionType::Table;
+    }
+    if (name == "polynomial") {
+        return TConversionType::Polynomial;
+    }
+    if (name == "steinhart_hart") {
+        return TConversionType::SteinhartHart;
+    }
+    throw std::runtime_error("Unknown conversion type: " + name);
+}
+
+bool operator==(const TConversionStage& a, const TConversionStage& b)
+{
+    return std::tie(a.Type, a.Points, a.Coefficients, a.A, a.B, a.C, a.SupplyVoltage, a.SeriesResistance, a.NtcToGround) ==
+           std::tie(b.Type, b.Points, b.Coefficients, b.A, b.B, b.C, b.SupplyVoltage, b.SeriesResistance, b.NtcToGround);
+}
+
+void CheckConversionStage(const TConversionStage& stage)
+{
+    switch (stage.Type) {
+        case TConversionType::Table: {
+            if (stage.Points.size() < 2) {
+                throw std::runtime_error("Conversion table must have at least 2 points");
+            }
+            for (size_t i = 1; i < stage.Points.size(); ++i) {
+                if (stage.Points[i].first <= stage.Points[i - 1].first) {
+                    throw std::runtime_error("Inputs of conversion table must be strictly increasing");
+                }
+            }
+            break;
+        }
+        case TConversionType::Polynomial: {
+            if (stage.Coefficients.empty()) {
+                throw std::runtime_error("Polynomial conversion must have coefficients");
+            }
+            break;
+        }
+        case TConversionType::SteinhartHart: {
+            if (stage.SupplyVoltage <= 0 || stage.SeriesResistance <= 0) {
+                throw std::runtime_error("Supply voltage and series resistance of NTC divider must be positive");
+            }
+            break;
+        }
+    }
+}
+
+double ApplyConversion(const TConversionStage& stage, double input)
+{
+    switch (stage.Type) {
+        case TConversionType::Table:
+            return ApplyTable(stage.Points, input);
+        case TConversionType::Polynomial:
+            return ApplyPolynomial(stage.Coefficients, input);
+        case TConversionType::SteinhartHart:
+            return ApplySteinhartHart(stage, input);
+    }
+    return NAN;
+}
+
+double ApplyConversion(const std::vector<TConversionStage>& stages, double input)
+{
+    for (const auto& stage : stages) {
+        input = ApplyConversion(stage, input);
+    }
+    return input;
+}
+
+TConversionTable::TConversionTable(const std::vector<TConversionStage>& stages, uint32_t maxCode, double codeToVolts)
+{
+    Values.resize(static_cast<size_t>(maxCode) + 1);
+    for (size_t code = 0; code < Values.size(); ++code) {
+        Values[code] = ApplyConversion(stages, code * codeToVolts);
+    }
+}
+
+bool TConversionTable::Convert(int64_t fixedPointCode, uint32_t fractionalBits, double& res) const
+{
+    if (fixedPointCode < 0) {
+        return false;
+    }
+    uint64_t code = static_cast<uint64_t>(fixedPointCode) >> fractionalBits;
+    if (code >= Values.size()) {
+        return false;
+    }
+    res = Values[code];
+    uint64_t fraction = static_cast<uint64_t>(fixedPointCode) & ((1ULL << fractionalBits) - 1);
+    if (fraction != 0) {
+        if (code + 1 >= Values.size()) {
+            return false;
+        }
+        res += (Values[code + 1] - res) * std::ldexp(static_cast<double>(fraction), -static_cast<int>(fractionalBits));
+    }
+    return std::isfinite(res);
+}
+
+double TConversionTable::Get(uint32_t code) const
+{
+    return Values[code];
+}
+
+size_t TConversionTable::GetSize() const
+{
+    return Values.size();
+}
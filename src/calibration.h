@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Types of conversion stages of a channel value
+enum class TConversionType
+{
+    //! Piecewise-linear table
+    Table,
+
+    //! Polynomial of the input
+    Polynomial,
+
+    //! Temperature of NTC thermistor in a voltage divider by Steinhart–Hart equation
+    SteinhartHart
+};
+
+/**
+ * @brief Get conversion type by its name from config. Throws std::runtime_error on unknown name.
+ *
+ * @param name "table", "polynomial" or "steinhart_hart"
+ */
+TConversionType ParseConversionType(const std::string& name);
+
+//! Stage of non-linear conversion of a channel value. The first stage gets the value in V
+struct TConversionStage
+{
+    TConversionType Type = TConversionType::Polynomial;
+
+    /*! Table points (input, output) sorted by input. Inputs between points are interpolated linearly,
+        inputs outside the table get output of the nearest point
+    */
+    std::vector<std::pair<double, double>> Points;
+
+    //! Polynomial coefficients, Coefficients[i] is multiplied by input^i
+    std::vector<double> Coefficients;
+
+    //! Steinhart–Hart coefficients: 1/T = A + B*ln(R) + C*ln(R)^3, T in K, R in Ohm
+    double A = 0;
+    double B = 0;
+    double C = 0;
+
+    //! Voltage applied to the divider in V
+    double SupplyVoltage = 3.3;
+
+    //! Resistance of the fixed resistor of the divider in Ohm
+    double SeriesResistance = 10000;
+
+    //! The thermistor is between the ADC input and the ground, otherwise it is between the supply and the input
+    bool NtcToGround = true;
+};
+
+bool operator==(const TConversionStage& a, const TConversionStage& b);
+
+/**
+ * @brief Check if parameters of the stage are usable. Throws std::runtime_error describing the problem.
+ */
+void CheckConversionStage(const TConversionStage& stage);
+
+/**
+ * @brief Convert value by the stage analytically.
+ *
+ * @return double Converted value, NaN if the input is out of the stage's domain
+ */
+double ApplyConversion(const TConversionStage& stage, double input);
+
+//! Convert value by all stages one after another
+double ApplyConversion(const std::vector<TConversionStage>& stages, double input);
+
+/**
+ * @brief Conversion stages compiled into a dense table indexed by ADC code, so a conversion costs
+ * one indexed load. Fractional codes of oversampled values are interpolated between adjacent entries.
+ */
+class TConversionTable
+{
+public:
+    /**
+     * @brief Compute results of the stages for all codes from 0 to maxCode
+     *
+     * @param stages Conversion stages, their input is code * codeToVolts
+     * @param maxCode Maximum ADC code
+     * @param codeToVolts Multiplier of ADC code to get value in V
+     */
+    TConversionTable(const std::vector<TConversionStage>& stages, uint32_t maxCode, double codeToVolts);
+
+    /**
+     * @brief Convert filtered ADC value.
+     *
+     * @param fixedPointCode ADC code with fractionalBits fractional bits
+     * @param fractionalBits Number of fractional bits of the code
+     * @param res Converted value
+     * @return false The code is out of the table or the stages are undefined for it
+     */
+    bool Convert(int64_t fixedPointCode, uint32_t fractionalBits, double& res) const;
+
+    //! Converted value of the integer code. The code must not exceed maxCode
+    double Get(uint32_t code) const;
+
+    //! Number of entries
+    size_t GetSize() const;
+
+private:
+    std::vector<double> Values;
+};
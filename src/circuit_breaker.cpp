@@ -0,0 +1,75 @@
+#include "circuit_breaker.h"
+
+#include <algorithm>
+
+TCircuitBreaker::TCircuitBreaker() : TCircuitBreaker(TSettings())
+{}
+
+TCircuitBreaker::TCircuitBreaker(const TSettings& settings)
+    : Settings(settings), State(TState::Closed), FailureCount(0), Backoff(0)
+{}
+
+bool TCircuitBreaker::AllowRequest(const TClock::time_point& now)
+{
+    if (State == TState::Open) {
+        if (now < RetryTime) {
+            return false;
+        }
+        State = TState::HalfOpen;
+    }
+    return true;
+}
+
+void TCircuitBreaker::RecordSuccess()
+{
+    State        = TState::Closed;
+    FailureCount = 0;
+    Backoff      = std::chrono::milliseconds(0);
+}
+
+void TCircuitBreaker::RecordFailure(const TClock::time_point& now)
+{
+    ++FailureCount;
+    if (State == TState::HalfOpen) {
+        Backoff = std::min(Backoff * 2, Settings.MaxBackoff);
+    } else if (State == TState::Closed && FailureCount >= Settings.FailureThreshold) {
+        Backoff = std::min(Settings.InitialBackoff, Settings.MaxBackoff);
+    } else {
+        return;
+    }
+    State     = TState::Open;
+    RetryTime = now + Backoff;
+}
+
+TCircuitBreaker::TState TCircuitBreaker::GetState() const
+{
+    return State;
+}
+
+uint32_t TCircuitBreaker::GetFailureCount() const
+{
+    return FailureCount;
+}
+
+std::chrono::milliseconds TCircuitBreaker::GetBackoff() const
+{
+    return Backoff;
+}
+
+TCircuitBreaker::TClock::time_point TCircuitBreaker::GetRetryTime() const
+{
+    return RetryTime;
+}
+
+const char* GetStateName(TCircuitBreaker::TState state)
+{
+    switch (state) {
+        case TCircuitBreaker::TState::Closed:
+            return "closed";
+        case TCircuitBreaker::TState::Open:
+            return "open";
+        case TCircuitBreaker::TState::HalfOpen:
+            return "half-open";
+    }
+    return "";
+}
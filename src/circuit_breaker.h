@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+/**
+ * @brief Circuit breaker with exponential backoff for a failing input.
+ *
+ * Closed - requests are allowed, consecutive failures are counted. After FailureThreshold failures
+ * the breaker opens. Open - requests are rejected until the backoff is over. The first request after
+ * that is a probe (half-open state): its success closes the breaker, its failure opens it again
+ * with twice longer backoff limited by MaxBackoff.
+ */
+class TCircuitBreaker
+{
+public:
+    typedef std::chrono::steady_clock TClock;
+
+    enum class TState
+    {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    struct TSettings
+    {
+        //! Number of consecutive failures opening the breaker
+        uint32_t FailureThreshold = 3;
+
+        //! Backoff after the breaker is opened by consecutive failures
+        std::chrono::milliseconds InitialBackoff{1000};
+
+        //! Maximum backoff after failed probes
+        std::chrono::milliseconds MaxBackoff{60000};
+    };
+
+    //! Breaker with default settings
+    TCircuitBreaker();
+
+    explicit TCircuitBreaker(const TSettings& settings);
+
+    /**
+     * @brief Check if a request can be done. Open breaker becomes half-open if its backoff is over.
+     *
+     * @param now Request time
+     */
+    bool AllowRequest(const TClock::time_point& now);
+
+    //! Close the breaker and reset the backoff
+    void RecordSuccess();
+
+    /**
+     * @brief Count failed request. The breaker is opened if it is half-open or the failure threshold is reached.
+     *
+     * @param now Request time, the backoff starts from it
+     */
+    void RecordFailure(const TClock::time_point& now);
+
+    TState GetState() const;
+
+    //! Number of consecutive failures
+    uint32_t GetFailureCount() const;
+
+    //! Current backoff, 0 if the breaker has not been opened since the last success
+    std::chrono::milliseconds GetBackoff() const;
+
+    //! Time when open breaker allows a probe
+    TClock::time_point GetRetryTime() const;
+
+private:
+    TSettings                 Settings;
+    TState                    State;
+    uint32_t                  FailureCount;
+    std::chrono::milliseconds Backoff;
+    TClock::time_point        RetryTime;
+};
+
+//! "closed", "open" or "half-open"
+const char* GetStateName(TCircuitBreaker::TState state);
@@ -0,0 +1,249 @@
+#include "compressed_history.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+    const size_t BLOCK_SIZE = 4096;
+
+    const uint32_t TIMESTAMP_WIDTHS[] = {7, 12, 20, 64};
+    const uint32_t VALUE_WIDTHS[]     = {4, 8, 13, 33};
+
+    //! The longest prefix of a field
+    const uint32_t MAX_PREFIX_BITS = 4;
+
+    //! Maximum size of an encoded sample in bits
+    const uint64_t MAX_SAMPLE_BITS = MAX_PREFIX_BITS + 64 + MAX_PREFIX_BITS + 33;
+
+    uint64_t ZigZag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    //! Writes bits starting from the most significant one to zero-filled buffer
+    class TBitWriter
+    {
+    public:
+        TBitWriter(uint8_t* data, uint64_t& bitCount) : Data(data), BitCount(bitCount) {}
+
+        void Write(uint64_t value, uint32_t bits)
+        {
+            while (bits > 0) {
+                uint32_t freeBits = 8 - BitCount % 8;
+                uint32_t n        = (bits < freeBits) ? bits : freeBits;
+                uint8_t  chunk    = (value >> (bits - n)) & ((1u << n) - 1);
+                Data[BitCount / 8] |= chunk << (freeBits - n);
+                BitCount += n;
+                bits -= n;
+            }
+        }
+
+        //! Write prefix selecting the smallest suitable width and the value
+        void WriteField(uint64_t value, const uint32_t widths[])
+        {
+            if (value == 0) {
+                Write(0, 1);
+                return;
+            }
+            for (uint32_t i = 0; i < MAX_PREFIX_BITS - 1; ++i) {
+                if (value < (static_cast<uint64_t>(1) << widths[i])) {
+                    // i + 1 ones and a zero
+                    Write((1u << (i + 2)) - 2, i + 2);
+                    Write(value, widths[i]);
+                    return;
+                }
+            }
+            Write((1u << MAX_PREFIX_BITS) - 1, MAX_PREFIX_BITS);
+            Write(value, widths[MAX_PREFIX_BITS - 1]);
+        }
+
+    private:
+        uint8_t*  Data;
+        uint64_t& BitCount;
+    };
+
+    class TBitReader
+    {
+    public:
+        TBitReader(const uint8_t* data) : Data(data), Pos(0) {}
+
+        uint64_t Read(uint32_t bits)
+        {
+            uint64_t res = 0;
+            while (bits > 0) {
+                uint32_t availableBits = 8 - Pos % 8;
+                uint32_t n             = (bits < availableBits) ? bits : availableBits;
+                uint8_t  chunk         = (Data[Pos / 8] >> (availableBits - n)) & ((1u << n) - 1);
+                res                    = (res << n) | chunk;
+                Pos += n;
+                bits -= n;
+            }
+            return res;
+        }
+
+        uint64_t ReadField(const uint32_t widths[])
+        {
+            uint32_t ones = 0;
+            while (ones < MAX_PREFIX_BITS && Read(1)) {
+                ++ones;
+            }
+            return (ones == 0) ? 0 : Read(widths[ones - 1]);
+        }
+
+    private:
+        const uint8_t* Data;
+        uint64_t       Pos;
+    };
+} // namespace
+
+TCompressedSampleStore::TCompressedSampleStore(size_t memoryBudget) : CurrentSeq(0)
+{
+    Blocks.resize(std::max<size_t>(2, memoryBudget / BLOCK_SIZE));
+    for (auto& block : Blocks) {
+        block.Data.resize(BLOCK_SIZE);
+    }
+}
+
+void TCompressedSampleStore::StartBlock()
+{
+    ++CurrentSeq;
+    auto& block    = Blocks[CurrentSeq % Blocks.size()];
+    block.Seq      = CurrentSeq;
+    block.Count    = 0;
+    block.BitCount = 0;
+    memset(block.Data.data(), 0, block.Data.size());
+}
+
+void TCompressedSampleStore::Add(int64_t timestampUs, int32_t value)
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    if (CurrentSeq == 0 || Blocks[CurrentSeq % Blocks.size()].BitCount + MAX_SAMPLE_BITS > BLOCK_SIZE * 8) {
+        StartBlock();
+    }
+    auto&      block = Blocks[CurrentSeq % Blocks.size()];
+    TBitWriter writer(block.Data.data(), block.BitCount);
+    if (block.Count == 0) {
+        writer.Write(static_cast<uint64_t>(timestampUs), 64);
+        writer.Write(static_cast<uint32_t>(value), 32);
+        block.FirstTimestampUs = timestampUs;
+        Encoder.PrevIntervalUs = 0;
+    } else {
+        int64_t interval = timestampUs - Encoder.PrevTimestampUs;
+        writer.WriteField(ZigZag(interval - Encoder.PrevIntervalUs), TIMESTAMP_WIDTHS);
+        writer.WriteField(ZigZag(static_cast<int64_t>(value) - Encoder.PrevValue), VALUE_WIDTHS);
+        Encoder.PrevIntervalUs = interval;
+    }
+    Encoder.PrevTimestampUs = timestampUs;
+    Encoder.PrevValue       = value;
+    block.LastTimestampUs   = timestampUs;
+    ++block.Count;
+}
+
+bool TCompressedSampleStore::CopyBlock(uint64_t seq, TBlock& res) const
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    const auto&                 block = Blocks[seq % Blocks.size()];
+    if (block.Seq != seq) {
+        return false;
+    }
+    res.Seq              = block.Seq;
+    res.Count            = block.Count;
+    res.FirstTimestampUs = block.FirstTimestampUs;
+    res.LastTimestampUs  = block.LastTimestampUs;
+    res.BitCount         = block.BitCount;
+    res.Data.assign(block.Data.begin(), block.Data.begin() + (block.BitCount + 7) / 8);
+    return true;
+}
+
+bool TCompressedSampleStore::Decode(const TBlock&         block,
+                                    int64_t               fromUs,
+                                    int64_t               toUs,
+                                    size_t                maxCount,
+                                    std::vector<TSample>& res)
+{
+    TBitReader reader(block.Data.data());
+    TSample    sample{0, 0};
+    int64_t    interval = 0;
+    for (uint32_t i = 0; i < block.Count; ++i) {
+        if (i == 0) {
+            sample.TimestampUs = static_cast<int64_t>(reader.Read(64));
+            sample.Value       = static_cast<int32_t>(reader.Read(32));
+        } else {
+            interval += UnZigZag(reader.ReadField(TIMESTAMP_WIDTHS));
+            sample.TimestampUs += interval;
+            sample.Value = static_cast<int32_t>(sample.Value + UnZigZag(reader.ReadField(VALUE_WIDTHS)));
+        }
+        if (sample.TimestampUs > toUs) {
+            return false;
+        }
+        if (sample.TimestampUs >= fromUs) {
+            if (res.size() == maxCount) {
+                return true;
+            }
+            res.push_back(sample);
+        }
+    }
+    return false;
+}
+
+std::vector<TSampleStore::TSample> TCompressedSampleStore::Get(int64_t fromUs,
+                                                               int64_t toUs,
+                                                               size_t  maxCount,
+                                                               bool*   truncated) const
+{
+    uint64_t lastSeq;
+    {
+        std::lock_guard<std::mutex> lg(Mutex);
+        lastSeq = CurrentSeq;
+    }
+    uint64_t firstSeq = (lastSeq >= Blocks.size()) ? lastSeq - Blocks.size() + 1 : 1;
+
+    std::vector<TSample> res;
+    TBlock               block;
+    bool                 more = false;
+    for (uint64_t seq = firstSeq; seq <= lastSeq && !more; ++seq) {
+        // the block could be reused by the writer, its samples are lost
+        if (!CopyBlock(seq, block) || block.Count == 0 || block.LastTimestampUs < fromUs) {
+            continue;
+        }
+        if (block.FirstTimestampUs > toUs) {
+            break;
+        }
+        more = Decode(block, fromUs, toUs, maxCount, res);
+    }
+    if (truncated) {
+        *truncated = more;
+    }
+    return res;
+}
+
+uint64_t TCompressedSampleStore::GetSampleCount() const
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    uint64_t                    res = 0;
+    for (const auto& block : Blocks) {
+        res += block.Count;
+    }
+    return res;
+}
+
+uint64_t TCompressedSampleStore::GetUsedBytes() const
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    uint64_t                    res = 0;
+    for (const auto& block : Blocks) {
+        res += (block.BitCount + 7) / 8;
+    }
+    return res;
+}
+
+size_t TCompressedSampleStore::GetBlockSize()
+{
+    return BLOCK_SIZE;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "sample_history.h"
+
+/**
+ * @brief Compressed sample store. Samples are bit-packed into fixed-size blocks, when all blocks
+ * are filled the oldest one is reused.
+ *
+ * The first sample of a block is stored as is. Timestamps of the next samples are encoded as
+ * delta-of-delta, so regular sampling takes 1 bit per timestamp. Values are encoded as a difference
+ * from the previous value, a 12-bit ADC needs at most 17 bits and a stable signal 1-6 bits.
+ * Both differences are zigzag-encoded and written with a prefix selecting the field width:
+ *
+ * timestamp: 0 - the same interval, 10 - 7 bits, 110 - 12 bits, 1110 - 20 bits, 1111 - 64 bits;
+ *
+ * value: 0 - the same value, 10 - 4 bits, 110 - 8 bits, 1110 - 13 bits, 1111 - 33 bits.
+ *
+ * Add() locks a mutex shared with readers only for appending to the current block.
+ * Get() locks it for copying of a single block and decodes blocks without locking.
+ */
+class TCompressedSampleStore : public TSampleStore
+{
+public:
+    /**
+     * @brief Construct a new TCompressedSampleStore object
+     *
+     * @param memoryBudget Memory for blocks in bytes. At least 2 blocks are allocated
+     */
+    explicit TCompressedSampleStore(size_t memoryBudget);
+
+    TCompressedSampleStore(const TCompressedSampleStore&) = delete;
+    TCompressedSampleStore& operator=(const TCompressedSampleStore&) = delete;
+
+    void                 Add(int64_t timestampUs, int32_t value) override;
+    std::vector<TSample> Get(int64_t fromUs,
+                             int64_t toUs,
+                             size_t  maxCount,
+                             bool*   truncated = nullptr) const override;
+
+    //! Number of samples in the store
+    uint64_t GetSampleCount() const;
+
+    //! Number of bytes occupied by samples in the store
+    uint64_t GetUsedBytes() const;
+
+    //! Size of a block in bytes
+    static size_t GetBlockSize();
+
+private:
+    struct TBlock
+    {
+        //! Number of the block since creation of the store, it identifies reused blocks
+        uint64_t             Seq              = 0;
+        uint32_t             Count            = 0;
+        int64_t              FirstTimestampUs = 0;
+        int64_t              LastTimestampUs  = 0;
+        uint64_t             BitCount         = 0;
+        std::vector<uint8_t> Data;
+    };
+
+    //! Writer state, it is used only by Add()
+    struct TEncoderState
+    {
+        int64_t PrevTimestampUs = 0;
+        int64_t PrevIntervalUs  = 0;
+        int32_t PrevValue       = 0;
+    };
+
+    mutable std::mutex  Mutex;
+    std::vector<TBlock> Blocks;
+
+    //! Seq of the block samples are added to
+    uint64_t      CurrentSeq;
+    TEncoderState Encoder;
+
+    void StartBlock();
+
+    //! Copy the block if it still has the seq. Returns false if the block is reused
+    bool CopyBlock(uint64_t seq, TBlock& res) const;
+
+    static bool Decode(const TBlock& block, int64_t fromUs, int64_t toUs, size_t maxCount, std::vector<TSample>& res);
+};
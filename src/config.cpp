@@ -1,6 +1,9 @@
 #include "config.h"
 #include <algorithm>
 #include <fstream>
+#include <map>
+#include <set>
+#include <tuple>
 #include <wblib/utils.h>
 #include <wblib/json_utils.h>
 
@@ -12,6 +15,29 @@ using namespace std;
 
 namespace
 {
+    TConversionStage LoadConversionStage(const Value& item)
+    {
+        TConversionStage stage;
+        stage.Type = ParseConversionType(item["type"].asString());
+        for (const auto& point : item["points"]) {
+            stage.Points.emplace_back(point[0].asDouble(), point[1].asDouble());
+        }
+        for (const auto& coefficient : item["coefficients"]) {
+            stage.Coefficients.push_back(coefficient.asDouble());
+        }
+        Get(item, "a", stage.A);
+        Get(item, "b", stage.B);
+        Get(item, "c", stage.C);
+        Get(item, "supply_voltage", stage.SupplyVoltage);
+        Get(item, "series_resistance", stage.SeriesResistance);
+        string position;
+        if (Get(item, "ntc_position", position)) {
+            stage.NtcToGround = (position == "to_ground");
+        }
+        CheckConversionStage(stage);
+        return stage;
+    }
+
     void LoadChannel(const Value& item, vector<TADCChannelSettings>& channels)
     {
         TADCChannelSettings channel;
@@ -24,6 +50,78 @@ namespace
         Get(item, "decimal_places", channel.ReaderCfg.DecimalPlaces);
         Get(item, "scale", channel.ReaderCfg.DesiredScale);
         Get(item, "match_iio", channel.MatchIIO);
+        Get(item, "poll_interval_ms", channel.PollIntervalMs);
+        Get(item, "deadband", channel.PublishCfg.Deadband);
+        Get(item, "deadband_percent", channel.PublishCfg.DeadbandPercent);
+        Get(item, "min_publish_interval_ms", channel.PublishCfg.MinPublishIntervalMs);
+        Get(item, "max_publish_interval_ms", channel.PublishCfg.MaxPublishIntervalMs);
+        Get(item, "publish_timestamp", channel.PublishTimestamp);
+
+        Get(item, "trim_percent", channel.ReaderCfg.TrimPercent);
+        Get(item, "fractional_bits", channel.ReaderCfg.FractionalBits);
+        Get(item, "history_size_kb", channel.HistorySizeKb);
+        Get(item, "shm_ring_size", channel.ShmRingSize);
+
+        string filter;
+        if (Get(item, "filter", filter)) {
+            channel.ReaderCfg.Filter = ParseFilterType(filter);
+        }
+
+        string historyFormat;
+        if (Get(item, "history_format", historyFormat)) {
+            channel.CompressHistory = (historyFormat == "compressed");
+        }
+
+        string acquisitionMode;
+        if (Get(item, "acquisition_mode", acquisitionMode)) {
+            channel.UseIIOBuffer = (acquisitionMode == "buffer");
+        }
+        if (Get(item, "sample_group", channel.SampleGroup) && !channel.SampleGroup.empty()) {
+            channel.UseIIOBuffer = true;
+        }
+
+        for (const auto& stage : item["conversion"]) {
+            try {
+                channel.ReaderCfg.Conversion.push_back(LoadConversionStage(stage));
+            } catch (const runtime_error& e) {
+                throw TBadConfigError("Bad conversion of channel " + channel.Id + ": " + e.what());
+            }
+        }
+
+        string signalType;
+        if (Get(item, "signal_type", signalType)) {
+            channel.ReaderCfg.AcMode = (signalType == "ac");
+        }
+        Get(item, "ac_window_ms", channel.ReaderCfg.AcWindowMs);
+        Get(item, "ac_sample_rate", channel.ReaderCfg.AcSampleRate);
+        if (channel.ReaderCfg.AcMode) {
+            // RMS of non-linearly converted values has no physical meaning
+            if (!channel.ReaderCfg.Conversion.empty()) {
+                throw TBadConfigError("AC channel " + channel.Id + " can't have conversion");
+            }
+            if (channel.ReaderCfg.AcWindowMs == 0 || channel.ReaderCfg.AcSampleRate == 0) {
+                throw TBadConfigError("ac_window_ms and ac_sample_rate of channel " + channel.Id + " must be positive");
+            }
+        }
+
+        const auto& spectrum = item["spectrum"];
+        if (spectrum.isObject()) {
+            Get(spectrum, "fft_size", channel.Spectrum.FftSize);
+            Get(spectrum, "publish_interval_ms", channel.Spectrum.PublishIntervalMs);
+            Get(spectrum, "sample_rate", channel.Spectrum.SampleRate);
+            for (const auto& bandItem : spectrum["bands"]) {
+                TSpectrumBand band;
+                Get(bandItem, "id", band.Id);
+                Get(bandItem, "min_hz", band.MinHz);
+                Get(bandItem, "max_hz", band.MaxHz);
+                channel.Spectrum.Bands.push_back(band);
+            }
+            try {
+                CheckSpectrumSettings(channel.Spectrum);
+            } catch (const runtime_error& e) {
+                throw TBadConfigError("Bad spectrum settings of channel " + channel.Id + ": " + e.what());
+            }
+        }
 
         Value v = item["channel_number"];
         if (v.isInt()) {
@@ -34,23 +132,66 @@ namespace
         channels.push_back(channel);
     }
 
-    void Append(const TConfig& src, TConfig& dst)
+    void LoadSampleGroup(const Value& item, vector<TSampleGroupSettings>& groups)
+    {
+        TSampleGroupSettings group;
+        Get(item, "id", group.Id);
+        string trigger;
+        if (Get(item, "trigger", trigger)) {
+            group.Trigger.Type = ParseTriggerType(trigger);
+        }
+        Get(item, "trigger_name", group.Trigger.Name);
+        Get(item, "sampling_frequency", group.Trigger.SamplingFrequency);
+        if (group.Trigger.Type != TIIOTriggerType::None && group.Trigger.Name.empty()) {
+            throw TBadConfigError("Trigger name of sample group " + group.Id + " is not set");
+        }
+        groups.push_back(group);
+    }
+
+    void LoadVirtualChannel(const Value& item, vector<TVirtualChannelSettings>& channels)
+    {
+        TVirtualChannelSettings channel;
+        Get(item, "id", channel.Id);
+        Get(item, "type", channel.Type);
+        Get(item, "decimal_places", channel.DecimalPlaces);
+        Get(item, "deadband", channel.PublishCfg.Deadband);
+        Get(item, "deadband_percent", channel.PublishCfg.DeadbandPercent);
+        Get(item, "min_publish_interval_ms", channel.PublishCfg.MinPublishIntervalMs);
+        Get(item, "max_publish_interval_ms", channel.PublishCfg.MaxPublishIntervalMs);
+        try {
+            channel.Expression = make_shared<TExpression>(item["expression"].asString());
+        } catch (const runtime_error& e) {
+            throw TBadConfigError("Bad virtual channel " + channel.Id + ": " + e.what());
+        }
+        channels.push_back(channel);
+    }
+
+    template<class T> void Merge(const vector<T>& src, vector<T>& dst)
     {
-        dst.DeviceName          = src.DeviceName;
-        dst.EnableDebugMessages = src.EnableDebugMessages;
-
-        for (const auto& v : src.Channels) {
-            auto el = find_if(dst.Channels.begin(), dst.Channels.end(), [&](auto& c) {
-                return c.Id == v.Id;
-            });
-            if (el == dst.Channels.end()) {
-                dst.Channels.push_back(v);
+        for (const auto& v : src) {
+            auto el = find_if(dst.begin(), dst.end(), [&](auto& c) { return c.Id == v.Id; });
+            if (el == dst.end()) {
+                dst.push_back(v);
             } else {
                 *el = v;
             }
         }
     }
 
+    void Append(const TConfig& src, TConfig& dst)
+    {
+        dst.DeviceName           = src.DeviceName;
+        dst.EnableDebugMessages  = src.EnableDebugMessages;
+        dst.IIOBufferLength      = src.IIOBufferLength;
+        dst.PublisherCfg         = src.PublisherCfg;
+        dst.StatsIntervalMs      = src.StatsIntervalMs;
+        dst.HistoryMemoryLimitKb = src.HistoryMemoryLimitKb;
+
+        Merge(src.Channels, dst.Channels);
+        Merge(src.SampleGroups, dst.SampleGroups);
+        Merge(src.VirtualChannels, dst.VirtualChannels);
+    }
+
     TConfig loadFromJSON(const string& fileName, const Value& schema)
     {
         TConfig config;
@@ -61,10 +202,30 @@ namespace
 
         Get(configJson, "device_name", config.DeviceName);
         Get(configJson, "debug", config.EnableDebugMessages);
+        Get(configJson, "iio_buffer_length", config.IIOBufferLength);
+        Get(configJson, "stats_interval_ms", config.StatsIntervalMs);
+        Get(configJson, "history_memory_limit_kb", config.HistoryMemoryLimitKb);
+
+        uint32_t queueSize;
+        if (Get(configJson, "publish_queue_size", queueSize)) {
+            config.PublisherCfg.QueueSize = queueSize;
+        }
+        string overflow;
+        if (Get(configJson, "publish_queue_overflow", overflow)) {
+            config.PublisherCfg.BlockOnOverflow = (overflow == "block");
+        }
 
         const auto& ch = configJson["iio_channels"];
         for_each(ch.begin(), ch.end(), [&](const Value& v) { LoadChannel(v, config.Channels); });
 
+        const auto& groups = configJson["sample_groups"];
+        for_each(groups.begin(), groups.end(), [&](const Value& v) { LoadSampleGroup(v, config.SampleGroups); });
+
+        const auto& virtualChannels = configJson["virtual_channels"];
+        for_each(virtualChannels.begin(), virtualChannels.end(), [&](const Value& v) {
+            LoadVirtualChannel(v, config.VirtualChannels);
+        });
+
         return config;
     }
 
@@ -78,6 +239,52 @@ namespace
         }
         schema["required"] = newArray;
     }
+
+    //! Histories are preallocated, so the limit is checked before any allocation
+    const TConfig& CheckHistoryMemory(const TConfig& config)
+    {
+        uint64_t total = 0;
+        for (const auto& channel : config.Channels) {
+            total += channel.HistorySizeKb;
+        }
+        if (total > config.HistoryMemoryLimitKb) {
+            throw TBadConfigError("Total sample history size (" + to_string(total) + " KiB) exceeds history_memory_limit_kb (" +
+                                  to_string(config.HistoryMemoryLimitKb) + " KiB)");
+        }
+        return config;
+    }
+
+    //! Sample groups can be defined in other files, so they are checked after merging
+    const TConfig& CheckSampleGroups(const TConfig& config)
+    {
+        for (const auto& channel : config.Channels) {
+            if (!channel.SampleGroup.empty() && !config.FindSampleGroup(channel.SampleGroup)) {
+                throw TBadConfigError("Channel " + channel.Id + " refers to unknown sample group " + channel.SampleGroup);
+            }
+        }
+        return config;
+    }
+
+    //! Virtual channels can refer to channels from other files, so they are checked after merging
+    const TConfig& CheckVirtualChannels(const TConfig& config)
+    {
+        set<string> channelIds;
+        for (const auto& channel : config.Channels) {
+            channelIds.insert(channel.Id);
+        }
+        set<string> virtualIds;
+        for (const auto& channel : config.VirtualChannels) {
+            if (channelIds.count(channel.Id) || !virtualIds.insert(channel.Id).second) {
+                throw TBadConfigError("Duplicate channel id " + channel.Id);
+            }
+            for (const auto& source : channel.Expression->GetVariables()) {
+                if (!channelIds.count(source)) {
+                    throw TBadConfigError("Virtual channel " + channel.Id + " refers to unknown channel " + source);
+                }
+            }
+        }
+        return config;
+    }
 } // namespace
 
 TConfig LoadConfig(const string& mainConfigFile,
@@ -90,7 +297,7 @@ TConfig LoadConfig(const string& mainConfigFile,
     removeDeviceNameRequirement(noDeviceNameSchema);
 
     if (!optionalConfigFile.empty())
-        return loadFromJSON(optionalConfigFile, schema);
+        return CheckVirtualChannels(CheckSampleGroups(CheckHistoryMemory(loadFromJSON(optionalConfigFile, schema))));
     TConfig cfg;
     try {
         IterateDir(systemConfigDir, ".conf", [&](const string& f) {
@@ -100,7 +307,109 @@ TConfig LoadConfig(const string& mainConfigFile,
     } catch (const TNoDirError&) {
     }
     Append(loadFromJSON(mainConfigFile, schema), cfg);
-    return cfg;
+    return CheckVirtualChannels(CheckSampleGroups(CheckHistoryMemory(cfg)));
 }
 
-TBadConfigError::TBadConfigError(const string& msg) : runtime_error(msg) {}
\ No newline at end of file
+const TSampleGroupSettings* TConfig::FindSampleGroup(const string& id) const
+{
+    for (const auto& group : SampleGroups) {
+        if (group.Id == id) {
+            return &group;
+        }
+    }
+    return nullptr;
+}
+
+TBadConfigError::TBadConfigError(const string& msg) : runtime_error(msg) {}
+bool TConfigDiff::IsEmpty() const
+{
+    return Added.empty() && Removed.empty() && Changed.empty();
+}
+
+bool IsSameChannel(const TADCChannelSettings& a, const TADCChannelSettings& b)
+{
+    const auto& ra = a.ReaderCfg;
+    const auto& rb = b.ReaderCfg;
+    const auto& pa = a.PublishCfg;
+    const auto& pb = b.PublishCfg;
+    return std::tie(a.Id, a.MatchIIO, a.PollIntervalMs, a.UseIIOBuffer, a.HistorySizeKb, a.CompressHistory, a.ShmRingSize, a.SampleGroup, a.Spectrum) ==
+               std::tie(b.Id, b.MatchIIO, b.PollIntervalMs, b.UseIIOBuffer, b.HistorySizeKb, b.CompressHistory, b.ShmRingSize, b.SampleGroup, b.Spectrum) &&
+           std::tie(ra.ChannelNumber, ra.ReadingsNumber, ra.MaxScaledVoltage, ra.DesiredScale, ra.VoltageMultiplier,
+                    ra.AveragingWindow, ra.DecimalPlaces, ra.Filter, ra.TrimPercent, ra.FractionalBits, ra.Conversion,
+                    ra.AcMode, ra.AcWindowMs, ra.AcSampleRate) ==
+               std::tie(rb.ChannelNumber, rb.ReadingsNumber, rb.MaxScaledVoltage, rb.DesiredScale, rb.VoltageMultiplier,
+                        rb.AveragingWindow, rb.DecimalPlaces, rb.Filter, rb.TrimPercent, rb.FractionalBits, rb.Conversion,
+                        rb.AcMode, rb.AcWindowMs, rb.AcSampleRate) &&
+           std::tie(pa.Deadband, pa.DeadbandPercent, pa.MinPublishIntervalMs, pa.MaxPublishIntervalMs, a.PublishTimestamp) ==
+               std::tie(pb.Deadband, pb.DeadbandPercent, pb.MinPublishIntervalMs, pb.MaxPublishIntervalMs, b.PublishTimestamp);
+}
+
+bool IsSameChannel(const TVirtualChannelSettings& a, const TVirtualChannelSettings& b)
+{
+    const auto& pa = a.PublishCfg;
+    const auto& pb = b.PublishCfg;
+    return std::tie(a.Id, a.Expression->GetText(), a.Type, a.DecimalPlaces) ==
+               std::tie(b.Id, b.Expression->GetText(), b.Type, b.DecimalPlaces) &&
+           std::tie(pa.Deadband, pa.DeadbandPercent, pa.MinPublishIntervalMs, pa.MaxPublishIntervalMs) ==
+               std::tie(pb.Deadband, pb.DeadbandPercent, pb.MinPublishIntervalMs, pb.MaxPublishIntervalMs);
+}
+
+TConfigDiff DiffConfigs(const TConfig& running, const TConfig& reloaded)
+{
+    TConfigDiff res;
+    res.RestartRequired = (running.DeviceName != reloaded.DeviceName) ||
+                          (running.PublisherCfg.QueueSize != reloaded.PublisherCfg.QueueSize) ||
+                          (running.PublisherCfg.BlockOnOverflow != reloaded.PublisherCfg.BlockOnOverflow) ||
+                          (running.StatsIntervalMs != reloaded.StatsIntervalMs);
+
+    map<string, const TADCChannelSettings*> runningChannels;
+    for (const auto& channel : running.Channels) {
+        runningChannels[channel.Id] = &channel;
+    }
+    for (const auto& channel : reloaded.Channels) {
+        auto it = runningChannels.find(channel.Id);
+        if (it == runningChannels.end()) {
+            res.Added.push_back(channel.Id);
+            continue;
+        }
+        // a channel moved to another group is already changed, so only the trigger of its group is compared
+        const auto* runningGroup  = running.FindSampleGroup(channel.SampleGroup);
+        const auto* reloadedGroup = reloaded.FindSampleGroup(channel.SampleGroup);
+        auto        runningTrigger  = runningGroup ? runningGroup->Trigger : TIIOTriggerSettings();
+        auto        reloadedTrigger = reloadedGroup ? reloadedGroup->Trigger : TIIOTriggerSettings();
+        if (!IsSameChannel(*it->second, channel) ||
+            (channel.UseIIOBuffer && running.IIOBufferLength != reloaded.IIOBufferLength) ||
+            runningTrigger != reloadedTrigger)
+        {
+            res.Changed.push_back(channel.Id);
+        }
+        runningChannels.erase(it);
+    }
+    for (const auto& channel : running.Channels) {
+        if (runningChannels.count(channel.Id)) {
+            res.Removed.push_back(channel.Id);
+        }
+    }
+
+    map<string, const TVirtualChannelSettings*> runningVirtualChannels;
+    for (const auto& channel : running.VirtualChannels) {
+        runningVirtualChannels[channel.Id] = &channel;
+    }
+    for (const auto& channel : reloaded.VirtualChannels) {
+        auto it = runningVirtualChannels.find(channel.Id);
+        if (it == runningVirtualChannels.end()) {
+            res.Added.push_back(channel.Id);
+            continue;
+        }
+        if (!IsSameChannel(*it->second, channel)) {
+            res.Changed.push_back(channel.Id);
+        }
+        runningVirtualChannels.erase(it);
+    }
+    for (const auto& channel : running.VirtualChannels) {
+        if (runningVirtualChannels.count(channel.Id)) {
+            res.Removed.push_back(channel.Id);
+        }
+    }
+    return res;
+}
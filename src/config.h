@@ -1,6 +1,12 @@
 #pragma once
 
+#include "expression.h"
+#include "iio_trigger.h"
+#include "publish_policy.h"
+#include "publisher.h"
+#include "spectrum.h"
 #include "sysfs_adc.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,14 +21,78 @@ struct TADCChannelSettings
 
     //! Parameters of reading and converting measured value
     TChannelReader::TSettings ReaderCfg;
+
+    //! Interval between channel's measurements in mS. If 0, the channel is measured continuously
+    uint32_t PollIntervalMs = 0;
+
+    //! Parameters of measured values publication
+    TPublishPolicy::TSettings PublishCfg;
+
+    //! Read values from IIO buffer (/dev/iio:deviceN) instead of sysfs in_voltageX_raw file
+    bool UseIIOBuffer = false;
+
+    //! Memory for raw samples history in KiB. If 0, the history is disabled
+    uint32_t HistorySizeKb = 0;
+
+    //! Keep the history in TCompressedSampleStore instead of TSampleHistory
+    bool CompressHistory = false;
+
+    //! Number of samples in shared memory ring for local consumers. If 0, the ring isn't created
+    uint32_t ShmRingSize = 0;
+
+    //! Id of sample group of the channel or empty string. Channels of sample groups are captured through IIO buffer
+    std::string SampleGroup;
+
+    //! Spectral features published as additional controls
+    TSpectrumSettings Spectrum;
+
+    //! Publish measurement time of values to meta/ts of the control
+    bool PublishTimestamp = false;
+};
+
+//! Channels of an IIO device captured in the same scan on events of a trigger
+struct TSampleGroupSettings
+{
+    std::string Id;
+
+    //! Trigger of IIO buffer of the device
+    TIIOTriggerSettings Trigger;
+};
+
+//! Control computed from values of ADC channels
+struct TVirtualChannelSettings
+{
+    //! Topic name "/devices/DRIVER_NAME/controls/ + Id"
+    std::string Id;
+
+    //! Expression over ids of ADC channels compiled during config loading
+    std::shared_ptr<const TExpression> Expression;
+
+    //! Type of MQTT control
+    std::string Type = "value";
+
+    //! Number of digits after point in published value
+    uint32_t DecimalPlaces = 3;
+
+    //! Parameters of computed values publication
+    TPublishPolicy::TSettings PublishCfg;
 };
 
 //! Programm settings
 struct TConfig
 {
-    std::string DeviceName          = "ADCs";  //! Value of /devices/DRIVER_NAME/meta/name
-    bool        EnableDebugMessages = false;   //! Enable logging of debug messages
-    std::vector<TADCChannelSettings> Channels; //! ADC channels list
+    std::string DeviceName           = "ADCs"; //! Value of /devices/DRIVER_NAME/meta/name
+    bool        EnableDebugMessages  = false;  //! Enable logging of debug messages
+    uint32_t    IIOBufferLength      = 64;     //! Number of scans in IIO buffer
+    uint32_t    StatsIntervalMs      = 0;      //! Interval of diagnostic controls publication, 0 - disabled
+    uint32_t    HistoryMemoryLimitKb = 1024;   //! Maximum total memory for samples history of all channels
+    TPublisher::TSettings             PublisherCfg; //! Measurement results publication settings
+    std::vector<TADCChannelSettings>  Channels;     //! ADC channels list
+    std::vector<TSampleGroupSettings> SampleGroups; //! Groups of synchronously sampled channels
+    std::vector<TVirtualChannelSettings> VirtualChannels; //! Controls computed from ADC channels
+
+    //! Sample group with the id or nullptr
+    const TSampleGroupSettings* FindSampleGroup(const std::string& id) const;
 };
 
 //! Validation error class
@@ -33,7 +103,9 @@ public:
 };
 
 /**
- * @brief Load configuration from config files. Throws TBadConfigError on validation error.
+ * @brief Load configuration from config files. Throws TBadConfigError on validation error, if
+ * total history size of channels exceeds TConfig::HistoryMemoryLimitKb, a channel refers to
+ * unknown sample group or an expression of a virtual channel is bad or refers to unknown channel.
  *
  * @param mainConfigFile - path and name of a main config file.
  * It will be loaded if optional config file is empty.
@@ -47,3 +119,35 @@ TConfig LoadConfig(const std::string& mainConfigFile,
                    const std::string& optionalConfigFile,
                    const std::string& systemConfigsDir,
                    const std::string& schemaFile);
+
+//! Difference between running and reloaded configurations. Virtual channels are listed with ADC channels
+struct TConfigDiff
+{
+    //! Ids of channels present only in the reloaded configuration
+    std::vector<std::string> Added;
+
+    //! Ids of channels present only in the running configuration
+    std::vector<std::string> Removed;
+
+    //! Ids of channels with changed settings. They must be measured from scratch
+    std::vector<std::string> Changed;
+
+    //! Device name, publication or statistics settings are changed, they are applied after restart
+    bool RestartRequired = false;
+
+    //! No channels are added, removed or changed
+    bool IsEmpty() const;
+};
+
+//! Check if all settings of channels are equal
+bool IsSameChannel(const TADCChannelSettings& a, const TADCChannelSettings& b);
+
+//! Check if all settings of virtual channels are equal
+bool IsSameChannel(const TVirtualChannelSettings& a, const TVirtualChannelSettings& b);
+
+/**
+ * @brief Compare running and reloaded configurations. Channels are matched by id.
+ * If IIO buffer length is changed, all channels in buffer acquisition mode are changed.
+ * If trigger of a sample group is changed, all its channels are changed.
+ */
+TConfigDiff DiffConfigs(const TConfig& running, const TConfig& reloaded);
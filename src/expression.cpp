@@ -0,0 +1,319 @@
+#include "expression.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdexcept>
+#include <stdlib.h>
+
+namespace
+{
+    bool IsWordChar(char c)
+    {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+} // namespace
+
+//! Recursive descent parser emitting bytecode in reverse Polish notation
+class TExpressionParser
+{
+public:
+    TExpressionParser(TExpression& expr) : Expr(expr), Text(expr.Text), Pos(0) {}
+
+    void Parse()
+    {
+        ParseSum();
+        SkipSpaces();
+        if (Pos != Text.size()) {
+            Fail("unexpected '" + std::string(1, Text[Pos]) + "'");
+        }
+        Expr.StackSize = GetStackSize();
+    }
+
+private:
+    typedef TExpression::TOpCode TOpCode;
+
+    TExpression&       Expr;
+    const std::string& Text;
+    size_t             Pos;
+
+    [[noreturn]] void Fail(const std::string& msg) const
+    {
+        throw std::runtime_error("Bad expression \"" + Text + "\" at " + std::to_string(Pos + 1) + ": " + msg);
+    }
+
+    void SkipSpaces()
+    {
+        while (Pos < Text.size() && isspace(static_cast<unsigned char>(Text[Pos]))) {
+            ++Pos;
+        }
+    }
+
+    bool Accept(char c)
+    {
+        SkipSpaces();
+        if (Pos < Text.size() && Text[Pos] == c) {
+            ++Pos;
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(char c)
+    {
+        if (!Accept(c)) {
+            Fail(std::string("'") + c + "' is expected");
+        }
+    }
+
+    // sum := product (('+' | '-') product)*
+    void ParseSum()
+    {
+        ParseProduct();
+        while (true) {
+            if (Accept('+')) {
+                ParseProduct();
+                Emit(TOpCode::Add);
+            } else if (Accept('-')) {
+                ParseProduct();
+                Emit(TOpCode::Subtract);
+            } else {
+                return;
+            }
+        }
+    }
+
+    // product := unary (('*' | '/') unary)*
+    void ParseProduct()
+    {
+        ParseUnary();
+        while (true) {
+            if (Accept('*')) {
+                ParseUnary();
+                Emit(TOpCode::Multiply);
+            } else if (Accept('/')) {
+                ParseUnary();
+                Emit(TOpCode::Divide);
+            } else {
+                return;
+            }
+        }
+    }
+
+    // unary := ('-' | '+') unary | power
+    void ParseUnary()
+    {
+        if (Accept('-')) {
+            ParseUnary();
+            Emit(TOpCode::Negate);
+        } else if (Accept('+')) {
+            ParseUnary();
+        } else {
+            ParsePower();
+        }
+    }
+
+    // power := primary ('^' unary)?, so 2^3^2 = 2^(3^2) and -2^2 = -(2^2)
+    void ParsePower()
+    {
+        ParsePrimary();
+        if (Accept('^')) {
+            ParseUnary();
+            Emit(TOpCode::Power);
+        }
+    }
+
+    // primary := number | variable | function '(' sum (',' sum)* ')' | '(' sum ')'
+    void ParsePrimary()
+    {
+        SkipSpaces();
+        if (Accept('(')) {
+            ParseSum();
+            Expect(')');
+            return;
+        }
+        if (Pos == Text.size()) {
+            Fail("operand is expected");
+        }
+        size_t start = Pos;
+        if (isdigit(static_cast<unsigned char>(Text[Pos])) || Text[Pos] == '.') {
+            const char* begin = Text.c_str() + Pos;
+            char*       end;
+            double      value = strtod(begin, &end);
+            size_t      len   = end - begin;
+            // a word starting with digits is a variable, e.g. 5Vout
+            if (len != 0 && (Pos + len == Text.size() || !IsWordChar(Text[Pos + len]))) {
+                Pos += len;
+                EmitConstant(value);
+                return;
+            }
+        }
+        while (Pos < Text.size() && IsWordChar(Text[Pos])) {
+            ++Pos;
+        }
+        if (Pos == start) {
+            Fail("operand is expected");
+        }
+        std::string word = Text.substr(start, Pos - start);
+        if (Accept('(')) {
+            ParseFunction(word);
+            return;
+        }
+        EmitVariable(word);
+    }
+
+    void ParseFunction(const std::string& name)
+    {
+        if (name == "abs" || name == "sqrt") {
+            ParseSum();
+            Expect(')');
+            Emit((name == "abs") ? TOpCode::Abs : TOpCode::Sqrt);
+        } else if (name == "min" || name == "max") {
+            ParseSum();
+            Expect(',');
+            ParseSum();
+            Expect(')');
+            Emit((name == "min") ? TOpCode::Min : TOpCode::Max);
+        } else {
+            Fail("unknown function " + name);
+        }
+    }
+
+    void EmitConstant(double value)
+    {
+        Expr.Code.push_back({TOpCode::Constant, static_cast<uint32_t>(Expr.Constants.size())});
+        Expr.Constants.push_back(value);
+    }
+
+    void EmitVariable(const std::string& name)
+    {
+        auto it = std::find(Expr.Variables.begin(), Expr.Variables.end(), name);
+        Expr.Code.push_back({TOpCode::Variable, static_cast<uint32_t>(it - Expr.Variables.begin())});
+        if (it == Expr.Variables.end()) {
+            Expr.Variables.push_back(name);
+        }
+    }
+
+    static bool IsUnary(TOpCode op)
+    {
+        return op == TOpCode::Negate || op == TOpCode::Abs || op == TOpCode::Sqrt;
+    }
+
+    bool IsConstant(size_t fromEnd) const
+    {
+        return Expr.Code.size() > fromEnd && Expr.Code[Expr.Code.size() - 1 - fromEnd].Op == TOpCode::Constant;
+    }
+
+    //! Emit operation or compute it now if its operands are constants
+    void Emit(TOpCode op)
+    {
+        if (IsUnary(op) ? IsConstant(0) : (IsConstant(0) && IsConstant(1))) {
+            double operands[2] = {0, 0};
+            size_t n           = IsUnary(op) ? 1 : 2;
+            for (size_t i = 0; i < n; ++i) {
+                operands[n - 1 - i] = Expr.Constants[Expr.Code.back().Arg];
+                Expr.Constants.pop_back();
+                Expr.Code.pop_back();
+            }
+            EmitConstant(TExpression::Apply(op, operands[0], operands[1]));
+            return;
+        }
+        Expr.Code.push_back({op, 0});
+    }
+
+    size_t GetStackSize() const
+    {
+        size_t depth = 0;
+        size_t res   = 0;
+        for (const auto& instruction : Expr.Code) {
+            if (instruction.Op == TOpCode::Constant || instruction.Op == TOpCode::Variable) {
+                res = std::max(res, ++depth);
+            } else if (!IsUnary(instruction.Op)) {
+                --depth;
+            }
+        }
+        return res;
+    }
+};
+
+TExpression::TExpression(const std::string& text) : Text(text), StackSize(0)
+{
+    TExpressionParser parser(*this);
+    parser.Parse();
+}
+
+const std::string& TExpression::GetText() const
+{
+    return Text;
+}
+
+const std::vector<std::string>& TExpression::GetVariables() const
+{
+    return Variables;
+}
+
+size_t TExpression::GetStackSize() const
+{
+    return StackSize;
+}
+
+size_t TExpression::GetSize() const
+{
+    return Code.size();
+}
+
+double TExpression::Apply(TOpCode op, double x, double y)
+{
+    switch (op) {
+        case TOpCode::Negate:
+            return -x;
+        case TOpCode::Abs:
+            return fabs(x);
+        case TOpCode::Sqrt:
+            return sqrt(x);
+        case TOpCode::Add:
+            return x + y;
+        case TOpCode::Subtract:
+            return x - y;
+        case TOpCode::Multiply:
+            return x * y;
+        case TOpCode::Divide:
+            return x / y;
+        case TOpCode::Power:
+            return pow(x, y);
+        case TOpCode::Min:
+            return std::min(x, y);
+        case TOpCode::Max:
+            return std::max(x, y);
+        case TOpCode::Constant:
+        case TOpCode::Variable:
+            break;
+    }
+    return NAN;
+}
+
+double TExpression::Evaluate(const double* variables, double* stack) const
+{
+    // sp points after the top of the stack
+    double* sp = stack;
+    for (const auto& instruction : Code) {
+        switch (instruction.Op) {
+            case TOpCode::Constant:
+                *sp++ = Constants[instruction.Arg];
+                break;
+            case TOpCode::Variable:
+                *sp++ = variables[instruction.Arg];
+                break;
+            case TOpCode::Negate:
+            case TOpCode::Abs:
+            case TOpCode::Sqrt:
+                sp[-1] = Apply(instruction.Op, sp[-1], 0);
+                break;
+            default:
+                --sp;
+                sp[-1] = Apply(instruction.Op, sp[-1], sp[0]);
+                break;
+        }
+    }
+    return sp[-1];
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Arithmetic expression over named variables compiled into stack machine bytecode.
+ * The expression is parsed once, evaluation doesn't parse text and doesn't allocate memory.
+ *
+ * Supported syntax: numbers, variables, + - * / ^, unary minus, parentheses and functions
+ * abs(x), sqrt(x), min(x, y), max(x, y). Variables are words of letters, digits and underscores,
+ * they can start with a digit (e.g. 5Vout) if the word isn't a number.
+ * Subexpressions of constants are computed during compilation.
+ */
+class TExpression
+{
+public:
+    /**
+     * @brief Compile expression. Throws std::runtime_error with position of the syntax error.
+     */
+    explicit TExpression(const std::string& text);
+
+    //! Source text of the expression
+    const std::string& GetText() const;
+
+    //! Names of variables in order of their first appearance
+    const std::vector<std::string>& GetVariables() const;
+
+    //! Number of elements of the stack required for evaluation
+    size_t GetStackSize() const;
+
+    //! Number of bytecode instructions
+    size_t GetSize() const;
+
+    /**
+     * @brief Compute the expression.
+     *
+     * @param variables Values of variables in order of GetVariables()
+     * @param stack Buffer of GetStackSize() elements
+     * @return Result, it can be NaN or infinity, e.g. after division by zero
+     */
+    double Evaluate(const double* variables, double* stack) const;
+
+private:
+    enum class TOpCode : uint8_t
+    {
+        Constant,
+        Variable,
+        Negate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        Abs,
+        Sqrt,
+        Min,
+        Max
+    };
+
+    struct TInstruction
+    {
+        TOpCode Op;
+
+        //! Index in Constants for Constant instruction, index in Variables for Variable instruction
+        uint32_t Arg;
+    };
+
+    std::string               Text;
+    std::vector<std::string>  Variables;
+    std::vector<TInstruction> Code;
+    std::vector<double>       Constants;
+    size_t                    StackSize;
+
+    //! Compute operation, y is ignored by unary operations
+    static double Apply(TOpCode op, double x, double y);
+
+    friend class TExpressionParser;
+};
@@ -1,8 +1,13 @@
 #include "file_utils.h"
 
+#include <cctype>
 #include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <iomanip>
+#include <iterator>
+#include <limits>
+#include <unistd.h>
 
 TNoDirError::TNoDirError(const std::string& msg) : std::runtime_error(msg) {}
 
@@ -18,6 +23,32 @@ bool TryOpen(const std::vector<std::string>& fnames, std::ifstream& file)
     return false;
 }
 
+bool TFileContentsCache::Read(const std::vector<std::string>& fnames, std::string& contents)
+{
+    for (const auto& fname : fnames) {
+        auto it = Files.find(fname);
+        if (it == Files.end()) {
+            std::unique_ptr<std::string> data;
+            std::ifstream                f(fname);
+            ++ReadCount;
+            if (f.is_open()) {
+                data.reset(new std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+            }
+            it = Files.emplace(fname, std::move(data)).first;
+        }
+        if (it->second) {
+            contents = *it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t TFileContentsCache::GetReadCount() const
+{
+    return ReadCount;
+}
+
 void WriteToFile(const std::string& fileName, const std::string& value)
 {
     std::ofstream f;
@@ -49,3 +80,85 @@ std::string IterateDir(const std::string&                      dirName,
     }
     return std::string();
 }
+
+bool ParseInt(const char* buf, size_t size, int32_t& value)
+{
+    const char* end = buf + size;
+    while (buf != end && isspace(*buf)) {
+        ++buf;
+    }
+    bool negative = false;
+    if (buf != end && (*buf == '-' || *buf == '+')) {
+        negative = (*buf == '-');
+        ++buf;
+    }
+    if (buf == end || !isdigit(*buf)) {
+        return false;
+    }
+    int64_t res = 0;
+    for (; buf != end && isdigit(*buf); ++buf) {
+        res = res * 10 + (*buf - '0');
+        if (res > -static_cast<int64_t>(std::numeric_limits<int32_t>::min())) {
+            return false;
+        }
+    }
+    for (; buf != end; ++buf) {
+        if (!isspace(*buf)) {
+            return false;
+        }
+    }
+    if (negative) {
+        res = -res;
+    }
+    if (res > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    value = res;
+    return true;
+}
+
+TSysfsAttribute::TSysfsAttribute(const std::string& fileName) : FileName(fileName)
+{
+    Fd = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+TSysfsAttribute::TSysfsAttribute(TSysfsAttribute&& other) noexcept
+    : FileName(std::move(other.FileName)), Fd(other.Fd)
+{
+    other.Fd = -1;
+}
+
+TSysfsAttribute::~TSysfsAttribute()
+{
+    Close();
+}
+
+bool TSysfsAttribute::ReadInt(int32_t& value)
+{
+    if (Fd < 0) {
+        Fd = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (Fd < 0) {
+            return false;
+        }
+    }
+    char    buf[32];
+    ssize_t len = pread(Fd, buf, sizeof(buf), 0);
+    if (len > 0 && static_cast<size_t>(len) < sizeof(buf) && ParseInt(buf, len, value)) {
+        return true;
+    }
+    Close();
+    return false;
+}
+
+const std::string& TSysfsAttribute::GetFileName() const
+{
+    return FileName;
+}
+
+void TSysfsAttribute::Close()
+{
+    if (Fd >= 0) {
+        close(Fd);
+        Fd = -1;
+    }
+}
@@ -2,6 +2,9 @@
 
 #include <fstream>
 #include <functional>
+#include <map>
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
 /**
@@ -14,6 +17,33 @@
  */
 bool TryOpen(const std::vector<std::string>& fnames, std::ifstream& file);
 
+/**
+ * @brief Cache of contents of small files. It is used during startup, so sysfs attributes shared
+ * by channels of an IIO device (e.g. in_voltage_scale_available) are read once. Not thread-safe.
+ */
+class TFileContentsCache
+{
+public:
+    /**
+     * @brief Get contents of the first existing file listed in fnames. Contents of read files and
+     * absence of files are cached.
+     *
+     * @param fnames Vector of filenames to try to read
+     * @param contents Contents of the found file
+     * @return true One of files is read successfully
+     * @return false Nothing is read
+     */
+    bool Read(const std::vector<std::string>& fnames, std::string& contents);
+
+    //! Number of files opened by Read
+    size_t GetReadCount() const;
+
+private:
+    //! File name -> contents or nullptr if the file can't be opened
+    std::map<std::string, std::unique_ptr<std::string>> Files;
+    size_t                                              ReadCount = 0;
+};
+
 /**
  * @brief Open file. Throw exception on failure.
  *
@@ -58,3 +88,55 @@ public:
 std::string IterateDir(const std::string&                      dirName,
                        const std::string&                      pattern,
                        std::function<bool(const std::string&)> fn);
+
+/**
+ * @brief Parse decimal integer from a buffer without memory allocations. Leading and trailing
+ * whitespaces are allowed.
+ *
+ * @param buf Buffer with text representation of the value. It must not be zero terminated
+ * @param size Number of characters in buf
+ * @param value Parsed value
+ * @return true The buffer contains a valid integer
+ * @return false The buffer is empty, contains something except an integer or the value is out of
+ * int32_t range
+ */
+bool ParseInt(const char* buf, size_t size, int32_t& value);
+
+/**
+ * @brief The class keeps a file open and reads it from the beginning with pread on every request.
+ * It is intended for sysfs attributes which are regenerated on each read. If reading fails, the
+ * file is closed and reopened on the next request.
+ */
+class TSysfsAttribute
+{
+public:
+    /**
+     * @brief Construct a new TSysfsAttribute object and try to open the file. Open failures are
+     * not reported, the file will be reopened on the next ReadInt call.
+     *
+     * @param fileName Name of file
+     */
+    explicit TSysfsAttribute(const std::string& fileName);
+    TSysfsAttribute(TSysfsAttribute&& other) noexcept;
+    ~TSysfsAttribute();
+
+    TSysfsAttribute(const TSysfsAttribute&) = delete;
+    TSysfsAttribute& operator=(const TSysfsAttribute&) = delete;
+
+    /**
+     * @brief Read integer value from the file.
+     *
+     * @param value Read value
+     * @return true Value is read successfully
+     * @return false The file can't be opened, read or its contents is not an integer
+     */
+    bool ReadInt(int32_t& value);
+
+    const std::string& GetFileName() const;
+
+private:
+    std::string FileName;
+    int         Fd;
+
+    void Close();
+};
@@ -0,0 +1,228 @@
+#include "filters.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+
+#include "moving_average.h"
+
+namespace
+{
+    void CheckWindowSize(size_t windowSize)
+    {
+        if (windowSize == 0) {
+            throw std::runtime_error("Filter window size can't be zero");
+        }
+    }
+} // namespace
+
+TFilterType ParseFilterType(const std::string& name)
+{
+    if (name == "average") {
+        return TFilterType::Average;
+    }
+    if (name == "median") {
+        return TFilterType::Median;
+    }
+    if (name == "trimmed_mean") {
+        return TFilterType::TrimmedMean;
+    }
+    if (name == "ema") {
+        return TFilterType::Ema;
+    }
+    if (name == "min") {
+        return TFilterType::Min;
+    }
+    if (name == "max") {
+        return TFilterType::Max;
+    }
+    throw std::runtime_error("Unknown filter: " + name);
+}
+
+std::unique_ptr<TValueFilter> MakeFilter(TFilterType type, size_t windowSize, uint32_t trimPercent)
+{
+    switch (type) {
+        case TFilterType::Median:
+            return std::unique_ptr<TValueFilter>(new TOrderStatisticFilter(windowSize, windowSize));
+        case TFilterType::TrimmedMean:
+            return std::unique_ptr<TValueFilter>(
+                new TOrderStatisticFilter(windowSize, windowSize * trimPercent / 100));
+        case TFilterType::Ema:
+            return std::unique_ptr<TValueFilter>(new TExponentialFilter(windowSize));
+        case TFilterType::Min:
+            return std::unique_ptr<TValueFilter>(new TWindowExtremumFilter(windowSize, false));
+        case TFilterType::Max:
+            return std::unique_ptr<TValueFilter>(new TWindowExtremumFilter(windowSize, true));
+        case TFilterType::Average:
+        default:
+            return std::unique_ptr<TValueFilter>(new TMovingAverageCalculator(windowSize));
+    }
+}
+
+TOrderStatisticFilter::TOrderStatisticFilter(size_t windowSize, size_t trimCount)
+    : Pos(0), Ready(false), MidSum(0)
+{
+    CheckWindowSize(windowSize);
+    LastValues.resize(windowSize);
+    TrimCount = std::min(trimCount, (windowSize - 1) / 2);
+}
+
+void TOrderStatisticFilter::AddValue(int32_t value)
+{
+    if (Ready) {
+        Remove(LastValues[Pos]);
+        Insert(value);
+        Balance();
+    }
+    LastValues[Pos] = value;
+    ++Pos;
+    Pos %= LastValues.size();
+    if (Pos == 0 && !Ready) {
+        // the window is full for the first time, sort it once and then update incrementally
+        std::vector<int32_t> sorted(LastValues);
+        std::sort(sorted.begin(), sorted.end());
+        Low.insert(sorted.begin(), sorted.begin() + TrimCount);
+        Mid.insert(sorted.begin() + TrimCount, sorted.end() - TrimCount);
+        High.insert(sorted.end() - TrimCount, sorted.end());
+        for (auto v : Mid) {
+            MidSum += v;
+        }
+        Ready = true;
+    }
+}
+
+int32_t TOrderStatisticFilter::GetValue() const
+{
+    return DivideToFixedPoint(MidSum, Mid.size(), 0);
+}
+
+int64_t TOrderStatisticFilter::GetFixedPointValue(uint32_t fractionalBits) const
+{
+    return DivideToFixedPoint(MidSum, Mid.size(), fractionalBits);
+}
+
+bool TOrderStatisticFilter::IsReady() const
+{
+    return Ready;
+}
+
+void TOrderStatisticFilter::Insert(int32_t value)
+{
+    if (!Low.empty() && value < *Low.rbegin()) {
+        Low.insert(value);
+    } else if (!High.empty() && value > *High.begin()) {
+        High.insert(value);
+    } else {
+        Mid.insert(value);
+        MidSum += value;
+    }
+}
+
+void TOrderStatisticFilter::Remove(int32_t value)
+{
+    // equal values are interchangeable, so any set containing the value can be used
+    if (!Low.empty() && value <= *Low.rbegin()) {
+        Low.erase(Low.find(value));
+    } else if (!High.empty() && value >= *High.begin()) {
+        High.erase(High.find(value));
+    } else {
+        Mid.erase(Mid.find(value));
+        MidSum -= value;
+    }
+}
+
+void TOrderStatisticFilter::Balance()
+{
+    // after removing and inserting of a value sizes differ from TrimCount at most by one
+    if (Low.size() > TrimCount) {
+        MoveToMid(Low, std::prev(Low.end()));
+    }
+    if (High.size() > TrimCount) {
+        MoveToMid(High, High.begin());
+    }
+    if (Low.size() < TrimCount) {
+        MoveFromMid(Low, Mid.begin());
+    }
+    if (High.size() < TrimCount) {
+        MoveFromMid(High, std::prev(Mid.end()));
+    }
+}
+
+void TOrderStatisticFilter::MoveToMid(std::multiset<int32_t>& from, std::multiset<int32_t>::iterator it)
+{
+    Mid.insert(*it);
+    MidSum += *it;
+    from.erase(it);
+}
+
+void TOrderStatisticFilter::MoveFromMid(std::multiset<int32_t>& to, std::multiset<int32_t>::iterator it)
+{
+    to.insert(*it);
+    MidSum -= *it;
+    Mid.erase(it);
+}
+
+TExponentialFilter::TExponentialFilter(size_t windowSize) : Value(0), WindowSize(windowSize), Count(0)
+{
+    CheckWindowSize(windowSize);
+    Alpha = 2.0 / (windowSize + 1);
+}
+
+void TExponentialFilter::AddValue(int32_t value)
+{
+    if (Count == 0) {
+        Value = value;
+    } else {
+        Value += Alpha * (value - Value);
+    }
+    if (Count < WindowSize) {
+        ++Count;
+    }
+}
+
+int32_t TExponentialFilter::GetValue() const
+{
+    return std::round(Value);
+}
+
+int64_t TExponentialFilter::GetFixedPointValue(uint32_t fractionalBits) const
+{
+    return std::llround(std::ldexp(Value, fractionalBits));
+}
+
+bool TExponentialFilter::IsReady() const
+{
+    return Count >= WindowSize;
+}
+
+TWindowExtremumFilter::TWindowExtremumFilter(size_t windowSize, bool findMax)
+    : WindowSize(windowSize), Count(0), FindMax(findMax)
+{
+    CheckWindowSize(windowSize);
+}
+
+void TWindowExtremumFilter::AddValue(int32_t value)
+{
+    // values which can't become the extremum while the new one is in the window are dropped
+    while (!Candidates.empty() &&
+           (FindMax ? Candidates.back().Value <= value : Candidates.back().Value >= value))
+    {
+        Candidates.pop_back();
+    }
+    Candidates.push_back(TItem{Count, value});
+    ++Count;
+    // the window contains values with indexes [Count - WindowSize, Count - 1]
+    if (Candidates.front().Index + WindowSize < Count) {
+        Candidates.pop_front();
+    }
+}
+
+int32_t TWindowExtremumFilter::GetValue() const
+{
+    return Candidates.front().Value;
+}
+
+bool TWindowExtremumFilter::IsReady() const
+{
+    return Count >= WindowSize;
+}
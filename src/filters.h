@@ -0,0 +1,149 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "value_filter.h"
+
+//! Filters which can be selected for a channel
+enum class TFilterType
+{
+    //! Moving average, TMovingAverageCalculator
+    Average,
+
+    //! Median of the window, TOrderStatisticFilter
+    Median,
+
+    //! Average of the window without the smallest and the biggest values, TOrderStatisticFilter
+    TrimmedMean,
+
+    //! Exponential moving average, TExponentialFilter
+    Ema,
+
+    //! Minimum of the window, TWindowExtremumFilter
+    Min,
+
+    //! Maximum of the window, TWindowExtremumFilter
+    Max
+};
+
+/**
+ * @brief Get filter type by its name from config. Throws std::runtime_error on unknown name.
+ *
+ * @param name "average", "median", "trimmed_mean", "ema", "min" or "max"
+ */
+TFilterType ParseFilterType(const std::string& name);
+
+/**
+ * @brief Create filter. Throws std::runtime_error if windowSize == 0.
+ *
+ * @param type Type of the filter
+ * @param windowSize Number of values the result is calculated from
+ * @param trimPercent Percent of values dropped from each side of the window by trimmed mean filter
+ */
+std::unique_ptr<TValueFilter> MakeFilter(TFilterType type, size_t windowSize, uint32_t trimPercent);
+
+/**
+ * @brief The class calculates average of the window without trimCount smallest and trimCount
+ * biggest values. If trimCount == (windowSize - 1) / 2 the result is a median.
+ *
+ * Sorted window is kept in three multisets: Low (trimCount smallest values), Mid and High
+ * (trimCount biggest values), so adding of a value costs O(log(windowSize)).
+ */
+class TOrderStatisticFilter : public TValueFilter
+{
+    std::vector<int32_t>    LastValues;
+    size_t                  Pos;
+    bool                    Ready;
+    size_t                  TrimCount;
+    std::multiset<int32_t>  Low;
+    std::multiset<int32_t>  Mid;
+    std::multiset<int32_t>  High;
+    int64_t                 MidSum;
+
+    void Insert(int32_t value);
+    void Remove(int32_t value);
+    void Balance();
+    void MoveToMid(std::multiset<int32_t>& from, std::multiset<int32_t>::iterator it);
+    void MoveFromMid(std::multiset<int32_t>& to, std::multiset<int32_t>::iterator it);
+
+public:
+    /**
+     * @brief Construct a new TOrderStatisticFilter object
+     *
+     * @param windowSize Number of values in the window. If windowSize == 0 std::runtime_error is thrown
+     * @param trimCount Number of values dropped from each side of the sorted window.
+     * It is limited by (windowSize - 1) / 2
+     */
+    TOrderStatisticFilter(size_t windowSize, size_t trimCount);
+
+    void    AddValue(int32_t value) override;
+    int32_t GetValue() const override;
+    int64_t GetFixedPointValue(uint32_t fractionalBits) const override;
+
+    //! The value is valid after processing of at least windowSize values
+    bool IsReady() const override;
+};
+
+/**
+ * @brief The class calculates exponential moving average with smoothing factor 2 / (windowSize + 1).
+ * So the filter has the same center of mass as moving average with the same window.
+ */
+class TExponentialFilter : public TValueFilter
+{
+    double Alpha;
+    double Value;
+    size_t WindowSize;
+    size_t Count;
+
+public:
+    /**
+     * @brief Construct a new TExponentialFilter object
+     *
+     * @param windowSize Equivalent window size. If windowSize == 0 std::runtime_error is thrown
+     */
+    TExponentialFilter(size_t windowSize);
+
+    void    AddValue(int32_t value) override;
+    int32_t GetValue() const override;
+    int64_t GetFixedPointValue(uint32_t fractionalBits) const override;
+
+    //! The value is valid after processing of at least windowSize values
+    bool IsReady() const override;
+};
+
+/**
+ * @brief The class finds minimum or maximum of the window. Candidates are kept in a monotonic
+ * deque, so adding of a value costs amortized O(1).
+ */
+class TWindowExtremumFilter : public TValueFilter
+{
+    struct TItem
+    {
+        uint64_t Index;
+        int32_t  Value;
+    };
+
+    std::deque<TItem> Candidates;
+    size_t            WindowSize;
+    uint64_t          Count;
+    bool              FindMax;
+
+public:
+    /**
+     * @brief Construct a new TWindowExtremumFilter object
+     *
+     * @param windowSize Number of values in the window. If windowSize == 0 std::runtime_error is thrown
+     * @param findMax true - find maximum, false - find minimum
+     */
+    TWindowExtremumFilter(size_t windowSize, bool findMax);
+
+    void    AddValue(int32_t value) override;
+    int32_t GetValue() const override;
+
+    //! The value is valid after processing of at least windowSize values
+    bool IsReady() const override;
+};
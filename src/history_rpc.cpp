@@ -0,0 +1,71 @@
+#include "history_rpc.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    //! Limit of samples in one response, so the response fits into a reasonable MQTT message
+    const size_t MAX_SAMPLES_PER_RESPONSE = 100000;
+} // namespace
+
+void THistoryRpcHandler::AddChannel(const std::string& id, std::shared_ptr<const TSampleStore> history, double rawToV)
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    Channels[id] = TChannel{history, rawToV};
+}
+
+void THistoryRpcHandler::RemoveChannel(const std::string& id)
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    Channels.erase(id);
+}
+
+Json::Value THistoryRpcHandler::GetHistory(const Json::Value& request) const
+{
+    if (!request.isObject() || !request["channel"].isString()) {
+        throw std::runtime_error("Channel id is not specified");
+    }
+    std::string id = request["channel"].asString();
+    TChannel    channel;
+    {
+        std::lock_guard<std::mutex> lg(Mutex);
+        auto                        it = Channels.find(id);
+        if (it == Channels.end()) {
+            throw std::runtime_error("Channel " + id + " has no history");
+        }
+        channel = it->second;
+    }
+
+    int64_t fromUs   = std::numeric_limits<int64_t>::min();
+    int64_t toUs     = std::numeric_limits<int64_t>::max();
+    size_t  maxCount = MAX_SAMPLES_PER_RESPONSE;
+    if (request.isMember("from_us")) {
+        fromUs = request["from_us"].asInt64();
+    }
+    if (request.isMember("to_us")) {
+        toUs = request["to_us"].asInt64();
+    }
+    if (request.isMember("max_samples")) {
+        maxCount = std::min<size_t>(request["max_samples"].asUInt(), MAX_SAMPLES_PER_RESPONSE);
+    }
+
+    bool hasMore = false;
+    auto samples = channel.History->Get(fromUs, toUs, maxCount, &hasMore);
+
+    Json::Value res;
+    res["channel"]            = id;
+    res["count"]              = static_cast<Json::UInt64>(samples.size());
+    res["first_timestamp_us"] = static_cast<Json::Int64>(samples.empty() ? 0 : samples.front().TimestampUs);
+    res["raw_to_v"]           = channel.RawToV;
+    res["encoding"]           = "delta-varint-base64";
+    res["data"]               = EncodeBase64(EncodeSampleDeltas(samples));
+    res["has_more"]           = hasMore;
+    return res;
+}
+
+bool THistoryRpcHandler::IsEmpty() const
+{
+    std::lock_guard<std::mutex> lg(Mutex);
+    return Channels.empty();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "sample_history.h"
+
+/**
+ * @brief Handler of "history/get" MQTT RPC. It returns raw samples of a channel from its
+ * TSampleStore.
+ *
+ * Request: {"channel": ID, "from_us": T1, "to_us": T2, "max_samples": N}. All fields except
+ * "channel" are optional. Timestamps are in uS since the epoch.
+ *
+ * Response: {"channel": ID, "count": N, "first_timestamp_us": T, "raw_to_v": K,
+ * "encoding": "delta-varint-base64", "data": "...", "has_more": bool}. Samples are encoded by
+ * EncodeSampleDeltas and base64. Voltage of a sample is raw value multiplied by "raw_to_v".
+ * If "has_more" is true, the next part can be requested from "last timestamp + 1".
+ */
+class THistoryRpcHandler
+{
+public:
+    /**
+     * @brief Add a channel available for requests or update its multiplier. It can be called while
+     * requests are processed
+     *
+     * @param id Channel id from config
+     * @param history History of the channel
+     * @param rawToV Multiplier to convert raw ADC value to V
+     */
+    void AddChannel(const std::string& id, std::shared_ptr<const TSampleStore> history, double rawToV);
+
+    //! Remove the channel if it is added
+    void RemoveChannel(const std::string& id);
+
+    //! Process request. Throws std::runtime_error on bad request
+    Json::Value GetHistory(const Json::Value& request) const;
+
+    bool IsEmpty() const;
+
+private:
+    struct TChannel
+    {
+        std::shared_ptr<const TSampleStore> History;
+        double                              RawToV;
+    };
+
+    mutable std::mutex              Mutex;
+    std::map<std::string, TChannel> Channels;
+};
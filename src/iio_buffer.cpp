@@ -0,0 +1,236 @@
+#include "iio_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "file_utils.h"
+
+namespace
+{
+    const size_t SCANS_PER_READ = 64;
+
+    const char* TIMESTAMP_ELEMENT = "in_timestamp";
+
+    size_t Align(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    std::string ReadString(const std::string& fileName)
+    {
+        std::ifstream f;
+        OpenWithException(f, fileName);
+        std::string res;
+        f >> res;
+        return res;
+    }
+} // namespace
+
+TIIOScanElementType ParseScanElementType(const std::string& typeStr)
+{
+    TIIOScanElementType res;
+    char                endian;
+    char                sign;
+    if (sscanf(typeStr.c_str(),
+               "%ce:%c%u/%uX%u>>%u",
+               &endian,
+               &sign,
+               &res.Bits,
+               &res.StorageBits,
+               &res.Repeat,
+               &res.Shift) != 6)
+    {
+        res.Repeat = 1;
+        if (sscanf(typeStr.c_str(), "%ce:%c%u/%u>>%u", &endian, &sign, &res.Bits, &res.StorageBits, &res.Shift) != 5) {
+            throw std::runtime_error("Bad scan element type: " + typeStr);
+        }
+    }
+    if ((endian != 'b' && endian != 'l') || (sign != 's' && sign != 'u')) {
+        throw std::runtime_error("Bad scan element type: " + typeStr);
+    }
+    if ((res.StorageBits != 8 && res.StorageBits != 16 && res.StorageBits != 32 && res.StorageBits != 64) ||
+        res.Bits == 0 || res.Bits + res.Shift > res.StorageBits || res.Repeat == 0)
+    {
+        throw std::runtime_error("Unsupported scan element type: " + typeStr);
+    }
+    res.BigEndian = (endian == 'b');
+    res.Signed    = (sign == 's');
+    return res;
+}
+
+int64_t DecodeScanElement(const uint8_t* data, const TIIOScanElementType& type)
+{
+    size_t   bytes = type.StorageBits / 8;
+    uint64_t raw   = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        raw |= static_cast<uint64_t>(data[type.BigEndian ? i : bytes - 1 - i]) << ((bytes - 1 - i) * 8);
+    }
+    raw >>= type.Shift;
+    if (type.Bits < 64) {
+        raw &= (static_cast<uint64_t>(1) << type.Bits) - 1;
+        if (type.Signed && (raw & (static_cast<uint64_t>(1) << (type.Bits - 1)))) {
+            raw |= ~((static_cast<uint64_t>(1) << type.Bits) - 1);
+        }
+    }
+    return static_cast<int64_t>(raw);
+}
+
+TIIOBuffer::TIIOBuffer(const std::string&              sysfsIIODir,
+                       const std::string&              devNode,
+                       const std::vector<std::string>& channels,
+                       uint32_t                        bufferLength,
+                       const TStopEvent*               stopEvent)
+    : SysfsIIODir(sysfsIIODir), Fd(-1), TimestampElement(-1), ScanSize(0), DataPos(0), DataSize(0),
+      Timestamp(0), StopEvent(stopEvent)
+{
+    std::string scanDir = SysfsIIODir + "/scan_elements";
+
+    // buffer must be disabled while scan elements and length are changed
+    WriteToFile(SysfsIIODir + "/buffer/enable", "0");
+
+    IterateDir(scanDir, "_en", [&](const std::string& enFile) {
+        const std::string suffix("_en");
+        if (enFile.size() <= scanDir.size() + 1 + suffix.size() ||
+            enFile.compare(enFile.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            return false;
+        }
+        std::string name = enFile.substr(scanDir.size() + 1, enFile.size() - scanDir.size() - 1 - suffix.size());
+        bool        enable = (name == TIMESTAMP_ELEMENT) ||
+                      std::find_if(channels.begin(), channels.end(), [&](const std::string& c) {
+                          return name == "in_" + c;
+                      }) != channels.end();
+        WriteToFile(enFile, enable ? "1" : "0");
+        if (enable) {
+            TScanElement el;
+            el.Name  = name;
+            el.Index = std::stoul(ReadString(scanDir + "/" + name + "_index"));
+            el.Type  = ParseScanElementType(ReadString(scanDir + "/" + name + "_type"));
+            Elements.push_back(el);
+        }
+        return false;
+    });
+
+    // scan elements are placed in order of their indexes and aligned to their full storage size
+    // including repeats, as the kernel does in iio_compute_scan_bytes
+    std::sort(Elements.begin(), Elements.end(), [](const TScanElement& a, const TScanElement& b) {
+        return a.Index < b.Index;
+    });
+    size_t maxStorageBytes = 1;
+    for (auto& el : Elements) {
+        size_t bytes    = el.Type.StorageBits / 8 * el.Type.Repeat;
+        el.Offset       = Align(ScanSize, bytes);
+        ScanSize        = el.Offset + bytes;
+        maxStorageBytes = std::max(maxStorageBytes, bytes);
+    }
+    ScanSize = Align(ScanSize, maxStorageBytes);
+
+    for (const auto& channel : channels) {
+        auto it = std::find_if(Elements.begin(), Elements.end(), [&](const TScanElement& el) {
+            return el.Name == "in_" + channel;
+        });
+        if (it == Elements.end()) {
+            throw std::runtime_error("No scan element for " + channel + " in " + scanDir);
+        }
+        ChannelElements.push_back(it - Elements.begin());
+    }
+    for (size_t i = 0; i < Elements.size(); ++i) {
+        if (Elements[i].Name == TIMESTAMP_ELEMENT) {
+            TimestampElement = i;
+        }
+    }
+
+    Data.resize(ScanSize * SCANS_PER_READ);
+
+    WriteToFile(SysfsIIODir + "/buffer/length", std::to_string(bufferLength));
+    WriteToFile(SysfsIIODir + "/buffer/enable", "1");
+
+    Fd = open(devNode.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (Fd < 0) {
+        WriteToFile(SysfsIIODir + "/buffer/enable", "0");
+        throw std::runtime_error("Can't open " + devNode + ": " + strerror(errno));
+    }
+}
+
+TIIOBuffer::~TIIOBuffer()
+{
+    close(Fd);
+    try {
+        WriteToFile(SysfsIIODir + "/buffer/enable", "0");
+    } catch (...) {
+    }
+}
+
+bool TIIOBuffer::FillData(uint32_t timeoutMs)
+{
+    if (DataPos != 0) {
+        memmove(Data.data(), Data.data() + DataPos, DataSize - DataPos);
+        DataSize -= DataPos;
+        DataPos = 0;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (DataSize < ScanSize) {
+        auto timeLeft =
+            std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+        if (timeLeft.count() < 0) {
+            timeLeft = std::chrono::microseconds(0);
+        }
+        if (StopEvent) {
+            if (!StopEvent->WaitReadable(Fd, timeLeft)) {
+                return false;
+            }
+        } else {
+            pollfd pfd{Fd, POLLIN, 0};
+            if (poll(&pfd, 1, timeLeft.count() / 1000) <= 0) {
+                return false;
+            }
+        }
+        ssize_t n = read(Fd, Data.data() + DataSize, Data.size() - DataSize);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                return false;
+            }
+            continue;
+        }
+        DataSize += n;
+    }
+    return true;
+}
+
+bool TIIOBuffer::ReadScan(std::vector<int32_t>& values, uint32_t timeoutMs)
+{
+    if (DataSize - DataPos < ScanSize && !FillData(timeoutMs)) {
+        return false;
+    }
+    const uint8_t* scan = Data.data() + DataPos;
+    values.resize(ChannelElements.size());
+    for (size_t i = 0; i < ChannelElements.size(); ++i) {
+        const auto& el = Elements[ChannelElements[i]];
+        values[i]      = DecodeScanElement(scan + el.Offset, el.Type);
+    }
+    if (TimestampElement >= 0) {
+        const auto& el = Elements[TimestampElement];
+        Timestamp      = DecodeScanElement(scan + el.Offset, el.Type);
+    }
+    DataPos += ScanSize;
+    return true;
+}
+
+int64_t TIIOBuffer::GetTimestamp() const
+{
+    return Timestamp;
+}
+
+size_t TIIOBuffer::GetScanSize() const
+{
+    return ScanSize;
+}
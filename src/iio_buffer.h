@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "stop_event.h"
+
+/**
+ * @brief Storage format of a scan element as described by scan_elements/in_XXX_type file.
+ * Format of the file is [be|le]:[s|u]bits/storagebitsXrepeat>>shift
+ */
+struct TIIOScanElementType
+{
+    bool     BigEndian   = false;
+    bool     Signed      = false;
+    uint32_t Bits        = 0;
+    uint32_t StorageBits = 0;
+    uint32_t Repeat      = 1;
+    uint32_t Shift       = 0;
+};
+
+/**
+ * @brief Parse contents of scan_elements/in_XXX_type file. Throws runtime_error on parse error.
+ *
+ * @param typeStr String like "le:s12/16>>4"
+ */
+TIIOScanElementType ParseScanElementType(const std::string& typeStr);
+
+/**
+ * @brief Decode single scan element value.
+ *
+ * @param data Pointer to the element in a scan record
+ * @param type Storage format of the element
+ */
+int64_t DecodeScanElement(const uint8_t* data, const TIIOScanElementType& type);
+
+/**
+ * @brief The class streams scan records from IIO device's character device (/dev/iio:deviceN).
+ * It enables requested channels in scan_elements folder, sets buffer length and enables the
+ * buffer. If the device has in_timestamp scan element, it is enabled too.
+ */
+class TIIOBuffer
+{
+public:
+    /**
+     * @brief Construct a new TIIOBuffer object. Throws runtime_error on configuration failure.
+     *
+     * @param sysfsIIODir Sysfs device's folder
+     * @param devNode Character device to read scans from
+     * @param channels IIO channels to enable ("voltageX")
+     * @param bufferLength Number of scans in kernel buffer
+     * @param stopEvent Event to interrupt waiting for data. If nullptr, waits are not interruptible
+     */
+    TIIOBuffer(const std::string&              sysfsIIODir,
+               const std::string&              devNode,
+               const std::vector<std::string>& channels,
+               uint32_t                        bufferLength,
+               const TStopEvent*               stopEvent = nullptr);
+    ~TIIOBuffer();
+
+    TIIOBuffer(const TIIOBuffer&) = delete;
+    TIIOBuffer& operator=(const TIIOBuffer&) = delete;
+
+    /**
+     * @brief Read next scan.
+     *
+     * @param values Decoded values of channels in order given to constructor
+     * @param timeoutMs Maximum time to wait for data
+     * @return true Scan is read
+     * @return false No data during timeoutMs, end of file or stop event is set
+     */
+    bool ReadScan(std::vector<int32_t>& values, uint32_t timeoutMs);
+
+    //! Timestamp of the last read scan in nS or 0 if the device has no in_timestamp scan element
+    int64_t GetTimestamp() const;
+
+    //! Size of a scan record in bytes
+    size_t GetScanSize() const;
+
+private:
+    struct TScanElement
+    {
+        std::string         Name;
+        uint32_t            Index;
+        TIIOScanElementType Type;
+        size_t              Offset;
+    };
+
+    std::string               SysfsIIODir;
+    int                       Fd;
+    std::vector<TScanElement> Elements;
+    std::vector<size_t>       ChannelElements;
+    int                       TimestampElement;
+    size_t                    ScanSize;
+    std::vector<uint8_t>      Data;
+    size_t                    DataPos;
+    size_t                    DataSize;
+    int64_t                   Timestamp;
+    const TStopEvent*         StopEvent;
+
+    bool FillData(uint32_t timeoutMs);
+};
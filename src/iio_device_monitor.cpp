@@ -0,0 +1,42 @@
+#include "iio_device_monitor.h"
+
+#include <errno.h>
+#include <sys/inotify.h>
+#include <system_error>
+#include <unistd.h>
+
+TIIODeviceMonitor::TIIODeviceMonitor(const std::string& devicesDir, std::chrono::milliseconds rescanInterval)
+    : RescanInterval(rescanInterval)
+{
+    Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (Fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "inotify_init1 failed");
+    }
+    WatchFd = inotify_add_watch(Fd,
+                                devicesDir.c_str(),
+                                IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+}
+
+TIIODeviceMonitor::~TIIODeviceMonitor()
+{
+    close(Fd);
+}
+
+bool TIIODeviceMonitor::Wait(const TStopEvent& stopEvent)
+{
+    if (WatchFd < 0) {
+        return stopEvent.WaitFor(RescanInterval);
+    }
+    if (stopEvent.WaitReadable(Fd, RescanInterval)) {
+        // events only trigger a rescan, so their contents is not needed
+        char buf[4096];
+        while (read(Fd, buf, sizeof(buf)) > 0) {
+        }
+    }
+    return !stopEvent.IsSet();
+}
+
+bool TIIODeviceMonitor::IsWatching() const
+{
+    return WatchFd >= 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "stop_event.h"
+
+/**
+ * @brief Waits for appearance and disappearance of IIO devices. Additions and removals of
+ * iio:deviceN entries are watched by inotify. Sysfs doesn't report entries created by the kernel
+ * through inotify, so the waiting also ends after the rescan interval. The caller rescans the
+ * folder after every wakeup, e.g. by TIIODeviceIndex::Rescan.
+ */
+class TIIODeviceMonitor
+{
+public:
+    /**
+     * @brief Construct a new TIIODeviceMonitor object. If the folder can't be watched,
+     * only periodic rescans are used. Throws std::system_error if inotify instance can't be created.
+     *
+     * @param devicesDir Folder with iio:deviceN symlinks
+     * @param rescanInterval Maximum time between wakeups
+     */
+    TIIODeviceMonitor(const std::string& devicesDir, std::chrono::milliseconds rescanInterval);
+    ~TIIODeviceMonitor();
+
+    TIIODeviceMonitor(const TIIODeviceMonitor&) = delete;
+    TIIODeviceMonitor& operator=(const TIIODeviceMonitor&) = delete;
+
+    /**
+     * @brief Wait for a change of the folder or for the rescan interval
+     *
+     * @return true The folder must be rescanned
+     * @return false The stop event is set
+     */
+    bool Wait(const TStopEvent& stopEvent);
+
+    //! true if the folder is watched by inotify
+    bool IsWatching() const;
+
+private:
+    int                       Fd;
+    int                       WatchFd;
+    std::chrono::milliseconds RescanInterval;
+};
@@ -0,0 +1,181 @@
+#include "iio_trigger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+#include "file_utils.h"
+
+namespace
+{
+    const std::string SYSFS_TRIGGER_PREFIX = "sysfstrig";
+
+    std::string ReadName(const std::string& fileName)
+    {
+        std::ifstream f(fileName);
+        std::string   res;
+        f >> res;
+        return res;
+    }
+
+    //! Older hrtimer drivers parse sampling_frequency as an unsigned integer, so integral values have no fraction
+    std::string FormatFrequency(double frequency)
+    {
+        if (frequency == floor(frequency)) {
+            return std::to_string(lround(frequency));
+        }
+        return std::to_string(frequency);
+    }
+} // namespace
+
+TIIOTriggerType ParseTriggerType(const std::string& name)
+{
+    if (name == "device") {
+        return TIIOTriggerType::Device;
+    }
+    if (name == "hrtimer") {
+        return TIIOTriggerType::HrTimer;
+    }
+    if (name == "sysfs") {
+        return TIIOTriggerType::Sysfs;
+    }
+    throw std::runtime_error("Unknown trigger type: " + name);
+}
+
+bool operator==(const TIIOTriggerSettings& a, const TIIOTriggerSettings& b)
+{
+    return std::tie(a.Type, a.Name, a.SamplingFrequency) == std::tie(b.Type, b.Name, b.SamplingFrequency);
+}
+
+bool operator!=(const TIIOTriggerSettings& a, const TIIOTriggerSettings& b)
+{
+    return !(a == b);
+}
+
+TIIOTrigger::TIIOTrigger(const TIIOTriggerSettings& settings,
+                         const std::string&         sysfsIIODir,
+                         const std::string&         devicesDir,
+                         const std::string&         configfsDir)
+    : Settings(settings), SysfsIIODir(sysfsIIODir), DevicesDir(devicesDir), AddedSysfsTrigger(-1), TriggerNowFd(-1)
+{
+    if (Settings.Name.empty()) {
+        throw std::runtime_error("Trigger name is not set");
+    }
+    TriggerDir = FindTrigger();
+    // the destructor isn't called if the constructor throws, so created resources are released here
+    try {
+        if (TriggerDir.empty()) {
+            if (Settings.Type == TIIOTriggerType::HrTimer) {
+                CreateHrTimerTrigger(configfsDir);
+            } else if (Settings.Type == TIIOTriggerType::Sysfs) {
+                AddSysfsTrigger();
+            }
+            TriggerDir = FindTrigger();
+            if (TriggerDir.empty()) {
+                throw std::runtime_error("IIO trigger " + Settings.Name + " is not found");
+            }
+        }
+        if (Settings.Type == TIIOTriggerType::HrTimer && Settings.SamplingFrequency > 0) {
+            WriteToFile(TriggerDir + "/sampling_frequency", FormatFrequency(Settings.SamplingFrequency));
+        }
+        if (Settings.Type == TIIOTriggerType::Sysfs) {
+            TriggerNowFd = open((TriggerDir + "/trigger_now").c_str(), O_WRONLY | O_CLOEXEC);
+            if (TriggerNowFd < 0) {
+                throw std::runtime_error("Can't open " + TriggerDir + "/trigger_now");
+            }
+        }
+        WriteToFile(SysfsIIODir + "/trigger/current_trigger", Settings.Name);
+    } catch (...) {
+        if (TriggerNowFd >= 0) {
+            close(TriggerNowFd);
+            TriggerNowFd = -1;
+        }
+        RemoveCreatedTrigger();
+        throw;
+    }
+}
+
+TIIOTrigger::~TIIOTrigger()
+{
+    if (TriggerNowFd >= 0) {
+        close(TriggerNowFd);
+    }
+    try {
+        WriteToFile(SysfsIIODir + "/trigger/current_trigger", "\n");
+    } catch (const std::exception&) {
+        // the device can be already removed
+    }
+    RemoveCreatedTrigger();
+}
+
+bool TIIOTrigger::NeedsFiring() const
+{
+    return TriggerNowFd >= 0;
+}
+
+bool TIIOTrigger::Fire()
+{
+    return pwrite(TriggerNowFd, "1", 1, 0) == 1;
+}
+
+const std::string& TIIOTrigger::GetTriggerDir() const
+{
+    return TriggerDir;
+}
+
+std::string TIIOTrigger::FindTrigger() const
+{
+    try {
+        return IterateDir(DevicesDir, "trigger", [&](const std::string& d) {
+            return ReadName(d + "/name") == Settings.Name;
+        });
+    } catch (const TNoDirError&) {
+        return std::string();
+    }
+}
+
+void TIIOTrigger::CreateHrTimerTrigger(const std::string& configfsDir)
+{
+    std::string dir = configfsDir + "/hrtimer/" + Settings.Name;
+    if (mkdir(dir.c_str(), 0755) != 0) {
+        if (errno != EEXIST) {
+            throw std::runtime_error("Can't create hrtimer trigger " + dir);
+        }
+    } else {
+        CreatedHrTimerDir = dir;
+    }
+}
+
+void TIIOTrigger::AddSysfsTrigger()
+{
+    if (Settings.Name.compare(0, SYSFS_TRIGGER_PREFIX.size(), SYSFS_TRIGGER_PREFIX) != 0) {
+        throw std::runtime_error("Sysfs trigger name must be " + SYSFS_TRIGGER_PREFIX + "N: " + Settings.Name);
+    }
+    int n;
+    try {
+        n = std::stoi(Settings.Name.substr(SYSFS_TRIGGER_PREFIX.size()));
+    } catch (const std::exception&) {
+        throw std::runtime_error("Sysfs trigger name must be " + SYSFS_TRIGGER_PREFIX + "N: " + Settings.Name);
+    }
+    WriteToFile(DevicesDir + "/iio_sysfs_trigger/add_trigger", std::to_string(n));
+    AddedSysfsTrigger = n;
+}
+
+void TIIOTrigger::RemoveCreatedTrigger()
+{
+    if (!CreatedHrTimerDir.empty()) {
+        rmdir(CreatedHrTimerDir.c_str());
+        CreatedHrTimerDir.clear();
+    }
+    if (AddedSysfsTrigger >= 0) {
+        try {
+            WriteToFile(DevicesDir + "/iio_sysfs_trigger/remove_trigger", std::to_string(AddedSysfsTrigger));
+        } catch (const std::exception&) {
+        }
+        AddedSysfsTrigger = -1;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+
+//! Source of scans of IIO buffer
+enum class TIIOTriggerType
+{
+    //! Trigger of IIO device is not changed
+    None,
+
+    //! Existing trigger, e.g. data ready trigger of the device
+    Device,
+
+    //! High resolution timer trigger created through configfs
+    HrTimer,
+
+    //! Software trigger fired by the driver before reading every scan
+    Sysfs
+};
+
+/**
+ * @brief Get trigger type by its name from config. Throws std::runtime_error on unknown name.
+ *
+ * @param name "device", "hrtimer" or "sysfs"
+ */
+TIIOTriggerType ParseTriggerType(const std::string& name);
+
+//! Trigger settings of IIO buffer
+struct TIIOTriggerSettings
+{
+    TIIOTriggerType Type = TIIOTriggerType::None;
+
+    //! Name of the trigger. Sysfs triggers are named "sysfstrigN"
+    std::string Name;
+
+    //! Frequency of hrtimer trigger in Hz. If 0, it is not changed
+    double SamplingFrequency = 0;
+};
+
+bool operator==(const TIIOTriggerSettings& a, const TIIOTriggerSettings& b);
+bool operator!=(const TIIOTriggerSettings& a, const TIIOTriggerSettings& b);
+
+/**
+ * @brief The class finds or creates an IIO trigger and makes it current trigger of an IIO device,
+ * so all enabled channels of the device are captured in the same scan on every trigger event.
+ * The trigger must be set before the device's buffer is enabled. Created triggers are removed in
+ * destructor.
+ */
+class TIIOTrigger
+{
+public:
+    /**
+     * @brief Construct a new TIIOTrigger object. Throws std::runtime_error if the trigger can't be
+     * found or created.
+     *
+     * @param settings Trigger settings, Type must not be None
+     * @param sysfsIIODir Sysfs device's folder
+     * @param devicesDir Folder with triggerN and iio_sysfs_trigger entries
+     * @param configfsDir Folder of IIO triggers in configfs
+     */
+    TIIOTrigger(const TIIOTriggerSettings& settings,
+                const std::string&         sysfsIIODir,
+                const std::string&         devicesDir  = "/sys/bus/iio/devices",
+                const std::string&         configfsDir = "/sys/kernel/config/iio/triggers");
+    ~TIIOTrigger();
+
+    TIIOTrigger(const TIIOTrigger&) = delete;
+    TIIOTrigger& operator=(const TIIOTrigger&) = delete;
+
+    //! true if scans are captured only after Fire()
+    bool NeedsFiring() const;
+
+    //! Fire sysfs trigger. Returns false on failure
+    bool Fire();
+
+    //! Folder of the trigger in devicesDir
+    const std::string& GetTriggerDir() const;
+
+private:
+    TIIOTriggerSettings Settings;
+    std::string         SysfsIIODir;
+    std::string         DevicesDir;
+    std::string         TriggerDir;
+
+    //! Folder created in configfs for hrtimer trigger, empty if the trigger existed before
+    std::string CreatedHrTimerDir;
+
+    //! Number of sysfs trigger added by the object, -1 if the trigger existed before
+    int AddedSysfsTrigger;
+
+    //! Opened trigger_now file of sysfs trigger
+    int TriggerNowFd;
+
+    std::string FindTrigger() const;
+    void        CreateHrTimerTrigger(const std::string& configfsDir);
+    void        AddSysfsTrigger();
+    void        RemoveCreatedTrigger();
+};
@@ -4,6 +4,7 @@
 
 #include <functional>
 #include <wblib/log.h>
+#include <wblib/rpc.h>
 #include <wblib/signal_handling.h>
 #include <wblib/wbmqtt.h>
 
@@ -145,7 +146,7 @@ int main(int argc, char* argv[])
 
     TPromise<void> initialized;
     SetThreadName("wb-mqtt-adc");
-    SignalHandling::Handle({SIGINT, SIGTERM});
+    SignalHandling::Handle({SIGINT, SIGTERM, SIGHUP});
     SignalHandling::OnSignals({SIGINT, SIGTERM}, [&] { SignalHandling::Stop(); });
 
     /* if signal arrived before driver is initialized:
@@ -167,9 +168,10 @@ int main(int argc, char* argv[])
     SignalHandling::Start();
 
     try {
+        auto mqttClient = NewMosquittoMqttClient(mqttConfig);
         auto mqttDriver =
             NewDriver(TDriverArgs{}
-                          .SetBackend(NewDriverBackend(NewMosquittoMqttClient(mqttConfig)))
+                          .SetBackend(NewDriverBackend(mqttClient))
                           .SetId(mqttConfig.Id)
                           .SetUseStorage(false)
                           .SetReownUnknownDevices(true));
@@ -182,17 +184,36 @@ int main(int argc, char* argv[])
 
         mqttDriver->WaitForReady();
 
-        TConfig config = LoadConfig("/etc/wb-mqtt-adc.conf",
-                                    customConfig,
-                                    "/var/lib/wb-mqtt-adc/conf.d",
-                                    "/usr/share/wb-mqtt-confed/schemas/wb-mqtt-adc.schema.json");
+        auto loadConfig = [&] {
+            return LoadConfig("/etc/wb-mqtt-adc.conf",
+                              customConfig,
+                              "/var/lib/wb-mqtt-adc/conf.d",
+                              "/usr/share/wb-mqtt-confed/schemas/wb-mqtt-adc.schema.json");
+        };
+        TConfig config = loadConfig();
 
         if (config.EnableDebugMessages)
             DebugLogger.SetEnabled(true);
 
-        TADCDriver driver(mqttDriver, config, ErrorLogger, DebugLogger, InfoLogger);
+        auto rpcServer = NewMqttRpcServer(mqttClient, mqttConfig.Id);
 
-        SignalHandling::OnSignals({SIGINT, SIGTERM}, [&] { driver.Stop(); });
+        TADCDriver driver(mqttDriver, config, ErrorLogger, DebugLogger, InfoLogger, rpcServer, mqttClient);
+
+        rpcServer->Start();
+
+        // the running config is kept if the new one is invalid
+        SignalHandling::OnSignals({SIGHUP}, [&] {
+            InfoLogger.Log() << "Reloading config";
+            try {
+                driver.Reload(loadConfig());
+            } catch (const exception& e) {
+                ErrorLogger.Log() << "Can't reload config: " << e.what();
+            }
+        });
+        SignalHandling::OnSignals({SIGINT, SIGTERM}, [&] {
+            rpcServer->Stop();
+            driver.Stop();
+        });
 
         initialized.Complete();
         SignalHandling::Wait();
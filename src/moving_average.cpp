@@ -1,8 +1,17 @@
 #include "moving_average.h"
 
-#include <math.h>
 #include <stdexcept>
 
+int64_t DivideToFixedPoint(int64_t sum, int64_t count, uint32_t fractionalBits)
+{
+    // integer and fractional parts are calculated separately, so sum isn't shifted and can't overflow
+    int64_t scale     = static_cast<int64_t>(1) << fractionalBits;
+    int64_t quotient  = sum / count;
+    int64_t remainder = (sum % count) * scale;
+    int64_t fraction  = (2 * remainder + (remainder < 0 ? -count : count)) / (2 * count);
+    return quotient * scale + fraction;
+}
+
 TMovingAverageCalculator::TMovingAverageCalculator(size_t windowSize) : Sum(0), Pos(0), Ready(false)
 {
     if(windowSize == 0) {
@@ -16,16 +25,25 @@ void TMovingAverageCalculator::AddValue(int32_t value)
     Sum -= (Ready ? LastValues[Pos] : 0);
     LastValues[Pos] = value;
     Sum += value;
-    ++Pos;
-    Pos %= LastValues.size();
-    if (Pos == 0) {
+    if (++Pos == LastValues.size()) {
+        Pos   = 0;
         Ready = true;
     }
 }
 
 int32_t TMovingAverageCalculator::GetAverage() const
 {
-    return std::round(Sum / (double)LastValues.size());
+    return DivideToFixedPoint(Sum, LastValues.size(), 0);
+}
+
+int64_t TMovingAverageCalculator::GetFixedPointValue(uint32_t fractionalBits) const
+{
+    return DivideToFixedPoint(Sum, LastValues.size(), fractionalBits);
+}
+
+int32_t TMovingAverageCalculator::GetValue() const
+{
+    return GetAverage();
 }
 
 bool TMovingAverageCalculator::IsReady() const
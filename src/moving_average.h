@@ -4,13 +4,24 @@
 #include <stdint.h>
 #include <vector>
 
+#include "value_filter.h"
+
+/**
+ * @brief Divide sum by count and round the result to given number of fractional bits.
+ * Halves are rounded away from zero like std::round does. The calculation is exact if
+ * count * 2^fractionalBits < 2^62.
+ *
+ * @return Fixed-point result with fractionalBits fractional bits
+ */
+int64_t DivideToFixedPoint(int64_t sum, int64_t count, uint32_t fractionalBits);
+
 /**
  * @brief The class calculates moving average from given values.
  */
-class TMovingAverageCalculator
+class TMovingAverageCalculator : public TValueFilter
 {
     std::vector<int32_t> LastValues;
-    int32_t              Sum;
+    int64_t              Sum;
     size_t               Pos;
     bool                 Ready;
 
@@ -25,13 +36,23 @@ public:
     /**
      * @brief Add new value to data set.
      */
-    void AddValue(int32_t value);
+    void AddValue(int32_t value) override;
 
     /**
      * @brief Get average value. The value is valid only if IsReady() == true.
      */
     int32_t GetAverage() const;
 
+    //! Same as GetAverage()
+    int32_t GetValue() const override;
+
+    /**
+     * @brief Get average value in fixed-point format. The value is valid only if IsReady() == true.
+     *
+     * @param fractionalBits Number of fractional bits, must be less than 32
+     */
+    int64_t GetFixedPointValue(uint32_t fractionalBits) const override;
+
     /**
      * @brief Check if average value is valid. The value is valid after processing of at least
      * windowSize values.
@@ -39,5 +60,5 @@ public:
      * @return true Average value is valid
      * @return false Average value is not valid
      */
-    bool IsReady() const;
+    bool IsReady() const override;
 };
@@ -0,0 +1,77 @@
+#include "publish_policy.h"
+
+#include <algorithm>
+#include <math.h>
+
+TPublishPolicy::TPublishPolicy(const TSettings& settings)
+    : Settings(settings), HasPublished(false), LastIsError(false), LastValue(0), PublishedCount(0),
+      SuppressedCount(0)
+{}
+
+bool TPublishPolicy::ShouldPublishValue(double value, const std::string& text, const TClock::time_point& now)
+{
+    if (HasPublished && !LastIsError && !IsMaxIntervalPassed(now)) {
+        if (!IsMinIntervalPassed(now)) {
+            return Suppress();
+        }
+        bool   changed;
+        double threshold = std::max(Settings.Deadband, fabs(LastValue) * Settings.DeadbandPercent / 100.0);
+        if (threshold > 0) {
+            changed = (fabs(value - LastValue) > threshold);
+        } else {
+            changed = (text != LastText);
+        }
+        if (!changed) {
+            return Suppress();
+        }
+    }
+    LastIsError = false;
+    LastValue   = value;
+    LastText    = text;
+    return Publish(now);
+}
+
+bool TPublishPolicy::ShouldPublishError(const TClock::time_point& now, const std::string& error)
+{
+    if (!HasPublished || !LastIsError || error != LastText || IsMaxIntervalPassed(now)) {
+        LastIsError = true;
+        LastText    = error;
+        return Publish(now);
+    }
+    return Suppress();
+}
+
+uint64_t TPublishPolicy::GetPublishedCount() const
+{
+    return PublishedCount;
+}
+
+uint64_t TPublishPolicy::GetSuppressedCount() const
+{
+    return SuppressedCount;
+}
+
+bool TPublishPolicy::Publish(const TClock::time_point& now)
+{
+    HasPublished    = true;
+    LastPublishTime = now;
+    ++PublishedCount;
+    return true;
+}
+
+bool TPublishPolicy::Suppress()
+{
+    ++SuppressedCount;
+    return false;
+}
+
+bool TPublishPolicy::IsMinIntervalPassed(const TClock::time_point& now) const
+{
+    return now - LastPublishTime >= std::chrono::milliseconds(Settings.MinPublishIntervalMs);
+}
+
+bool TPublishPolicy::IsMaxIntervalPassed(const TClock::time_point& now) const
+{
+    return Settings.MaxPublishIntervalMs != 0 &&
+           now - LastPublishTime >= std::chrono::milliseconds(Settings.MaxPublishIntervalMs);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief The class decides if a measured value must be published. A value is published if it
+ * differs from the last published one by more than a deadband, but not more often than minimum
+ * publish interval. Unchanged values are republished after maximum publish interval. Changes
+ * between error and normal states are always published.
+ */
+class TPublishPolicy
+{
+public:
+    typedef std::chrono::steady_clock TClock;
+
+    struct TSettings
+    {
+        /*! Absolute deadband. If both Deadband and DeadbandPercent are 0,
+            a value is published on every change of its text representation
+        */
+        double Deadband = 0;
+
+        //! Deadband in percents of the last published value
+        double DeadbandPercent = 0;
+
+        //! Minimum interval between publications in mS
+        uint32_t MinPublishIntervalMs = 0;
+
+        //! Unchanged value is republished after the interval in mS. If 0, the value is not republished
+        uint32_t MaxPublishIntervalMs = 0;
+    };
+
+    TPublishPolicy(const TSettings& settings);
+
+    /**
+     * @brief Check if a measured value must be published. If true is returned, the value is
+     * remembered as the last published one.
+     *
+     * @param value Measured value
+     * @param text Text representation of the value to be published
+     * @param now Measurement time
+     */
+    bool ShouldPublishValue(double value, const std::string& text, const TClock::time_point& now);
+
+    /**
+     * @brief Check if measurement error must be published. If true is returned, the error is
+     * remembered as the last published state. A changed error is published like a changed value.
+     *
+     * @param now Measurement time
+     * @param error Error meta of the control
+     */
+    bool ShouldPublishError(const TClock::time_point& now, const std::string& error = "r");
+
+    //! Number of published values and errors
+    uint64_t GetPublishedCount() const;
+
+    //! Number of suppressed values and errors
+    uint64_t GetSuppressedCount() const;
+
+private:
+    TSettings          Settings;
+    bool               HasPublished;
+    bool               LastIsError;
+    double             LastValue;
+    std::string        LastText;
+    TClock::time_point LastPublishTime;
+    uint64_t           PublishedCount;
+    uint64_t           SuppressedCount;
+
+    bool Publish(const TClock::time_point& now);
+    bool Suppress();
+    bool IsMinIntervalPassed(const TClock::time_point& now) const;
+    bool IsMaxIntervalPassed(const TClock::time_point& now) const;
+};
@@ -0,0 +1,265 @@
+#include "publisher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+
+bool TPublishBatch::Add(TPublishItem&& item, size_t source)
+{
+    if (Open.size() <= source) {
+        Open.resize(source + 1, false);
+    }
+    Open[source] = item.More;
+    // meta of a control is coalesced separately from its value
+    auto key = item.Meta.empty() ? item.ControlId : item.ControlId + "/meta/" + item.Meta;
+    auto it  = Positions.find(key);
+    if (it != Positions.end()) {
+        Items[it->second] = std::move(item);
+        return false;
+    }
+    Positions.emplace(key, Items.size());
+    Items.push_back(std::move(item));
+    return true;
+}
+
+void TPublishBatch::Abort(size_t source)
+{
+    if (source < Open.size()) {
+        Open[source] = false;
+    }
+}
+
+bool TPublishBatch::IsComplete() const
+{
+    return std::find(Open.begin(), Open.end(), true) == Open.end();
+}
+
+const std::vector<TPublishItem>& TPublishBatch::GetItems() const
+{
+    return Items;
+}
+
+void TPublishBatch::Clear()
+{
+    Items.clear();
+    Positions.clear();
+}
+
+TPublisher::TQueue::TQueue(TPublisher& publisher, size_t size) : Publisher(publisher), Items(size), Aborted(false)
+{}
+
+void TPublisher::TQueue::Push(TPublishItem&& item)
+{
+    if (!Items.TryPush(std::move(item))) {
+        if (Publisher.Settings.BlockOnOverflow) {
+            ++Publisher.Blocked;
+            do {
+                Publisher.Wakeup();
+                if (!WaitFor(StopEvent.get(), std::chrono::milliseconds(1))) {
+                    // the sampler is stopping, so it must not wait for a stalled publisher
+                    ++Publisher.Dropped;
+                    Aborted = true;
+                    Publisher.Wakeup();
+                    return;
+                }
+            } while (!Items.TryPush(std::move(item)));
+        } else {
+            TPublishItem oldest;
+            do {
+                if (Items.TryPop(oldest)) {
+                    ++Publisher.Dropped;
+                }
+            } while (!Items.TryPush(std::move(item)));
+        }
+    }
+    Publisher.Wakeup();
+}
+
+void TPublisher::TQueue::SetStopEvent(std::shared_ptr<const TStopEvent> stopEvent)
+{
+    StopEvent = stopEvent;
+}
+
+bool TPublisher::TQueue::TakeAborted()
+{
+    return Aborted.exchange(false);
+}
+
+bool TPublisher::TQueue::Pop(TPublishItem& item)
+{
+    return Items.TryPop(item);
+}
+
+size_t TPublisher::TQueue::Size() const
+{
+    return Items.Size();
+}
+
+TPublisher::TPublisher(WBMQTT::PDeviceDriver mqttDriver,
+                       WBMQTT::PLocalDevice  device,
+                       const TSettings&      settings,
+                       WBMQTT::TLogger&      errorLogger,
+                       WBMQTT::PMqttClient   metaClient,
+                       const std::string&    deviceId)
+    : MqttDriver(mqttDriver), Device(device), Settings(settings), ErrorLogger(errorLogger), MetaClient(metaClient),
+      ControlsTopic("/devices/" + deviceId + "/controls/"), Active(false), Published(0), Coalesced(0), Dropped(0),
+      Blocked(0), Batches(0)
+{
+    WakeupFd = eventfd(0, EFD_CLOEXEC);
+    if (WakeupFd < 0) {
+        throw std::system_error(errno, std::generic_category(), "eventfd failed");
+    }
+}
+
+TPublisher::~TPublisher()
+{
+    if (Thread) {
+        Stop();
+    }
+    close(WakeupFd);
+}
+
+TPublisher::PQueue TPublisher::CreateQueue()
+{
+    PQueue                      queue(new TQueue(*this, Settings.QueueSize));
+    std::lock_guard<std::mutex> lg(QueuesMutex);
+    Queues.push_back(queue);
+    return queue;
+}
+
+void TPublisher::Start()
+{
+    Active = true;
+    Thread = WBMQTT::MakeThread("ADC publisher", {[this] { Run(); }});
+}
+
+void TPublisher::Stop()
+{
+    Active = false;
+    Wakeup();
+    if (Thread && Thread->joinable()) {
+        Thread->join();
+    }
+    Thread.reset();
+}
+
+TPublisher::TStatistics TPublisher::GetStatistics() const
+{
+    TStatistics stats;
+    stats.Published = Published;
+    stats.Coalesced = Coalesced;
+    stats.Dropped   = Dropped;
+    stats.Blocked   = Blocked;
+    stats.Batches   = Batches;
+    return stats;
+}
+
+size_t TPublisher::GetQueueDepth() const
+{
+    std::lock_guard<std::mutex> lg(QueuesMutex);
+    size_t                      res = 0;
+    for (const auto& queue : Queues) {
+        res += queue->Size();
+    }
+    return res;
+}
+
+void TPublisher::Wakeup()
+{
+    uint64_t v = 1;
+    if (write(WakeupFd, &v, sizeof(v)) != sizeof(v)) {
+        // the counter is already big enough to wake up the publisher
+    }
+}
+
+void TPublisher::Run()
+{
+    TPublishBatch       batch;
+    std::vector<PQueue> queues;
+    bool                active = true;
+    while (active) {
+        uint64_t v;
+        if (read(WakeupFd, &v, sizeof(v)) != sizeof(v) && errno != EINTR) {
+            ErrorLogger.Log() << "Publisher wakeup failed: " << strerror(errno);
+            break;
+        }
+        // read results queued before stop request
+        active = Active;
+        {
+            // queues are only added, so the copy is updated when their number changes
+            std::lock_guard<std::mutex> lg(QueuesMutex);
+            if (queues.size() != Queues.size()) {
+                queues = Queues;
+            }
+        }
+        // a result with More flag is followed by the rest of its group, which can come after the next
+        // wakeups, so the batch waits until transactions of all queues are closed
+        for (size_t i = 0; i < queues.size(); ++i) {
+            bool         aborted = queues[i]->TakeAborted();
+            TPublishItem item;
+            while (queues[i]->Pop(item)) {
+                if (!batch.Add(std::move(item), i)) {
+                    ++Coalesced;
+                }
+            }
+            if (aborted) {
+                batch.Abort(i);
+            }
+        }
+        if (!batch.IsComplete() && active) {
+            continue;
+        }
+        if (!batch.GetItems().empty()) {
+            PublishBatch(batch);
+            batch.Clear();
+        }
+    }
+}
+
+void TPublisher::PublishBatch(TPublishBatch& batch)
+{
+    try {
+        std::vector<WBMQTT::TFuture<void>> futures;
+        {
+            auto tx = MqttDriver->BeginTx();
+            for (const auto& item : batch.GetItems()) {
+                if (!item.Meta.empty()) {
+                    continue;
+                }
+                auto control = Device->GetControl(item.ControlId);
+                if (!control) {
+                    continue;
+                }
+                if (item.Error) {
+                    futures.push_back(control->SetError(tx, item.Value.empty() ? std::string("r") : item.Value));
+                } else {
+                    futures.push_back(control->SetRawValue(tx, item.Value));
+                }
+            }
+        }
+        // wait only for the last publication, it gives back pressure without delaying samplers
+        if (!futures.empty()) {
+            futures.back().Wait();
+        }
+        // timestamps follow their values, so a subscriber gets the time of the value it has already received
+        if (MetaClient) {
+            for (const auto& item : batch.GetItems()) {
+                if (!item.Meta.empty()) {
+                    MetaClient->Publish(
+                        WBMQTT::TMqttMessage(ControlsTopic + item.ControlId + "/meta/" + item.Meta, item.Value, 0, true));
+                } else if (item.TimestampMs != 0 && !item.Error) {
+                    MetaClient->Publish(WBMQTT::TMqttMessage(ControlsTopic + item.ControlId + "/meta/ts",
+                                                             std::to_string(item.TimestampMs),
+                                                             0,
+                                                             true));
+                }
+            }
+        }
+        Published += batch.GetItems().size();
+        ++Batches;
+    } catch (const std::exception& e) {
+        ErrorLogger.Log() << "Publication failed: " << e.what();
+    }
+}
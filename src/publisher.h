@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <wblib/wbmqtt.h>
+
+#include "bounded_queue.h"
+#include "stop_event.h"
+
+//! Measurement result to be published to MQTT
+struct TPublishItem
+{
+    //! Control id
+    std::string ControlId;
+
+    //! Value to publish. If Error is true, error meta to publish, "r" if empty
+    std::string Value;
+
+    //! Publish error instead of value
+    bool Error = false;
+
+    //! Measurement time in mS since the epoch published to meta/ts of the control. If 0, it isn't published
+    int64_t TimestampMs = 0;
+
+    //! The next item of the queue is published in the same transaction
+    bool More = false;
+
+    //! If not empty, Value is published as retained meta/Meta of the control instead of its value
+    std::string Meta;
+};
+
+/**
+ * @brief Batch of items to be published in one transaction. Only the newest item is kept for
+ * every control, controls are published in order of their first appearance. Items come from
+ * several sources, a source's transaction is open from an item with More flag till the next
+ * item without it.
+ */
+class TPublishBatch
+{
+public:
+    /**
+     * @brief Add item to the batch. Returns false if the item replaced an older one for the same control
+     *
+     * @param source Index of the queue the item is taken from
+     */
+    bool Add(TPublishItem&& item, size_t source = 0);
+
+    //! Close the transaction of the source, the rest of its items won't come
+    void Abort(size_t source);
+
+    //! true if no source has an open transaction, so the batch can be published
+    bool IsComplete() const;
+
+    const std::vector<TPublishItem>& GetItems() const;
+
+    //! Remove items. Open transactions are kept, their items are added after clearing
+    void Clear();
+
+private:
+    std::vector<TPublishItem>               Items;
+    std::unordered_map<std::string, size_t> Positions;
+    std::vector<bool>                       Open;
+};
+
+/**
+ * @brief Publisher of measurement results. Samplers push results into their own lock-free queues,
+ * a separate thread drains all queues and publishes results in batches inside one transaction.
+ */
+class TPublisher
+{
+public:
+    struct TSettings
+    {
+        //! Maximum number of results waiting for publication in one queue
+        size_t QueueSize = 64;
+
+        //! If true, a sampler waits for a free place in a full queue, otherwise the oldest result is dropped
+        bool BlockOnOverflow = false;
+    };
+
+    //! Queue of a single sampler
+    class TQueue
+    {
+    public:
+        TQueue(TPublisher& publisher, size_t size);
+
+        /**
+         * @brief Push result to the queue and wake up the publisher. Full queue is handled according to
+         * settings. Results pushed with More flag are published together with the next one. A blocked
+         * push drops the result and returns when the stop event is set.
+         */
+        void Push(TPublishItem&& item);
+
+        /**
+         * @brief Set event of the sampler using the queue to interrupt blocked pushes.
+         *
+         * @param stopEvent If nullptr, a blocked push waits until the queue has a free place
+         */
+        void SetStopEvent(std::shared_ptr<const TStopEvent> stopEvent);
+
+        /**
+         * @brief Returns true once after a result was dropped because of the stop event, so the rest of
+         * its transaction won't come. It is called by the publisher.
+         */
+        bool TakeAborted();
+
+        //! Pop the oldest result from the queue. Returns false if the queue is empty
+        bool Pop(TPublishItem& item);
+
+        //! Approximate number of results in the queue
+        size_t Size() const;
+
+    private:
+        TPublisher&                       Publisher;
+        TBoundedQueue<TPublishItem>       Items;
+        std::shared_ptr<const TStopEvent> StopEvent;
+        std::atomic<bool>                 Aborted;
+    };
+
+    typedef std::shared_ptr<TQueue> PQueue;
+
+    struct TStatistics
+    {
+        //! Number of published results
+        uint64_t Published = 0;
+
+        //! Number of results replaced by newer ones for the same control before publication
+        uint64_t Coalesced = 0;
+
+        //! Number of results dropped because of full queue
+        uint64_t Dropped = 0;
+
+        //! Number of pushes to a full queue which had to wait for a free place
+        uint64_t Blocked = 0;
+
+        //! Number of transactions
+        uint64_t Batches = 0;
+    };
+
+    /**
+     * @brief Construct a new TPublisher object
+     *
+     * @param metaClient Client to publish meta/ts and other meta of controls of the device with id deviceId.
+     * If nullptr, timestamps and meta items are ignored
+     */
+    TPublisher(WBMQTT::PDeviceDriver mqttDriver,
+               WBMQTT::PLocalDevice  device,
+               const TSettings&      settings,
+               WBMQTT::TLogger&      errorLogger,
+               WBMQTT::PMqttClient   metaClient = nullptr,
+               const std::string&    deviceId   = std::string());
+    ~TPublisher();
+
+    //! Create a queue for a sampler. It can be called while the publisher is running
+    PQueue CreateQueue();
+
+    //! Start publishing thread
+    void Start();
+
+    //! Publish all queued results and stop publishing thread
+    void Stop();
+
+    TStatistics GetStatistics() const;
+
+    //! Total number of results waiting for publication
+    size_t GetQueueDepth() const;
+
+private:
+    WBMQTT::PDeviceDriver        MqttDriver;
+    WBMQTT::PLocalDevice         Device;
+    TSettings                    Settings;
+    WBMQTT::TLogger&             ErrorLogger;
+    WBMQTT::PMqttClient          MetaClient;
+    std::string                  ControlsTopic;
+    mutable std::mutex           QueuesMutex;
+    std::vector<PQueue>          Queues;
+    std::unique_ptr<std::thread> Thread;
+    int                          WakeupFd;
+    std::atomic<bool>            Active;
+
+    std::atomic<uint64_t> Published;
+    std::atomic<uint64_t> Coalesced;
+    std::atomic<uint64_t> Dropped;
+    std::atomic<uint64_t> Blocked;
+    std::atomic<uint64_t> Batches;
+
+    void Wakeup();
+    void Run();
+    void PublishBatch(TPublishBatch& batch);
+};
@@ -0,0 +1,254 @@
+#include "sample_history.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    void WriteVarint(std::string& res, int64_t value)
+    {
+        // zigzag encoding maps small negative values to small positive ones
+        uint64_t v = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        while (v >= 0x80) {
+            res.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        res.push_back(static_cast<char>(v));
+    }
+
+    int64_t ReadVarint(const std::string& data, size_t& pos)
+    {
+        uint64_t v     = 0;
+        uint32_t shift = 0;
+        while (true) {
+            if (pos >= data.size() || shift > 63) {
+                throw std::runtime_error("Malformed sample data");
+            }
+            uint8_t b = data[pos++];
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    int DecodeBase64Char(char c)
+    {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+') {
+            return 62;
+        }
+        if (c == '/') {
+            return 63;
+        }
+        throw std::runtime_error("Malformed base64 data");
+    }
+} // namespace
+
+TSampleHistory::TSampleHistory(size_t capacity) : Capacity(capacity), Head(0), Claimed(0)
+{
+    if (capacity == 0) {
+        throw std::runtime_error("Sample history capacity can't be zero");
+    }
+    Timestamps.reset(new std::atomic<int64_t>[capacity]);
+    Values.reset(new std::atomic<int32_t>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        Timestamps[i].store(0, std::memory_order_relaxed);
+        Values[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void TSampleHistory::Add(int64_t timestampUs, int32_t value)
+{
+    uint64_t head = Head.load(std::memory_order_relaxed);
+    size_t   pos  = head % Capacity;
+    // a reader seeing any part of the new sample also sees Claimed, so it knows that the slot is overwritten
+    Claimed.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Timestamps[pos].store(timestampUs, std::memory_order_relaxed);
+    Values[pos].store(value, std::memory_order_relaxed);
+    Head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<TSampleHistory::TSample> TSampleHistory::Get(int64_t fromUs,
+                                                        int64_t toUs,
+                                                        size_t  maxCount,
+                                                        bool*   truncated) const
+{
+    std::vector<TSample>  res;
+    std::vector<uint64_t> indexes;
+    bool                  more = false;
+
+    uint64_t head  = Head.load(std::memory_order_acquire);
+    uint64_t first = (head > Capacity) ? head - Capacity : 0;
+    for (uint64_t i = first; i < head; ++i) {
+        size_t  pos = i % Capacity;
+        TSample sample{Timestamps[pos].load(std::memory_order_relaxed), Values[pos].load(std::memory_order_relaxed)};
+        // a slot being overwritten can contain a newer timestamp, so the scan doesn't stop at toUs
+        if (sample.TimestampUs >= fromUs && sample.TimestampUs <= toUs) {
+            if (res.size() == maxCount) {
+                more = true;
+                break;
+            }
+            res.push_back(sample);
+            indexes.push_back(i);
+        }
+    }
+
+    // the flag doesn't depend on dropping of overwritten samples, newer ones remain in the range
+    if (truncated) {
+        *truncated = more;
+    }
+
+    // samples with index i are valid if the writer hasn't started to write sample i + Capacity
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t claimed     = Claimed.load(std::memory_order_relaxed);
+    uint64_t firstIntact = (claimed > Capacity) ? claimed - Capacity : 0;
+    size_t   overwritten = 0;
+    while (overwritten < indexes.size() && indexes[overwritten] < firstIntact) {
+        ++overwritten;
+    }
+    res.erase(res.begin(), res.begin() + overwritten);
+    return res;
+}
+
+std::vector<TSampleHistory::TSample> TSampleHistory::GetSince(uint64_t  fromIndex,
+                                                             size_t    maxCount,
+                                                             uint64_t& nextIndex) const
+{
+    std::vector<TSample> res;
+
+    uint64_t head  = Head.load(std::memory_order_acquire);
+    uint64_t first = std::max(fromIndex, (head > Capacity) ? head - Capacity : 0);
+    uint64_t last  = std::max(first, std::min<uint64_t>(head, first + maxCount));
+    res.reserve(last - first);
+    for (uint64_t i = first; i < last; ++i) {
+        size_t pos = i % Capacity;
+        res.push_back(
+            TSample{Timestamps[pos].load(std::memory_order_relaxed), Values[pos].load(std::memory_order_relaxed)});
+    }
+
+    // the same check of overwritten samples as in Get()
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t claimed     = Claimed.load(std::memory_order_relaxed);
+    uint64_t firstIntact = (claimed > Capacity) ? claimed - Capacity : 0;
+    if (firstIntact > first) {
+        res.erase(res.begin(), res.begin() + std::min<uint64_t>(firstIntact - first, res.size()));
+    }
+    nextIndex = last;
+    return res;
+}
+
+size_t TSampleHistory::GetCapacity() const
+{
+    return Capacity;
+}
+
+size_t TSampleHistory::GetSampleSize()
+{
+    return sizeof(int64_t) + sizeof(int32_t);
+}
+
+size_t TSampleHistory::GetCapacityForBudget(size_t bytes)
+{
+    return bytes / GetSampleSize();
+}
+
+std::string EncodeSampleDeltas(const std::vector<TSampleStore::TSample>& samples)
+{
+    std::string res;
+    if (samples.empty()) {
+        return res;
+    }
+    res.reserve(samples.size() * 3);
+    TSampleStore::TSample prev{samples.front().TimestampUs, 0};
+    for (const auto& sample : samples) {
+        WriteVarint(res, sample.TimestampUs - prev.TimestampUs);
+        WriteVarint(res, static_cast<int64_t>(sample.Value) - prev.Value);
+        prev = sample;
+    }
+    return res;
+}
+
+std::vector<TSampleStore::TSample> DecodeSampleDeltas(const std::string& data, int64_t firstTimestampUs)
+{
+    std::vector<TSampleStore::TSample> res;
+    TSampleStore::TSample              prev{firstTimestampUs, 0};
+    size_t                             pos = 0;
+    while (pos < data.size()) {
+        prev.TimestampUs += ReadVarint(data, pos);
+        prev.Value += ReadVarint(data, pos);
+        res.push_back(prev);
+    }
+    return res;
+}
+
+std::string EncodeBase64(const std::string& data)
+{
+    std::string res;
+    res.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t v = (static_cast<uint8_t>(data[i]) << 16) | (static_cast<uint8_t>(data[i + 1]) << 8) |
+                     static_cast<uint8_t>(data[i + 2]);
+        res.push_back(BASE64_CHARS[(v >> 18) & 0x3F]);
+        res.push_back(BASE64_CHARS[(v >> 12) & 0x3F]);
+        res.push_back(BASE64_CHARS[(v >> 6) & 0x3F]);
+        res.push_back(BASE64_CHARS[v & 0x3F]);
+    }
+    if (i < data.size()) {
+        uint32_t v = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            v |= static_cast<uint8_t>(data[i + 1]) << 8;
+        }
+        res.push_back(BASE64_CHARS[(v >> 18) & 0x3F]);
+        res.push_back(BASE64_CHARS[(v >> 12) & 0x3F]);
+        res.push_back((i + 1 < data.size()) ? BASE64_CHARS[(v >> 6) & 0x3F] : '=');
+        res.push_back('=');
+    }
+    return res;
+}
+
+std::string DecodeBase64(const std::string& data)
+{
+    if (data.size() % 4 != 0) {
+        throw std::runtime_error("Malformed base64 data");
+    }
+    std::string res;
+    res.reserve(data.size() / 4 * 3);
+    for (size_t i = 0; i < data.size(); i += 4) {
+        bool     last    = (i + 4 == data.size());
+        size_t   padding = 0;
+        uint32_t v       = 0;
+        for (size_t j = 0; j < 4; ++j) {
+            v <<= 6;
+            if (last && j >= 2 && data[i + j] == '=') {
+                ++padding;
+            } else if (padding) {
+                throw std::runtime_error("Malformed base64 data");
+            } else {
+                v |= DecodeBase64Char(data[i + j]);
+            }
+        }
+        res.push_back(static_cast<char>(v >> 16));
+        if (padding < 2) {
+            res.push_back(static_cast<char>((v >> 8) & 0xFF));
+        }
+        if (padding < 1) {
+            res.push_back(static_cast<char>(v & 0xFF));
+        }
+    }
+    return res;
+}
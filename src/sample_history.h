@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//! Storage of timestamped raw ADC samples of a channel
+class TSampleStore
+{
+public:
+    //! Sample copied from the store
+    struct TSample
+    {
+        //! Time of reading in uS since the epoch
+        int64_t TimestampUs;
+
+        //! Raw ADC value
+        int32_t Value;
+    };
+
+    virtual ~TSampleStore() = default;
+
+    //! Add a sample replacing the oldest ones if the store is full. Call it from one thread only
+    virtual void Add(int64_t timestampUs, int32_t value) = 0;
+
+    /**
+     * @brief Copy samples with timestamps in range [fromUs, toUs]. It can be called from any thread.
+     *
+     * @param maxCount Maximum number of samples to return, the oldest ones are returned first
+     * @param truncated If not nullptr, it is set to true if the range has more than maxCount samples
+     */
+    virtual std::vector<TSample> Get(int64_t fromUs,
+                                     int64_t toUs,
+                                     size_t  maxCount,
+                                     bool*   truncated = nullptr) const = 0;
+};
+
+/**
+ * @brief Fixed-size ring buffer of timestamped raw ADC samples of a channel.
+ *
+ * Timestamps and values are kept in separate preallocated arrays, so a sample takes
+ * GetSampleSize() bytes and adding of a sample doesn't allocate memory. Samples are added by a
+ * single sampling thread, any other thread can read them without locks. A reader drops samples
+ * which could be overwritten during copying.
+ */
+class TSampleHistory : public TSampleStore
+{
+public:
+    /**
+     * @brief Construct a new TSampleHistory object. Throws std::runtime_error if capacity == 0.
+     *
+     * @param capacity Maximum number of kept samples
+     */
+    explicit TSampleHistory(size_t capacity);
+
+    TSampleHistory(const TSampleHistory&) = delete;
+    TSampleHistory& operator=(const TSampleHistory&) = delete;
+
+    void                 Add(int64_t timestampUs, int32_t value) override;
+    std::vector<TSample> Get(int64_t fromUs,
+                             int64_t toUs,
+                             size_t  maxCount,
+                             bool*   truncated = nullptr) const override;
+
+    /**
+     * @brief Copy samples in order of their addition starting from the sample with the index. Unlike
+     * Get(), it doesn't depend on timestamps, so a reader gets every sample once even if several
+     * samples have the same timestamp. It can be called from any thread.
+     *
+     * @param fromIndex Number of samples added before the first one to copy. Overwritten samples are skipped
+     * @param maxCount Maximum number of samples to return
+     * @param nextIndex Set to the index of the sample following the returned ones
+     */
+    std::vector<TSample> GetSince(uint64_t fromIndex, size_t maxCount, uint64_t& nextIndex) const;
+
+    //! Maximum number of kept samples
+    size_t GetCapacity() const;
+
+    //! Number of bytes per sample
+    static size_t GetSampleSize();
+
+    //! Number of samples fitting into the memory budget in bytes
+    static size_t GetCapacityForBudget(size_t bytes);
+
+private:
+    std::unique_ptr<std::atomic<int64_t>[]> Timestamps;
+    std::unique_ptr<std::atomic<int32_t>[]> Values;
+    size_t                                  Capacity;
+
+    //! Number of samples added since creation
+    std::atomic<uint64_t> Head;
+
+    //! Number of samples including the one being written now
+    std::atomic<uint64_t> Claimed;
+};
+
+/**
+ * @brief Encode samples as a sequence of pairs of differences from the previous sample: timestamp
+ * in uS and value. The first sample is encoded relative to {samples[0].TimestampUs, 0}. Differences
+ * are zigzag-encoded and written as LEB128 varints, so slow changing signals take 2-3 bytes per sample.
+ */
+std::string EncodeSampleDeltas(const std::vector<TSampleStore::TSample>& samples);
+
+//! Decode result of EncodeSampleDeltas. Throws std::runtime_error on malformed data
+std::vector<TSampleStore::TSample> DecodeSampleDeltas(const std::string& data, int64_t firstTimestampUs);
+
+//! Standard base64 with padding
+std::string EncodeBase64(const std::string& data);
+
+//! Decode standard base64. Throws std::runtime_error on malformed data
+std::string DecodeBase64(const std::string& data);
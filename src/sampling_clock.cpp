@@ -0,0 +1,73 @@
+#include "sampling_clock.h"
+
+#include <errno.h>
+#include <time.h>
+
+namespace
+{
+    //! Sleep until the point of CLOCK_MONOTONIC restarting on signals
+    void SleepUntil(TSamplingClock::TClock::time_point deadline)
+    {
+        auto     ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec ts;
+        ts.tv_sec  = ns / 1000000000;
+        ts.tv_nsec = ns % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+    }
+}
+
+TSamplingClock::TSamplingClock(std::chrono::nanoseconds period) : Period(period), Missed(0), Jitter(nullptr)
+{
+    Start();
+}
+
+void TSamplingClock::Start()
+{
+    Deadline = TClock::now();
+}
+
+bool TSamplingClock::WaitNext(const TStopEvent* stopEvent)
+{
+    Deadline += Period;
+    auto now = TClock::now();
+    if (now < Deadline) {
+        if (stopEvent) {
+            if (!stopEvent->WaitUntil(Deadline)) {
+                return false;
+            }
+        } else {
+            SleepUntil(Deadline);
+        }
+        now = TClock::now();
+    }
+    auto late = now - Deadline;
+    if (Jitter) {
+        Jitter->Record(late);
+    }
+    if (late > Period) {
+        ++Missed;
+        Deadline = now;
+    }
+    return !stopEvent || !stopEvent->IsSet();
+}
+
+std::chrono::nanoseconds TSamplingClock::GetPeriod() const
+{
+    return Period;
+}
+
+TSamplingClock::TClock::time_point TSamplingClock::GetDeadline() const
+{
+    return Deadline;
+}
+
+uint64_t TSamplingClock::GetMissedCount() const
+{
+    return Missed;
+}
+
+void TSamplingClock::SetJitterHistogram(TLatencyHistogram* jitter)
+{
+    Jitter = jitter;
+}
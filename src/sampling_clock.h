@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+#include "statistics.h"
+#include "stop_event.h"
+
+/**
+ * @brief Clock of readings taken at a constant rate. Deadlines are absolute points of CLOCK_MONOTONIC
+ * spaced by the period from the start of the schedule, so time spent in reading and scheduling delays
+ * don't accumulate into the cadence. The object is used by one thread only.
+ */
+class TSamplingClock
+{
+public:
+    //! CLOCK_MONOTONIC
+    typedef std::chrono::steady_clock TClock;
+
+    explicit TSamplingClock(std::chrono::nanoseconds period);
+
+    //! Start a new schedule, the first deadline is a period after now
+    void Start();
+
+    /**
+     * @brief Wait for the next deadline. If the deadline is missed by more than a period, the schedule
+     * is restarted from now instead of catching up with a burst of readings.
+     *
+     * @param stopEvent Event to interrupt the wait. If nullptr, clock_nanosleep with TIMER_ABSTIME is used
+     * @return true The deadline is reached
+     * @return false The event is set
+     */
+    bool WaitNext(const TStopEvent* stopEvent);
+
+    std::chrono::nanoseconds GetPeriod() const;
+
+    //! The deadline of the last WaitNext() call
+    TClock::time_point GetDeadline() const;
+
+    //! Number of schedule restarts after missed deadlines
+    uint64_t GetMissedCount() const;
+
+    /**
+     * @brief Enable recording of delays between deadlines and wake ups.
+     *
+     * @param jitter Histogram to record to. It must outlive the clock. If nullptr, recording is disabled
+     */
+    void SetJitterHistogram(TLatencyHistogram* jitter);
+
+private:
+    std::chrono::nanoseconds Period;
+    TClock::time_point       Deadline;
+    uint64_t                 Missed;
+    TLatencyHistogram*       Jitter;
+};
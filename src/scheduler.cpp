@@ -0,0 +1,120 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <system_error>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace
+{
+    bool LaterDeadline(const TScheduler::TClock::time_point& a, const TScheduler::TClock::time_point& b)
+    {
+        return a > b;
+    }
+} // namespace
+
+TScheduler::TScheduler(const TStopEvent* stopEvent) : StopEvent(stopEvent)
+{
+    TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (TimerFd < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_create failed");
+    }
+}
+
+TScheduler::~TScheduler()
+{
+    close(TimerFd);
+}
+
+void TScheduler::AddTask(size_t id, std::chrono::milliseconds period)
+{
+    Tasks.push_back(TTask{TClock::now(), period, id});
+    std::push_heap(Tasks.begin(), Tasks.end(), [](const TTask& a, const TTask& b) {
+        return LaterDeadline(a.Deadline, b.Deadline);
+    });
+}
+
+bool TScheduler::WaitUntil(const TClock::time_point& time)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+
+    itimerspec spec{};
+    spec.it_value.tv_sec  = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+    if (timerfd_settime(TimerFd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        return false;
+    }
+    if (StopEvent && !StopEvent->WaitReadable(TimerFd, std::chrono::microseconds(-1))) {
+        return false;
+    }
+    uint64_t expirations;
+    return read(TimerFd, &expirations, sizeof(expirations)) == sizeof(expirations);
+}
+
+bool TScheduler::WaitNext(size_t& id, std::chrono::milliseconds maxWait)
+{
+    if (Tasks.empty()) {
+        WaitUntil(TClock::now() + maxWait);
+        return false;
+    }
+
+    auto cmp = [](const TTask& a, const TTask& b) { return LaterDeadline(a.Deadline, b.Deadline); };
+
+    auto now = TClock::now();
+    if (Tasks.front().Deadline > now) {
+        auto waitLimit = now + maxWait;
+        if (Tasks.front().Deadline > waitLimit) {
+            WaitUntil(waitLimit);
+            return false;
+        }
+        if (!WaitUntil(Tasks.front().Deadline)) {
+            return false;
+        }
+        now = TClock::now();
+    }
+
+    std::pop_heap(Tasks.begin(), Tasks.end(), cmp);
+    TTask& task = Tasks.back();
+
+    auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(now - task.Deadline);
+    if (lateness.count() < 0) {
+        lateness = std::chrono::microseconds(0);
+    }
+    ++Statistics.Runs;
+    Statistics.TotalLateness += lateness;
+    Statistics.MaxLateness = std::max(Statistics.MaxLateness, lateness);
+
+    if (task.Period.count() == 0) {
+        task.Deadline = now;
+    } else {
+        // keep fixed rate, skipping periods which are already over
+        task.Deadline += task.Period;
+        if (task.Deadline <= now) {
+            auto missed = (now - task.Deadline) / task.Period + 1;
+            Statistics.MissedDeadlines += missed;
+            task.Deadline += task.Period * missed;
+        }
+    }
+    id = task.Id;
+    std::push_heap(Tasks.begin(), Tasks.end(), cmp);
+    return true;
+}
+
+void TScheduler::Postpone(size_t id, const TClock::time_point& time)
+{
+    for (auto& task : Tasks) {
+        if (task.Id == id && task.Deadline < time) {
+            task.Deadline = time;
+            std::make_heap(Tasks.begin(), Tasks.end(), [](const TTask& a, const TTask& b) {
+                return LaterDeadline(a.Deadline, b.Deadline);
+            });
+            return;
+        }
+    }
+}
+
+const TScheduler::TStatistics& TScheduler::GetStatistics() const
+{
+    return Statistics;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stop_event.h"
+
+/**
+ * @brief Deadline scheduler of periodic tasks. Tasks are kept in a binary heap ordered by their
+ * next deadlines, waiting for the earliest one is done with a single timerfd armed with absolute
+ * CLOCK_MONOTONIC time.
+ */
+class TScheduler
+{
+public:
+    typedef std::chrono::steady_clock TClock;
+
+    struct TStatistics
+    {
+        //! Number of task runs
+        uint64_t Runs = 0;
+
+        //! Number of task periods skipped because a task was started too late
+        uint64_t MissedDeadlines = 0;
+
+        //! Sum of delays between tasks' deadlines and actual starts
+        std::chrono::microseconds TotalLateness{0};
+
+        //! Maximum delay between a task's deadline and its actual start
+        std::chrono::microseconds MaxLateness{0};
+    };
+
+    /**
+     * @brief Construct a new TScheduler object. Throws std::system_error if timerfd can't be created
+     *
+     * @param stopEvent Event to interrupt waits. If nullptr, waits are not interruptible
+     */
+    explicit TScheduler(const TStopEvent* stopEvent = nullptr);
+    ~TScheduler();
+
+    TScheduler(const TScheduler&) = delete;
+    TScheduler& operator=(const TScheduler&) = delete;
+
+    /**
+     * @brief Add periodic task. The first run is scheduled immediately.
+     *
+     * @param id Task identifier returned by WaitNext
+     * @param period Task period. If 0, the task runs as often as possible
+     */
+    void AddTask(size_t id, std::chrono::milliseconds period);
+
+    /**
+     * @brief Wait for the earliest task's deadline.
+     *
+     * @param id Identifier of a task to run
+     * @param maxWait Maximum time to wait
+     * @return true A task is due, its id is returned in id
+     * @return false No task is due during maxWait or stop event is set
+     */
+    bool WaitNext(size_t& id, std::chrono::milliseconds maxWait);
+
+    /**
+     * @brief Move the next run of the task to the time if it is scheduled earlier. Missed deadlines
+     * are not counted for the skipped periods.
+     *
+     * @param id Task identifier
+     * @param time Time of the next run
+     */
+    void Postpone(size_t id, const TClock::time_point& time);
+
+    const TStatistics& GetStatistics() const;
+
+private:
+    struct TTask
+    {
+        TClock::time_point        Deadline;
+        std::chrono::milliseconds Period;
+        size_t                    Id;
+    };
+
+    std::vector<TTask> Tasks;
+    int                TimerFd;
+    TStatistics        Statistics;
+    const TStopEvent*  StopEvent;
+
+    bool WaitUntil(const TClock::time_point& time);
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+/**
+ * Shared memory ring of samples of a channel exported by wb-mqtt-adc.
+ *
+ * The header doesn't depend on other wb-mqtt-adc sources, so local consumers can include it
+ * directly (it is installed as /usr/include/wb-mqtt-adc/shm_ring.h). Every channel with
+ * "shm_ring_size" in config has own POSIX shared memory object "/wb-mqtt-adc.ID" written by
+ * one sampling thread. Readers map it read-only and never block the writer.
+ *
+ * Usage:
+ *     TShmRingReader reader("A1");
+ *     uint64_t       pos = reader.GetWriteIndex();  // start from new samples
+ *     TShmSample     buf[64];
+ *     size_t         n = reader.Read(pos, buf, 64);
+ */
+
+#include <atomic>
+#include <fcntl.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! Prefix of shared memory object names, the channel id is appended
+#define WB_ADC_SHM_PREFIX "/wb-mqtt-adc."
+
+const uint32_t WB_ADC_SHM_MAGIC   = 0x43444157; // "WADC"
+const uint32_t WB_ADC_SHM_VERSION = 1;
+
+//! Sample copied from the ring
+struct TShmSample
+{
+    //! Time of reading in uS since the epoch
+    int64_t TimestampUs;
+
+    //! Raw ADC value
+    int32_t Raw;
+
+    //! Raw value converted to V
+    double Value;
+};
+
+//! Header of the shared memory object, it is followed by SlotCount TShmRingSlot
+struct TShmRingHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+
+    //! Number of slots, a power of two
+    uint64_t SlotCount;
+
+    //! Number of samples written since the writer start
+    std::atomic<uint64_t> WriteIndex;
+
+    //! 1 while the writer is running
+    std::atomic<uint32_t> Active;
+    uint32_t              Reserved[7];
+};
+
+/**
+ * @brief Slot for a sample. Seq is 2 * index + 1 while the sample with the index is written
+ * and 2 * index + 2 after that, so a reader detects not yet written and overwritten slots.
+ */
+struct TShmRingSlot
+{
+    std::atomic<uint64_t> Seq;
+    std::atomic<int64_t>  TimestampUs;
+    std::atomic<int32_t>  Raw;
+    int32_t               Reserved;
+    std::atomic<double>   Value;
+};
+
+//! Size of shared memory object with given number of slots
+inline size_t GetShmRingSize(uint64_t slotCount)
+{
+    return sizeof(TShmRingHeader) + slotCount * sizeof(TShmRingSlot);
+}
+
+//! Name of shared memory object of the channel, '/' in the id is replaced by '_'
+inline std::string GetShmRingName(const std::string& channelId)
+{
+    std::string res(WB_ADC_SHM_PREFIX + channelId);
+    for (size_t i = 1; i < res.size(); ++i) {
+        if (res[i] == '/') {
+            res[i] = '_';
+        }
+    }
+    return res;
+}
+
+//! Result of reading of a single slot
+enum class TShmReadResult
+{
+    Ok,
+    NotWritten,
+    Overwritten
+};
+
+/**
+ * @brief Read sample with given index from slots. Lock-free, it never waits for the writer.
+ */
+inline TShmReadResult ReadShmSlot(const TShmRingSlot* slots, uint64_t slotCount, uint64_t index, TShmSample& res)
+{
+    const TShmRingSlot& slot     = slots[index & (slotCount - 1)];
+    uint64_t            expected = 2 * index + 2;
+    uint64_t            seq      = slot.Seq.load(std::memory_order_acquire);
+    if (seq < expected) {
+        return TShmReadResult::NotWritten;
+    }
+    if (seq > expected) {
+        return TShmReadResult::Overwritten;
+    }
+    res.TimestampUs = slot.TimestampUs.load(std::memory_order_relaxed);
+    res.Raw         = slot.Raw.load(std::memory_order_relaxed);
+    res.Value       = slot.Value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (slot.Seq.load(std::memory_order_relaxed) == seq) ? TShmReadResult::Ok : TShmReadResult::Overwritten;
+}
+
+/**
+ * @brief Write sample with given index to slots. Only one thread can write to the slots.
+ */
+inline void WriteShmSlot(TShmRingSlot* slots, uint64_t slotCount, uint64_t index, const TShmSample& sample)
+{
+    TShmRingSlot& slot = slots[index & (slotCount - 1)];
+    slot.Seq.store(2 * index + 1, std::memory_order_relaxed);
+    // a reader seeing any new field also sees the odd seq
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.TimestampUs.store(sample.TimestampUs, std::memory_order_relaxed);
+    slot.Raw.store(sample.Raw, std::memory_order_relaxed);
+    slot.Value.store(sample.Value, std::memory_order_relaxed);
+    slot.Seq.store(2 * index + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Reader of a channel ring. It maps the shared memory object read-only.
+ */
+class TShmRingReader
+{
+public:
+    /**
+     * @brief Open the ring of the channel. Throws std::runtime_error if the ring doesn't exist or
+     * has unsupported format.
+     *
+     * @param channelId Channel id from wb-mqtt-adc config
+     */
+    explicit TShmRingReader(const std::string& channelId)
+        : Header(nullptr), Slots(nullptr), SlotCount(0), Size(0)
+    {
+        std::string name(GetShmRingName(channelId));
+        int         fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Can't open shared memory " + name);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TShmRingHeader)) {
+            close(fd);
+            throw std::runtime_error("Shared memory " + name + " is too small");
+        }
+        Size       = st.st_size;
+        void* addr = mmap(nullptr, Size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("Can't map shared memory " + name);
+        }
+        Header = static_cast<const TShmRingHeader*>(addr);
+        if (Header->Magic != WB_ADC_SHM_MAGIC || Header->Version != WB_ADC_SHM_VERSION ||
+            Header->SlotCount == 0 || (Header->SlotCount & (Header->SlotCount - 1)) != 0 ||
+            GetShmRingSize(Header->SlotCount) > Size)
+        {
+            munmap(addr, Size);
+            throw std::runtime_error("Shared memory " + name + " has unsupported format");
+        }
+        Slots     = reinterpret_cast<const TShmRingSlot*>(Header + 1);
+        SlotCount = Header->SlotCount;
+    }
+
+    ~TShmRingReader()
+    {
+        munmap(const_cast<TShmRingHeader*>(Header), Size);
+    }
+
+    TShmRingReader(const TShmRingReader&) = delete;
+    TShmRingReader& operator=(const TShmRingReader&) = delete;
+
+    //! Index of the next sample to be written
+    uint64_t GetWriteIndex() const
+    {
+        return Header->WriteIndex.load(std::memory_order_acquire);
+    }
+
+    uint64_t GetSlotCount() const
+    {
+        return SlotCount;
+    }
+
+    /**
+     * @brief false if the writer is stopped or restarted with other ring size. The reader doesn't get
+     * new samples then and should be recreated.
+     */
+    bool IsWriterActive() const
+    {
+        return Header->Active.load(std::memory_order_relaxed) != 0 && Header->SlotCount == SlotCount;
+    }
+
+    /**
+     * @brief Copy available samples starting from position.
+     *
+     * If the samples at position are already overwritten, reading continues from the oldest
+     * available one. If the writer is restarted (position is ahead of the write index), reading
+     * starts from the beginning.
+     *
+     * @param position Index of the first sample to read, it is advanced past the read samples
+     * @param buf Buffer for samples
+     * @param maxCount Size of the buffer
+     * @param lost If not nullptr, number of skipped overwritten samples is added to it
+     * @return Number of read samples
+     */
+    size_t Read(uint64_t& position, TShmSample* buf, size_t maxCount, uint64_t* lost = nullptr) const
+    {
+        if (Header->SlotCount != SlotCount) {
+            return 0;
+        }
+        uint64_t writeIndex = GetWriteIndex();
+        if (position > writeIndex) {
+            position = 0;
+        }
+        size_t n = 0;
+        while (n < maxCount && position < writeIndex) {
+            uint64_t oldest = (writeIndex > SlotCount) ? writeIndex - SlotCount : 0;
+            if (position < oldest) {
+                if (lost) {
+                    *lost += oldest - position;
+                }
+                position = oldest;
+            }
+            auto res = ReadShmSlot(Slots, SlotCount, position, buf[n]);
+            if (res == TShmReadResult::NotWritten) {
+                break;
+            }
+            if (res == TShmReadResult::Overwritten) {
+                // the writer has lapped the reader, continue from the new oldest sample
+                writeIndex = GetWriteIndex();
+                if (writeIndex <= position + SlotCount) {
+                    writeIndex = position + SlotCount + 1;
+                }
+                continue;
+            }
+            ++position;
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    const TShmRingHeader* Header;
+    const TShmRingSlot*   Slots;
+    uint64_t              SlotCount;
+    size_t                Size;
+};
@@ -0,0 +1,69 @@
+#include "shm_ring_writer.h"
+
+#include <errno.h>
+#include <string.h>
+
+namespace
+{
+    uint64_t RoundUpToPowerOfTwo(uint64_t value)
+    {
+        uint64_t res = 1;
+        while (res < value) {
+            res <<= 1;
+        }
+        return res;
+    }
+} // namespace
+
+TShmRingWriter::TShmRingWriter(const std::string& channelId, uint64_t slotCount)
+    : Name(GetShmRingName(channelId)), WriteIndex(0)
+{
+    slotCount = RoundUpToPowerOfTwo(slotCount);
+    Size      = GetShmRingSize(slotCount);
+
+    // the object isn't recreated, so readers of the previous writer see the restart
+    int fd = shm_open(Name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Can't create shared memory " + Name + ": " + strerror(errno));
+    }
+    if (ftruncate(fd, Size) != 0) {
+        std::string err(strerror(errno));
+        close(fd);
+        throw std::runtime_error("Can't resize shared memory " + Name + ": " + err);
+    }
+    void* addr = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Can't map shared memory " + Name + ": " + strerror(errno));
+    }
+
+    Header = static_cast<TShmRingHeader*>(addr);
+    Slots  = reinterpret_cast<TShmRingSlot*>(Header + 1);
+    Header->WriteIndex.store(0, std::memory_order_relaxed);
+    for (uint64_t i = 0; i < slotCount; ++i) {
+        Slots[i].Seq.store(0, std::memory_order_relaxed);
+    }
+    Header->Magic     = WB_ADC_SHM_MAGIC;
+    Header->Version   = WB_ADC_SHM_VERSION;
+    Header->SlotCount = slotCount;
+    Header->Active.store(1, std::memory_order_release);
+}
+
+TShmRingWriter::~TShmRingWriter()
+{
+    Header->Active.store(0, std::memory_order_release);
+    munmap(Header, Size);
+    shm_unlink(Name.c_str());
+}
+
+void TShmRingWriter::Write(int64_t timestampUs, int32_t raw, double value)
+{
+    WriteShmSlot(Slots, Header->SlotCount, WriteIndex, TShmSample{timestampUs, raw, value});
+    ++WriteIndex;
+    Header->WriteIndex.store(WriteIndex, std::memory_order_release);
+}
+
+uint64_t TShmRingWriter::GetSlotCount() const
+{
+    return Header->SlotCount;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include "shm_ring.h"
+
+/**
+ * @brief Writer of a channel ring in POSIX shared memory, see shm_ring.h for the format.
+ * The object is created on construction and removed on destruction. Only one thread can call Write().
+ */
+class TShmRingWriter
+{
+public:
+    /**
+     * @brief Create or reinitialize the shared memory object of the channel.
+     * Throws std::runtime_error if it can't be created.
+     *
+     * @param channelId Channel id from config
+     * @param slotCount Minimum number of samples in the ring, it is rounded up to a power of two
+     */
+    TShmRingWriter(const std::string& channelId, uint64_t slotCount);
+    ~TShmRingWriter();
+
+    TShmRingWriter(const TShmRingWriter&) = delete;
+    TShmRingWriter& operator=(const TShmRingWriter&) = delete;
+
+    void Write(int64_t timestampUs, int32_t raw, double value);
+
+    uint64_t GetSlotCount() const;
+
+private:
+    std::string     Name;
+    TShmRingHeader* Header;
+    TShmRingSlot*   Slots;
+    size_t          Size;
+    uint64_t        WriteIndex;
+};
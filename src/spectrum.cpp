@@ -0,0 +1,222 @@
+#include "spectrum.h"
+
+#include <math.h>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    bool IsPowerOfTwo(size_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+}
+
+const char* DOMINANT_FREQUENCY_SUFFIX = "_dominant_frequency";
+
+bool operator==(const TSpectrumBand& a, const TSpectrumBand& b)
+{
+    return std::tie(a.Id, a.MinHz, a.MaxHz) == std::tie(b.Id, b.MinHz, b.MaxHz);
+}
+
+bool operator==(const TSpectrumSettings& a, const TSpectrumSettings& b)
+{
+    return std::tie(a.FftSize, a.PublishIntervalMs, a.SampleRate, a.Bands) ==
+           std::tie(b.FftSize, b.PublishIntervalMs, b.SampleRate, b.Bands);
+}
+
+void CheckSpectrumSettings(const TSpectrumSettings& settings)
+{
+    if (settings.FftSize < 4 || !IsPowerOfTwo(settings.FftSize)) {
+        throw std::runtime_error("fft_size must be a power of two");
+    }
+    if (settings.PublishIntervalMs == 0) {
+        throw std::runtime_error("publish_interval_ms must be positive");
+    }
+    if (settings.SampleRate < 0) {
+        throw std::runtime_error("sample_rate must not be negative");
+    }
+    std::set<std::string> ids;
+    for (const auto& band : settings.Bands) {
+        if (band.Id.empty() || "_" + band.Id == DOMINANT_FREQUENCY_SUFFIX || !ids.insert(band.Id).second) {
+            throw std::runtime_error("bad or duplicate band id \"" + band.Id + "\"");
+        }
+        if (band.MinHz < 0 || band.MinHz >= band.MaxHz) {
+            throw std::runtime_error("band " + band.Id + " is empty");
+        }
+    }
+}
+
+TRealFft::TRealFft(size_t size) : Size(size)
+{
+    if (size < 4 || !IsPowerOfTwo(size)) {
+        throw std::runtime_error("FFT size must be a power of two not less than 4");
+    }
+    size_t half = size / 2;
+    TwiddleRe.resize(half);
+    TwiddleIm.resize(half);
+    for (size_t k = 0; k < half; ++k) {
+        TwiddleRe[k] = cos(2 * M_PI * k / size);
+        TwiddleIm[k] = -sin(2 * M_PI * k / size);
+    }
+    size_t bits = 0;
+    while ((static_cast<size_t>(1) << bits) < half) {
+        ++bits;
+    }
+    BitReverse.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        BitReverse[i] = r;
+    }
+    Re.resize(half);
+    Im.resize(half);
+}
+
+size_t TRealFft::GetSize() const
+{
+    return Size;
+}
+
+void TRealFft::GetPowerSpectrum(const double* input, double* power)
+{
+    // even samples are real parts, odd ones are imaginary parts
+    size_t half = Size / 2;
+    for (size_t i = 0; i < half; ++i) {
+        Re[BitReverse[i]] = input[2 * i];
+        Im[BitReverse[i]] = input[2 * i + 1];
+    }
+
+    // iterative decimation in time, twiddles of length len are every Size / len-th entry of the table
+    for (size_t len = 2; len <= half; len *= 2) {
+        size_t step = Size / len;
+        size_t m    = len / 2;
+        for (size_t start = 0; start < half; start += len) {
+            double* re1 = &Re[start];
+            double* im1 = &Im[start];
+            double* re2 = re1 + m;
+            double* im2 = im1 + m;
+            for (size_t j = 0; j < m; ++j) {
+                double wr = TwiddleRe[j * step];
+                double wi = TwiddleIm[j * step];
+                double tr = re2[j] * wr - im2[j] * wi;
+                double ti = re2[j] * wi + im2[j] * wr;
+                re2[j]    = re1[j] - tr;
+                im2[j]    = im1[j] - ti;
+                re1[j] += tr;
+                im1[j] += ti;
+            }
+        }
+    }
+
+    // X[k] = E[k] + W^k * O[k], where E = (Z[k] + conj(Z[half - k])) / 2 and O = (Z[k] - conj(Z[half - k])) / 2i
+    power[0]    = (Re[0] + Im[0]) * (Re[0] + Im[0]);
+    power[half] = (Re[0] - Im[0]) * (Re[0] - Im[0]);
+    for (size_t k = 1; k < half; ++k) {
+        double ar = Re[k];
+        double ai = Im[k];
+        double br = Re[half - k];
+        double bi = -Im[half - k];
+        double er = (ar + br) / 2;
+        double ei = (ai + bi) / 2;
+        double or_ = (ai - bi) / 2;
+        double oi  = (br - ar) / 2;
+        double xr  = er + TwiddleRe[k] * or_ - TwiddleIm[k] * oi;
+        double xi  = ei + TwiddleRe[k] * oi + TwiddleIm[k] * or_;
+        power[k]   = xr * xr + xi * xi;
+    }
+}
+
+TSpectrumAnalyzer::TSpectrumAnalyzer(const TSpectrumSettings& settings)
+    : Fft(settings.FftSize), Bands(settings.Bands), SampleRate(settings.SampleRate), WindowPower(0), Head(0), Count(0)
+{
+    size_t n = settings.FftSize;
+    Window.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+        WindowPower += Window[i] * Window[i];
+    }
+    Values.resize(n);
+    Timestamps.resize(n);
+    Input.resize(n);
+    Power.resize(n / 2 + 1);
+    Result.BandRms.resize(Bands.size());
+}
+
+void TSpectrumAnalyzer::Add(int64_t timestampUs, double value)
+{
+    Values[Head]     = value;
+    Timestamps[Head] = timestampUs;
+    Head             = (Head + 1) % Values.size();
+    if (Count < Values.size()) {
+        ++Count;
+    }
+}
+
+bool TSpectrumAnalyzer::IsReady() const
+{
+    return Count == Values.size();
+}
+
+const TSpectrumResult& TSpectrumAnalyzer::Compute()
+{
+    size_t n    = Values.size();
+    size_t half = n / 2;
+
+    // Head points to the oldest sample of the full ring
+    double mean = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Input[i] = Values[(Head + i) % n];
+        mean += Input[i];
+    }
+    mean /= n;
+    for (size_t i = 0; i < n; ++i) {
+        Input[i] = (Input[i] - mean) * Window[i];
+    }
+    Fft.GetPowerSpectrum(Input.data(), Power.data());
+
+    if (SampleRate > 0) {
+        Result.SampleRate = SampleRate;
+    } else {
+        int64_t duration  = Timestamps[(Head + n - 1) % n] - Timestamps[Head];
+        Result.SampleRate = (duration > 0) ? (n - 1) * 1e6 / duration : 0;
+    }
+    double binHz = Result.SampleRate / n;
+
+    // Parseval's theorem for one-sided spectrum of windowed signal
+    double scale = 2 / (n * WindowPower);
+    for (size_t b = 0; b < Bands.size(); ++b) {
+        double sum = 0;
+        for (size_t k = 1; k <= half; ++k) {
+            double f = k * binHz;
+            if (f >= Bands[b].MinHz && f < Bands[b].MaxHz) {
+                sum += (k == half) ? Power[k] / 2 : Power[k];
+            }
+        }
+        Result.BandRms[b] = sqrt(sum * scale);
+    }
+
+    size_t peak = 1;
+    for (size_t k = 2; k < half; ++k) {
+        if (Power[k] > Power[peak]) {
+            peak = k;
+        }
+    }
+    Result.DominantFrequency = 0;
+    if (Power[peak] > 0) {
+        // parabolic interpolation of log power, it is exact for Gaussian peaks and close for Hann window
+        double a     = log(Power[peak - 1] + 1e-300);
+        double b     = log(Power[peak]);
+        double c     = log(Power[peak + 1] + 1e-300);
+        double d     = a - 2 * b + c;
+        double delta = (d < 0) ? 0.5 * (a - c) / d : 0;
+        Result.DominantFrequency = (peak + delta) * binHz;
+    }
+    return Result;
+}
+
+TSpectrumInput::TSpectrumInput(size_t capacity) : Samples(capacity), RawValueMultiplier(0)
+{}
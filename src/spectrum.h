@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sample_history.h"
+
+//! Frequency band of spectrum analysis
+struct TSpectrumBand
+{
+    //! Suffix of control id, the control is "CHANNEL_ID" + "_" + Id
+    std::string Id;
+
+    //! Bins with frequencies in range [MinHz, MaxHz) belong to the band
+    double MinHz = 0;
+    double MaxHz = 0;
+};
+
+bool operator==(const TSpectrumBand& a, const TSpectrumBand& b);
+
+//! Settings of spectrum analysis of a channel
+struct TSpectrumSettings
+{
+    //! Number of samples in FFT window, a power of two. If 0, the analysis is disabled
+    uint32_t FftSize = 0;
+
+    //! Interval between computations and publications of spectral features
+    uint32_t PublishIntervalMs = 1000;
+
+    //! Sample rate in Hz. If 0, it is estimated from timestamps of samples
+    double SampleRate = 0;
+
+    std::vector<TSpectrumBand> Bands;
+};
+
+bool operator==(const TSpectrumSettings& a, const TSpectrumSettings& b);
+
+//! Suffix of control id of the dominant frequency
+extern const char* DOMINANT_FREQUENCY_SUFFIX;
+
+//! Check settings of enabled analysis. Throws std::runtime_error if they are invalid
+void CheckSpectrumSettings(const TSpectrumSettings& settings);
+
+/**
+ * @brief Radix-2 FFT of real signal. It computes complex FFT of half size over even and odd samples
+ * and splits the result. Twiddle factors and bit reversal permutation are precomputed, real and
+ * imaginary parts are kept in separate arrays, so butterflies are vectorizable by the compiler.
+ */
+class TRealFft
+{
+public:
+    /**
+     * @brief Construct a new TRealFft object. Throws std::runtime_error if size is not a power of two
+     * or is less than 4.
+     */
+    explicit TRealFft(size_t size);
+
+    size_t GetSize() const;
+
+    /**
+     * @brief Compute squared magnitudes of bins of the signal. The method doesn't allocate memory.
+     *
+     * @param input GetSize() samples
+     * @param power GetSize() / 2 + 1 values for frequencies from 0 to the half of sample rate
+     */
+    void GetPowerSpectrum(const double* input, double* power);
+
+private:
+    size_t Size;
+
+    //! exp(-2 * pi * i * k / Size) for k < Size / 2
+    std::vector<double> TwiddleRe;
+    std::vector<double> TwiddleIm;
+
+    //! Bit reversal permutation of Size / 2 indexes
+    std::vector<uint32_t> BitReverse;
+
+    //! Complex FFT of half size
+    std::vector<double> Re;
+    std::vector<double> Im;
+};
+
+//! Spectral features of a window in units of input values
+struct TSpectrumResult
+{
+    //! Sample rate from settings or estimated from timestamps of the window in Hz
+    double SampleRate = 0;
+
+    //! Frequency of the highest peak interpolated between bins in Hz, DC is excluded
+    double DominantFrequency = 0;
+
+    //! RMS of signal components in frequency bands in order of TSpectrumSettings::Bands
+    std::vector<double> BandRms;
+};
+
+/**
+ * @brief The class keeps the last FftSize samples of a channel and computes spectral features
+ * of them. DC is subtracted and Hann window is applied before FFT. Band RMS is computed from
+ * bins of the band with correction for window power, so a sine with amplitude A in the band
+ * gives A / sqrt(2). Samples are expected to be taken at a constant rate.
+ */
+class TSpectrumAnalyzer
+{
+public:
+    //! Construct a new TSpectrumAnalyzer object. Throws std::runtime_error if settings are invalid
+    explicit TSpectrumAnalyzer(const TSpectrumSettings& settings);
+
+    //! Add a sample replacing the oldest one
+    void Add(int64_t timestampUs, double value);
+
+    //! The window is full
+    bool IsReady() const;
+
+    //! Compute features of the last FftSize samples. The method doesn't allocate memory
+    const TSpectrumResult& Compute();
+
+private:
+    TRealFft                   Fft;
+    std::vector<TSpectrumBand> Bands;
+    double                     SampleRate;
+
+    //! Hann window and sum of its squares
+    std::vector<double> Window;
+    double              WindowPower;
+
+    //! Ring buffer of the last samples
+    std::vector<double>  Values;
+    std::vector<int64_t> Timestamps;
+    size_t               Head;
+    size_t               Count;
+
+    std::vector<double> Input;
+    std::vector<double> Power;
+    TSpectrumResult     Result;
+};
+
+/**
+ * @brief Samples of a channel passed from its sampling thread to the spectrum analysis thread.
+ * The sampling thread adds samples to the store without locks.
+ */
+struct TSpectrumInput
+{
+    explicit TSpectrumInput(size_t capacity);
+
+    //! Raw ADC samples
+    TSampleHistory Samples;
+
+    //! Multiplier of raw values to get values in V. It is set by the reader of the channel, 0 until the reader is created
+    std::atomic<double> RawValueMultiplier;
+};
@@ -0,0 +1,201 @@
+#include "statistics.h"
+
+#include "value_format.h"
+
+namespace
+{
+    //! Values below 2^LINEAR_BITS have own buckets
+    const uint32_t LINEAR_BITS = 5;
+
+    //! Number of buckets per power of two above linear range is 2^SUB_BUCKET_BITS
+    const uint32_t SUB_BUCKET_BITS = 4;
+
+    //! Bigger values are counted in the last bucket
+    const uint32_t MAX_VALUE_BITS = 36;
+
+    const uint64_t MAX_VALUE = (static_cast<uint64_t>(1) << MAX_VALUE_BITS) - 1;
+
+    const double NS_IN_US = 1000.0;
+
+    std::string Format(double value, uint32_t decimalPlaces)
+    {
+        char buf[64];
+        FormatDecimal(value, decimalPlaces, buf, sizeof(buf));
+        return buf;
+    }
+} // namespace
+
+size_t TLatencyHistogram::GetBucketIndex(uint64_t value)
+{
+    if (value < (static_cast<uint64_t>(1) << LINEAR_BITS)) {
+        return value;
+    }
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    // the highest SUB_BUCKET_BITS + 1 bits select the bucket
+    uint32_t shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+    return (shift << SUB_BUCKET_BITS) + (value >> shift);
+}
+
+uint64_t TLatencyHistogram::GetBucketUpperBound(size_t index)
+{
+    if (index < (static_cast<size_t>(1) << LINEAR_BITS)) {
+        return index;
+    }
+    uint32_t shift    = (index >> SUB_BUCKET_BITS) - 1;
+    uint64_t mantissa = (index & ((1 << SUB_BUCKET_BITS) - 1)) + (1 << SUB_BUCKET_BITS);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+size_t TLatencyHistogram::GetBucketCount()
+{
+    return GetBucketIndex(MAX_VALUE) + 1;
+}
+
+TLatencyHistogram::TLatencyHistogram() : Counts(new std::atomic<uint64_t>[GetBucketCount()])
+{
+    for (size_t i = 0; i < GetBucketCount(); ++i) {
+        Counts[i] = 0;
+    }
+}
+
+void TLatencyHistogram::Record(std::chrono::nanoseconds value)
+{
+    uint64_t v = (value.count() < 0) ? 0 : value.count();
+    Counts[GetBucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+}
+
+TLatencyHistogram::TSnapshot TLatencyHistogram::GetSnapshot() const
+{
+    TSnapshot res;
+    for (size_t i = 0; i < res.Counts.size(); ++i) {
+        res.Counts[i] = Counts[i].load(std::memory_order_relaxed);
+        res.Count += res.Counts[i];
+    }
+    return res;
+}
+
+TLatencyHistogram::TSnapshot::TSnapshot() : Counts(GetBucketCount()), Count(0) {}
+
+uint64_t TLatencyHistogram::TSnapshot::GetCount() const
+{
+    return Count;
+}
+
+uint64_t TLatencyHistogram::TSnapshot::GetPercentile(double fraction) const
+{
+    if (Count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * Count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < Counts.size(); ++i) {
+        sum += Counts[i];
+        if (sum >= rank) {
+            return GetBucketUpperBound(i);
+        }
+    }
+    return GetBucketUpperBound(Counts.size() - 1);
+}
+
+TLatencyHistogram::TSnapshot TLatencyHistogram::TSnapshot::operator-(const TSnapshot& older) const
+{
+    TSnapshot res;
+    for (size_t i = 0; i < Counts.size(); ++i) {
+        res.Counts[i] = Counts[i] - older.Counts[i];
+        res.Count += res.Counts[i];
+    }
+    return res;
+}
+
+void TStatisticsCollector::AddChannel(const std::string& id, std::shared_ptr<const TReadStatistics> stats, bool jitter)
+{
+    TChannel channel;
+    channel.Id     = id;
+    channel.Stats  = stats;
+    channel.Jitter = jitter;
+    Channels.push_back(std::move(channel));
+}
+
+void TStatisticsCollector::AddCycle(const std::string& id, std::shared_ptr<const TLatencyHistogram> cycleDuration)
+{
+    TCycle cycle;
+    cycle.Id       = id;
+    cycle.Duration = cycleDuration;
+    Cycles.push_back(std::move(cycle));
+}
+
+void TStatisticsCollector::SetQueueDepthSource(std::function<size_t()> fn)
+{
+    QueueDepth = fn;
+}
+
+std::vector<std::string> TStatisticsCollector::GetControlIds() const
+{
+    std::vector<std::string> res;
+    for (const auto& channel : Channels) {
+        for (const char* suffix : {"_read_p50_us", "_read_p99_us", "_samples_per_s", "_errors", "_retries"}) {
+            res.push_back(channel.Id + suffix);
+        }
+        if (channel.Jitter) {
+            res.push_back(channel.Id + "_jitter_p50_us");
+            res.push_back(channel.Id + "_jitter_p99_us");
+        }
+    }
+    for (const auto& cycle : Cycles) {
+        for (const char* suffix : {"_cycle_p50_us", "_cycle_p99_us", "_cycles_per_s"}) {
+            res.push_back(cycle.Id + suffix);
+        }
+    }
+    if (QueueDepth) {
+        res.push_back("publish_queue_depth");
+    }
+    return res;
+}
+
+std::vector<TStatisticsCollector::TControlValue> TStatisticsCollector::Collect(TClock::time_point now)
+{
+    std::chrono::duration<double> interval = now - LastCollect;
+    // the first call calculates rates since start of sampling which is unknown
+    double seconds = (LastCollect == TClock::time_point()) ? 0 : interval.count();
+    LastCollect    = now;
+
+    std::vector<TControlValue> res;
+    for (auto& channel : Channels) {
+        auto     latency         = channel.Stats->ReadLatency.GetSnapshot();
+        auto     intervalLatency = latency - channel.LastLatency;
+        uint64_t samples         = channel.Stats->Samples.load(std::memory_order_relaxed);
+        res.emplace_back(channel.Id + "_read_p50_us", Format(intervalLatency.GetPercentile(0.5) / NS_IN_US, 1));
+        res.emplace_back(channel.Id + "_read_p99_us", Format(intervalLatency.GetPercentile(0.99) / NS_IN_US, 1));
+        res.emplace_back(channel.Id + "_samples_per_s",
+                         Format(seconds > 0 ? (samples - channel.LastSamples) / seconds : 0, 1));
+        res.emplace_back(channel.Id + "_errors", std::to_string(channel.Stats->Errors.load(std::memory_order_relaxed)));
+        res.emplace_back(channel.Id + "_retries", std::to_string(channel.Stats->Retries.load(std::memory_order_relaxed)));
+        if (channel.Jitter) {
+            auto jitter         = channel.Stats->SamplingJitter.GetSnapshot();
+            auto intervalJitter = jitter - channel.LastJitter;
+            res.emplace_back(channel.Id + "_jitter_p50_us", Format(intervalJitter.GetPercentile(0.5) / NS_IN_US, 1));
+            res.emplace_back(channel.Id + "_jitter_p99_us", Format(intervalJitter.GetPercentile(0.99) / NS_IN_US, 1));
+            channel.LastJitter = std::move(jitter);
+        }
+        channel.LastLatency = std::move(latency);
+        channel.LastSamples = samples;
+    }
+    for (auto& cycle : Cycles) {
+        auto duration         = cycle.Duration->GetSnapshot();
+        auto intervalDuration = duration - cycle.LastDuration;
+        res.emplace_back(cycle.Id + "_cycle_p50_us", Format(intervalDuration.GetPercentile(0.5) / NS_IN_US, 1));
+        res.emplace_back(cycle.Id + "_cycle_p99_us", Format(intervalDuration.GetPercentile(0.99) / NS_IN_US, 1));
+        res.emplace_back(cycle.Id + "_cycles_per_s",
+                         Format(seconds > 0 ? intervalDuration.GetCount() / seconds : 0, 1));
+        cycle.LastDuration = std::move(duration);
+    }
+    if (QueueDepth) {
+        res.emplace_back("publish_queue_depth", std::to_string(QueueDepth()));
+    }
+    return res;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Lock-free histogram of durations with log-linear buckets like HdrHistogram has.
+ * Values below 32 nS have own buckets, bigger ones are split into 16 buckets per power of two,
+ * so relative error is less than 1/16. Values above 2^36 nS (about 68 S) are counted in the last bucket.
+ * Record() can be called from any thread without locks.
+ */
+class TLatencyHistogram
+{
+public:
+    //! Copy of histogram counters
+    class TSnapshot
+    {
+    public:
+        TSnapshot();
+
+        //! Number of recorded values
+        uint64_t GetCount() const;
+
+        /**
+         * @brief Value below or equal to which given fraction of recorded values are. The result is
+         * upper bound of the histogram bucket containing the value.
+         *
+         * @param fraction Fraction of values from 0 to 1
+         * @return Value in nS or 0 if there are no values
+         */
+        uint64_t GetPercentile(double fraction) const;
+
+        //! Counts recorded after the older snapshot
+        TSnapshot operator-(const TSnapshot& older) const;
+
+    private:
+        std::vector<uint64_t> Counts;
+        uint64_t              Count;
+
+        friend class TLatencyHistogram;
+    };
+
+    TLatencyHistogram();
+
+    TLatencyHistogram(const TLatencyHistogram&) = delete;
+    TLatencyHistogram& operator=(const TLatencyHistogram&) = delete;
+
+    void Record(std::chrono::nanoseconds value);
+
+    TSnapshot GetSnapshot() const;
+
+    //! Number of buckets of every histogram
+    static size_t GetBucketCount();
+
+    //! Index of a bucket for the value in nS
+    static size_t GetBucketIndex(uint64_t value);
+
+    //! Maximum value in nS counted in the bucket
+    static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> Counts;
+};
+
+//! Counters of a channel reader. They are updated by a sampling thread and read by any other thread
+struct TReadStatistics
+{
+    //! Time of reading of a single sample from ADC
+    TLatencyHistogram ReadLatency;
+
+    //! Delay of readings from their deadlines when the channel is read at a constant rate
+    TLatencyHistogram SamplingJitter;
+
+    //! Number of successfully read samples
+    std::atomic<uint64_t> Samples{0};
+
+    //! Number of failed measurements
+    std::atomic<uint64_t> Errors{0};
+
+    //! Number of repeated attempts to read a sample
+    std::atomic<uint64_t> Retries{0};
+};
+
+/**
+ * @brief The class converts counters of samplers to values of diagnostic controls.
+ * Percentiles and rates are calculated for the interval between calls of Collect().
+ */
+class TStatisticsCollector
+{
+public:
+    typedef std::chrono::steady_clock TClock;
+
+    //! Control id and its value
+    typedef std::pair<std::string, std::string> TControlValue;
+
+    /**
+     * @brief Add controls for a channel: ID_read_p50_us, ID_read_p99_us, ID_samples_per_s, ID_errors and ID_retries
+     *
+     * @param jitter Add ID_jitter_p50_us and ID_jitter_p99_us controls with sampling jitter
+     */
+    void AddChannel(const std::string& id, std::shared_ptr<const TReadStatistics> stats, bool jitter = false);
+
+    /**
+     * @brief Add controls for a sampling thread: ID_cycle_p50_us, ID_cycle_p99_us and ID_cycles_per_s
+     */
+    void AddCycle(const std::string& id, std::shared_ptr<const TLatencyHistogram> cycleDuration);
+
+    //! Add publish_queue_depth control with value returned by fn
+    void SetQueueDepthSource(std::function<size_t()> fn);
+
+    //! Ids of all controls in order of Collect() result
+    std::vector<std::string> GetControlIds() const;
+
+    //! Get values of all controls since the previous call. Call it from one thread only
+    std::vector<TControlValue> Collect(TClock::time_point now);
+
+private:
+    struct TChannel
+    {
+        std::string                            Id;
+        std::shared_ptr<const TReadStatistics> Stats;
+        TLatencyHistogram::TSnapshot           LastLatency;
+        uint64_t                               LastSamples = 0;
+        bool                                   Jitter      = false;
+        TLatencyHistogram::TSnapshot           LastJitter;
+    };
+
+    struct TCycle
+    {
+        std::string                              Id;
+        std::shared_ptr<const TLatencyHistogram> Duration;
+        TLatencyHistogram::TSnapshot             LastDuration;
+    };
+
+    std::vector<TChannel>   Channels;
+    std::vector<TCycle>     Cycles;
+    std::function<size_t()> QueueDepth;
+    TClock::time_point      LastCollect;
+};
@@ -0,0 +1,122 @@
+#include "stop_event.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    /**
+     * @brief Poll file descriptors until the deadline restarting on signals.
+     * Throws std::system_error if ppoll fails.
+     *
+     * @param deadline Time to stop waiting. If nullptr, the timeout is infinite
+     * @return int Number of ready descriptors or 0 on timeout
+     */
+    int Poll(pollfd* fds, nfds_t n, const std::chrono::steady_clock::time_point* deadline)
+    {
+        for (;;) {
+            timespec  ts;
+            timespec* tsPtr = nullptr;
+            if (deadline) {
+                auto left =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - std::chrono::steady_clock::now());
+                if (left.count() < 0) {
+                    left = std::chrono::nanoseconds(0);
+                }
+                ts.tv_sec  = left.count() / 1000000000;
+                ts.tv_nsec = left.count() % 1000000000;
+                tsPtr      = &ts;
+            }
+            int res = ppoll(fds, n, tsPtr, nullptr);
+            if (res >= 0) {
+                return res;
+            }
+            if (errno != EINTR) {
+                // a failed wait must not be taken for a timeout, the caller would spin without sleeping
+                throw std::system_error(errno, std::generic_category(), "ppoll failed");
+            }
+        }
+    }
+
+    int Poll(pollfd* fds, nfds_t n, std::chrono::microseconds timeout)
+    {
+        if (timeout.count() < 0) {
+            return Poll(fds, n, nullptr);
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return Poll(fds, n, &deadline);
+    }
+} // namespace
+
+TStopEvent::TStopEvent() : Flag(false)
+{
+    Fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (Fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "eventfd failed");
+    }
+}
+
+TStopEvent::~TStopEvent()
+{
+    close(Fd);
+}
+
+void TStopEvent::Set()
+{
+    Flag = true;
+    // the counter is never read, so the descriptor stays readable and wakes up all waiters
+    uint64_t v = 1;
+    if (write(Fd, &v, sizeof(v)) != sizeof(v)) {
+        // the counter is already non zero
+    }
+}
+
+bool TStopEvent::IsSet() const
+{
+    return Flag;
+}
+
+void TStopEvent::Reset()
+{
+    uint64_t v;
+    if (read(Fd, &v, sizeof(v)) != sizeof(v)) {
+        // the counter is already zero
+    }
+    Flag = false;
+}
+
+bool TStopEvent::WaitFor(std::chrono::microseconds timeout) const
+{
+    pollfd pfd{Fd, POLLIN, 0};
+    Poll(&pfd, 1, timeout);
+    return !IsSet();
+}
+
+bool TStopEvent::WaitUntil(std::chrono::steady_clock::time_point deadline) const
+{
+    pollfd pfd{Fd, POLLIN, 0};
+    Poll(&pfd, 1, &deadline);
+    return !IsSet();
+}
+
+bool TStopEvent::WaitReadable(int fd, std::chrono::microseconds timeout) const
+{
+    pollfd pfds[2] = {{Fd, POLLIN, 0}, {fd, POLLIN, 0}};
+    if (Poll(pfds, 2, timeout) == 0 || IsSet()) {
+        return false;
+    }
+    return (pfds[1].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
+
+bool WaitFor(const TStopEvent* stopEvent, std::chrono::microseconds timeout)
+{
+    if (stopEvent) {
+        return stopEvent->WaitFor(timeout);
+    }
+    std::this_thread::sleep_for(timeout);
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Event to interrupt waits of worker threads. It is based on eventfd, so it can be polled
+ * together with other file descriptors. After Set() all current and future waits return
+ * immediately. Waits throw std::system_error if polling fails.
+ */
+class TStopEvent
+{
+public:
+    //! Throws std::system_error if eventfd can't be created
+    TStopEvent();
+    ~TStopEvent();
+
+    TStopEvent(const TStopEvent&) = delete;
+    TStopEvent& operator=(const TStopEvent&) = delete;
+
+    //! Set the event and wake up all waiting threads
+    void Set();
+
+    bool IsSet() const;
+
+    //! Clear the event, so it can be reused. It must not be called while other threads wait for the event
+    void Reset();
+
+    /**
+     * @brief Wait for timeout or the event
+     *
+     * @return true The timeout is over
+     * @return false The event is set
+     */
+    bool WaitFor(std::chrono::microseconds timeout) const;
+
+    /**
+     * @brief Wait until the deadline or the event. Time left is recalculated after every wake up,
+     * so the wait ends at the deadline regardless of time spent before the call.
+     *
+     * @return true The deadline is reached
+     * @return false The event is set
+     */
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline) const;
+
+    /**
+     * @brief Wait until the file descriptor is readable, the timeout is over or the event is set
+     *
+     * @param fd File descriptor to wait for
+     * @param timeout Maximum time to wait. Negative value means infinite timeout
+     * @return true The file descriptor is readable
+     * @return false The timeout is over or the event is set
+     */
+    bool WaitReadable(int fd, std::chrono::microseconds timeout) const;
+
+private:
+    int               Fd;
+    std::atomic<bool> Flag;
+};
+
+/**
+ * @brief Wait for timeout or the event. If stopEvent is nullptr, the function just sleeps.
+ *
+ * @return true The timeout is over
+ * @return false The event is set
+ */
+bool WaitFor(const TStopEvent* stopEvent, std::chrono::microseconds timeout);
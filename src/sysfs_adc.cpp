@@ -1,13 +1,43 @@
 #include "sysfs_adc.h"
 
 #include <fnmatch.h>
-#include <iomanip>
+#include <sstream>
 #include <math.h>
 #include <unistd.h>
 
 #include <wblib/utils.h>
 
 #include "file_utils.h"
+#include "value_format.h"
+
+namespace
+{
+    //! Frequency is published with the precision regardless of channel settings
+    const uint32_t FREQUENCY_DECIMAL_PLACES = 2;
+
+    //! Number of attempts to read a sample from sysfs
+    const size_t READ_ATTEMPTS = 3;
+
+    int64_t GetTimestampUs()
+    {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    //! Time of CLOCK_MONOTONIC in uS
+    int64_t ToUs(TChannelReader::TClock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    std::chrono::nanoseconds GetSamplingPeriod(const TChannelReader::TSettings& cfg, uint32_t delayBetweenMeasurementsmS)
+    {
+        if (cfg.AcMode) {
+            return std::chrono::nanoseconds(1000000000 / cfg.AcSampleRate);
+        }
+        return std::chrono::milliseconds(delayBetweenMeasurementsmS);
+    }
+}
 
 TChannelReader::TChannelReader(double                           defaultIIOScale,
                                uint32_t                         maxADCvalue,
@@ -15,80 +45,313 @@ TChannelReader::TChannelReader(double                           defaultIIOScale,
                                uint32_t                         delayBetweenMeasurementsmS,
                                WBMQTT::TLogger&                 debugLogger,
                                WBMQTT::TLogger&                 infoLogger,
-                               const std::string&               sysfsIIODir)
-    : Cfg(cfg), SysfsIIODir(sysfsIIODir), IIOScale(defaultIIOScale), MaxADCValue(maxADCvalue), DelayBetweenMeasurementsmS(delayBetweenMeasurementsmS),
-      AverageCounter(cfg.AveragingWindow), DebugLogger(debugLogger)
+                               const std::string&               sysfsIIODir,
+                               const TStopEvent*                stopEvent,
+                               TFileContentsCache*              scaleFiles)
+    : Cfg(cfg), MeasuredValue(0), SysfsIIODir(sysfsIIODir), RawFile(sysfsIIODir + "/in_" + cfg.ChannelNumber + "_raw"), IIOScale(defaultIIOScale), MaxADCValue(maxADCvalue), DelayBetweenMeasurementsmS(delayBetweenMeasurementsmS),
+      Clock(GetSamplingPeriod(cfg, delayBetweenMeasurementsmS)), StopEvent(stopEvent),
+      Filter(MakeFilter(cfg.Filter, cfg.AveragingWindow, cfg.TrimPercent)), DebugLogger(debugLogger), AcResultReady(false),
+      AcValues()
 {
-    SelectScale(infoLogger);
+    if (Cfg.AcMode) {
+        AcAnalyzer.reset(new TAcAnalyzer(static_cast<int64_t>(Cfg.AcWindowMs) * 1000));
+    }
+    if (scaleFiles) {
+        SelectScale(infoLogger, *scaleFiles);
+    } else {
+        TFileContentsCache files;
+        SelectScale(infoLogger, files);
+    }
+    // the table depends on the selected scale
+    if (!Cfg.Conversion.empty()) {
+        Conversion.reset(new TConversionTable(Cfg.Conversion, MaxADCValue, GetRawValueMultiplier()));
+    }
 }
 
-std::string TChannelReader::GetValue() const
+const std::string& TChannelReader::GetValue() const
 {
     return MeasuredV;
 }
 
-void TChannelReader::Measure(const std::string& debugMessagePrefix)
+double TChannelReader::GetNumericValue() const
 {
+    return MeasuredValue;
+}
+
+TChannelReader::TClock::time_point TChannelReader::GetMeasurementTime() const
+{
+    return MeasurementTime;
+}
+
+double TChannelReader::GetAcValue(TAcQuantity quantity) const
+{
+    return AcValues[static_cast<size_t>(quantity)];
+}
+
+const std::string& TChannelReader::GetAcText(TAcQuantity quantity) const
+{
+    return AcTexts[static_cast<size_t>(quantity)];
+}
+
+TMeasureStatus TChannelReader::Measure(const std::string& debugMessagePrefix)
+{
+    if (AcAnalyzer) {
+        return MeasureAc(debugMessagePrefix);
+    }
+    Clock.Start();
     for (uint32_t i = 0; i < Cfg.ReadingsNumber; ++i) {
-        int32_t adcMeasurement = ReadFromADC();
-        DebugLogger.Log() << debugMessagePrefix << Cfg.ChannelNumber << " = " << adcMeasurement;
-        AverageCounter.AddValue(adcMeasurement);
-        std::this_thread::sleep_for(std::chrono::milliseconds(DelayBetweenMeasurementsmS));
+        int32_t value;
+        if (!ReadFromADC(value)) {
+            if (StopEvent && StopEvent->IsSet()) {
+                return TMeasureStatus::Interrupted;
+            }
+            LastError = "Can't read from " + RawFile.GetFileName();
+            return TMeasureStatus::ReadError;
+        }
+        AddSample(value, debugMessagePrefix);
+        if (DelayBetweenMeasurementsmS && !Clock.WaitNext(StopEvent)) {
+            return TMeasureStatus::Interrupted;
+        }
+    }
+    return ConvertValue(debugMessagePrefix);
+}
+
+TMeasureStatus TChannelReader::MeasureAc(const std::string& debugMessagePrefix)
+{
+    Clock.Start();
+    while (!AcResultReady) {
+        int32_t value;
+        if (!ReadFromADC(value)) {
+            if (StopEvent && StopEvent->IsSet()) {
+                return TMeasureStatus::Interrupted;
+            }
+            LastError = "Can't read from " + RawFile.GetFileName();
+            return TMeasureStatus::ReadError;
+        }
+        AddSample(value, debugMessagePrefix);
+        if (!Clock.WaitNext(StopEvent)) {
+            return TMeasureStatus::Interrupted;
+        }
+    }
+    return ConvertValue(debugMessagePrefix);
+}
+
+void TChannelReader::AddSample(int32_t adcMeasurement, const std::string& debugMessagePrefix)
+{
+    auto    sampleTime  = TClock::now();
+    int64_t timestampUs = 0;
+    // the time since the epoch is needed only for stored and exported samples
+    if (History || SampleExport) {
+        timestampUs = GetTimestampUs();
     }
+    AddSample(adcMeasurement, timestampUs, sampleTime, debugMessagePrefix);
+}
 
-    if (!AverageCounter.IsReady()) {
+void TChannelReader::AddSample(int32_t            adcMeasurement,
+                               int64_t            timestampUs,
+                               TClock::time_point sampleTime,
+                               const std::string& debugMessagePrefix)
+{
+    DebugLogger.Log() << debugMessagePrefix << Cfg.ChannelNumber << " = " << adcMeasurement;
+    LastSampleTime = sampleTime;
+    // analysis uses monotonic time, so adjustments of the system clock don't distort frequencies
+    if (AcAnalyzer) {
+        if (AcAnalyzer->Add(ToUs(sampleTime), adcMeasurement)) {
+            AcResultReady = true;
+        }
+    } else {
+        Filter->AddValue(adcMeasurement);
+    }
+    if (Statistics) {
+        Statistics->Samples.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (History) {
+        History->Add(timestampUs, adcMeasurement);
+    }
+    if (SpectrumInput) {
+        SpectrumInput->Samples.Add(ToUs(sampleTime), adcMeasurement);
+    }
+    if (SampleExport) {
+        SampleExport->Write(timestampUs, adcMeasurement, adcMeasurement * GetRawValueMultiplier());
+    }
+}
+
+TMeasureStatus TChannelReader::ConvertValue(const std::string& debugMessagePrefix)
+{
+    if (AcAnalyzer) {
+        return ConvertAcValue(debugMessagePrefix);
+    }
+    if (!Filter->IsReady()) {
         DebugLogger.Log() << debugMessagePrefix << Cfg.ChannelNumber << " average is not ready";
-        return;
+        return TMeasureStatus::NotReady;
     }
 
-    int32_t value = AverageCounter.GetAverage();
-    if (value >= 0 && ((uint32_t)value) > MaxADCValue) {
-        throw std::runtime_error(debugMessagePrefix + Cfg.ChannelNumber + " average (" + std::to_string(value) + ") is bigger than maximum (" + std::to_string(MaxADCValue) + ")");
+    int64_t fixedPointValue = Filter->GetFixedPointValue(Cfg.FractionalBits);
+    double  value           = std::ldexp(fixedPointValue, -static_cast<int>(Cfg.FractionalBits));
+    if (fixedPointValue > (static_cast<int64_t>(MaxADCValue) << Cfg.FractionalBits)) {
+        if (Statistics) {
+            Statistics->Errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::ostringstream valueStr;
+        valueStr << value;
+        LastError = debugMessagePrefix + Cfg.ChannelNumber + " average (" + valueStr.str() + ") is bigger than maximum (" + std::to_string(MaxADCValue) + ")";
+        return TMeasureStatus::Overflow;
     }
 
     double v = IIOScale * value;
     if (v > Cfg.MaxScaledVoltage) {
-        throw std::runtime_error(debugMessagePrefix + Cfg.ChannelNumber + " scaled value (" + std::to_string(v) + ") is bigger than maximum (" +
-                                 std::to_string(Cfg.MaxScaledVoltage) + ")");
+        if (Statistics) {
+            Statistics->Errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        LastError = debugMessagePrefix + Cfg.ChannelNumber + " scaled value (" + std::to_string(v) + ") is bigger than maximum (" +
+                    std::to_string(Cfg.MaxScaledVoltage) + ")";
+        return TMeasureStatus::Overflow;
+    }
+
+    double res;
+    if (!Conversion) {
+        res = v * Cfg.VoltageMultiplier / 1000.0; // got mV let's divide it by 1000 to obtain V
+    } else if (!Conversion->Convert(fixedPointValue, Cfg.FractionalBits, res)) {
+        if (Statistics) {
+            Statistics->Errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        LastError = debugMessagePrefix + Cfg.ChannelNumber + " value (" + std::to_string(value) + ") is out of conversion range";
+        return TMeasureStatus::Overflow;
+    }
+
+    // MeasuredV keeps its capacity, so formatting doesn't allocate memory after the first measurement
+    FormatDecimal(res, Cfg.DecimalPlaces, MeasuredV);
+    MeasuredValue   = res;
+    MeasurementTime = LastSampleTime;
+    return TMeasureStatus::Ok;
+}
+
+TMeasureStatus TChannelReader::ConvertAcValue(const std::string& debugMessagePrefix)
+{
+    if (!AcResultReady) {
+        DebugLogger.Log() << debugMessagePrefix << Cfg.ChannelNumber << " AC window is not complete";
+        return TMeasureStatus::NotReady;
+    }
+    AcResultReady = false;
+
+    const auto& res = AcAnalyzer->GetResult();
+    if (res.Max > MaxADCValue) {
+        if (Statistics) {
+            Statistics->Errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        LastError = debugMessagePrefix + Cfg.ChannelNumber + " AC signal is clipped, maximum (" + std::to_string(res.Max) +
+                    ") is bigger than " + std::to_string(MaxADCValue);
+        return TMeasureStatus::Overflow;
     }
 
-    double res = v * Cfg.VoltageMultiplier / 1000.0; // got mV let's divide it by 1000 to obtain V
+    double k                                               = GetRawValueMultiplier();
+    AcValues[static_cast<size_t>(TAcQuantity::PeakToPeak)] = res.PeakToPeak * k;
+    AcValues[static_cast<size_t>(TAcQuantity::Dc)]         = res.Dc * k;
+    AcValues[static_cast<size_t>(TAcQuantity::Frequency)]  = res.Frequency;
+    for (size_t i = 0; i < AC_QUANTITY_COUNT; ++i) {
+        auto decimalPlaces = (i == static_cast<size_t>(TAcQuantity::Frequency)) ? FREQUENCY_DECIMAL_PLACES : Cfg.DecimalPlaces;
+        FormatDecimal(AcValues[i], decimalPlaces, AcTexts[i]);
+    }
+    MeasuredValue   = res.Rms * k;
+    MeasurementTime = LastSampleTime;
+    FormatDecimal(MeasuredValue, Cfg.DecimalPlaces, MeasuredV);
+    return TMeasureStatus::Ok;
+}
+
+const std::string& TChannelReader::GetLastError() const
+{
+    return LastError;
+}
+
+const std::string& TChannelReader::GetChannelNumber() const
+{
+    return Cfg.ChannelNumber;
+}
+
+const std::string& TChannelReader::GetSysfsIIODir() const
+{
+    return SysfsIIODir;
+}
+
+uint32_t TChannelReader::GetReadingsNumber() const
+{
+    return Cfg.ReadingsNumber;
+}
+
+void TChannelReader::SetStatistics(std::shared_ptr<TReadStatistics> statistics)
+{
+    Statistics = statistics;
+    Clock.SetJitterHistogram(Statistics ? &Statistics->SamplingJitter : nullptr);
+}
+
+const std::shared_ptr<TReadStatistics>& TChannelReader::GetStatistics() const
+{
+    return Statistics;
+}
+
+void TChannelReader::SetHistory(std::shared_ptr<TSampleStore> history)
+{
+    History = history;
+}
+
+void TChannelReader::SetSampleExport(std::shared_ptr<TShmRingWriter> writer)
+{
+    SampleExport = writer;
+}
+
+void TChannelReader::SetSpectrumInput(std::shared_ptr<TSpectrumInput> input)
+{
+    SpectrumInput = input;
+    if (SpectrumInput) {
+        SpectrumInput->RawValueMultiplier = GetRawValueMultiplier();
+    }
+}
 
-    std::ostringstream out;
-    out << std::setprecision(Cfg.DecimalPlaces) << std::fixed << res;
-    MeasuredV = out.str();
+double TChannelReader::GetRawValueMultiplier() const
+{
+    return IIOScale * Cfg.VoltageMultiplier / 1000.0;
 }
 
-int32_t TChannelReader::ReadFromADC()
+bool TChannelReader::ReadFromADC(int32_t& value)
 {
-    std::string fileName = SysfsIIODir + "/in_" + Cfg.ChannelNumber + "_raw";
-    for (size_t i = 0; i < 3; ++i) { // workaround for https://gcc.gnu.org/bugzilla/show_bug.cgi?id=53984
-        {
-            std::ifstream adcValStream;
-            OpenWithException(adcValStream, fileName);
-            int32_t val;
-            try {
-                adcValStream >> val;
-                if (adcValStream.good())
-                    return val;
-            } catch (const std::ios_base::failure& er) {
-                DebugLogger.Log() << er.what() << " " << fileName;
+    for (size_t i = 0; i < READ_ATTEMPTS; ++i) {
+        if (!Statistics) {
+            if (RawFile.ReadInt(value)) {
+                return true;
             }
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            bool ok    = RawFile.ReadInt(value);
+            Statistics->ReadLatency.Record(std::chrono::steady_clock::now() - start);
+            if (ok) {
+                return true;
+            }
+        }
+        DebugLogger.Log() << "Failed to read " << RawFile.GetFileName();
+        if (i + 1 == READ_ATTEMPTS) {
+            break;
+        }
+        if (!WaitFor(StopEvent, std::chrono::milliseconds(1))) {
+            break;
+        }
+        if (Statistics) {
+            Statistics->Retries.fetch_add(1, std::memory_order_relaxed);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-    throw std::runtime_error("Can't read from " + fileName);
+    if (Statistics) {
+        Statistics->Errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
 }
 
-void TChannelReader::SelectScale(WBMQTT::TLogger& infoLogger)
+void TChannelReader::SelectScale(WBMQTT::TLogger& infoLogger, TFileContentsCache& scaleFiles)
 {
     std::string scalePrefix = SysfsIIODir + "/in_" + Cfg.ChannelNumber + "_scale";
 
-    std::ifstream scaleFile;
-    TryOpen({scalePrefix + "_available", SysfsIIODir + "/in_voltage_scale_available", SysfsIIODir + "/scale_available"}, scaleFile);
-
-    if (scaleFile.is_open()) {
-        auto contents = std::string((std::istreambuf_iterator<char>(scaleFile)), std::istreambuf_iterator<char>());
+    std::string contents;
+    if (scaleFiles.Read({scalePrefix + "_available", SysfsIIODir + "/in_voltage_scale_available", SysfsIIODir + "/scale_available"},
+                        contents))
+    {
         infoLogger.Log() << "Available scales: " << contents;
 
         std::string bestScaleStr = FindBestScale(WBMQTT::StringSplit(contents, " "), Cfg.DesiredScale);
@@ -103,31 +366,76 @@ void TChannelReader::SelectScale(WBMQTT::TLogger& infoLogger)
 
     // scale_available file is not present read the current scale(in_voltageX_scale) from sysfs or
     // from group scale(in_voltage_scale)
-    TryOpen({scalePrefix, SysfsIIODir + "/in_voltage_scale"}, scaleFile);
-    if (scaleFile.is_open()) {
-        scaleFile >> IIOScale;
+    if (scaleFiles.Read({scalePrefix, SysfsIIODir + "/in_voltage_scale"}, contents)) {
+        std::istringstream(contents) >> IIOScale;
     }
     infoLogger.Log() << scalePrefix << " = " << IIOScale;
 }
 
-std::string FindSysfsIIODir(const std::string& matchIIO)
+TIIODeviceIndex::TIIODeviceIndex(const std::string& devicesDir) : DevicesDir(devicesDir), Scanned(false)
+{}
+
+std::string TIIODeviceIndex::Find(const std::string& matchIIO)
 {
     if (matchIIO.empty()) {
-        return "/sys/bus/iio/devices/iio:device0";
+        std::string dir = DevicesDir + "/iio:device0";
+        if (!Scanned) {
+            return dir;
+        }
+        for (const auto& device : Devices) {
+            if (device.second == dir) {
+                return dir;
+            }
+        }
+        return std::string();
+    }
+    if (!Scanned) {
+        Scan();
     }
 
     std::string pattern = "*" + matchIIO + "*";
+    for (const auto& device : Devices) {
+        if (fnmatch(pattern.c_str(), device.first.c_str(), 0) == 0) {
+            return device.second;
+        }
+    }
+    return std::string();
+}
+
+size_t TIIODeviceIndex::GetDeviceCount() const
+{
+    return Devices.size();
+}
 
-    auto fn = [&](const std::string& d) {
+bool TIIODeviceIndex::Rescan()
+{
+    auto prevDevices = std::move(Devices);
+    Devices.clear();
+    try {
+        Scan();
+    } catch (const TNoDirError&) {
+        Scanned = true;
+    }
+    return Devices != prevDevices;
+}
+
+void TIIODeviceIndex::Scan()
+{
+    IterateDir(DevicesDir, "iio:device", [&](const std::string& d) {
         char buf[512];
         int  len;
-        if ((len = readlink(d.c_str(), buf, 512)) < 0)
-            return false;
-        buf[len] = 0;
-        return (fnmatch(pattern.c_str(), buf, 0) == 0);
-    };
+        if ((len = readlink(d.c_str(), buf, sizeof(buf) - 1)) >= 0) {
+            buf[len] = 0;
+            Devices.emplace_back(buf, d);
+        }
+        return false;
+    });
+    Scanned = true;
+}
 
-    return IterateDir("/sys/bus/iio/devices", "iio:device", fn);
+std::string FindSysfsIIODir(const std::string& matchIIO)
+{
+    return TIIODeviceIndex().Find(matchIIO);
 }
 
 std::string FindBestScale(const std::vector<std::string>& scales, double desiredScale)
@@ -4,18 +4,71 @@
 
 #include <fstream>
 
-#include "moving_average.h"
+#include "ac_analyzer.h"
+#include "calibration.h"
+#include "file_utils.h"
+#include "filters.h"
+#include "sample_history.h"
+#include "sampling_clock.h"
+#include "shm_ring_writer.h"
+#include "spectrum.h"
+#include "statistics.h"
+#include "stop_event.h"
 
 #define ADC_DEFAULT_MAX_SCALED_VOLTAGE 3100 // voltage in mV
 #define MAX_ADC_VALUE                  4094 // Maximum value that can be read from ADC
 
+/**
+ * @brief Index of IIO devices. /sys/bus/iio/devices is scanned once on the first search with
+ * non-empty pattern, so channels of the same config don't repeat readdir and readlink calls.
+ */
+class TIIODeviceIndex
+{
+public:
+    /**
+     * @brief Construct a new TIIODeviceIndex object. The folder is not scanned here.
+     *
+     * @param devicesDir Folder with iio:deviceN symlinks
+     */
+    explicit TIIODeviceIndex(const std::string& devicesDir = "/sys/bus/iio/devices");
+
+    /**
+     * @brief Find folder symlinked to matchIIO value. Throws TNoDirError if devicesDir can't be
+     * scanned.
+     *
+     * @param matchIIO Fnmatch-compatible pattern of symlink target
+     * @return std::string Found folder or devicesDir + /iio:device0 if matchIIO is empty or empty
+     * string if nothing found. If the folder is already scanned, iio:device0 is returned only if
+     * it is present
+     */
+    std::string Find(const std::string& matchIIO);
+
+    /**
+     * @brief Scan the folder again. Missing folder is treated as a folder without devices.
+     *
+     * @return true The list of devices is changed since the previous scan
+     */
+    bool Rescan();
+
+    //! Number of found iio:deviceN entries, 0 if the folder is not scanned yet
+    size_t GetDeviceCount() const;
+
+private:
+    std::string DevicesDir;
+    bool        Scanned;
+
+    //! Symlink targets and folders in readdir order
+    std::vector<std::pair<std::string, std::string>> Devices;
+
+    void Scan();
+};
+
 /**
  * @brief Iterate over /sys/bus/iio/devices and find folder symlinked to matchIIO value. Throws
- * runtime_error on search failure.
+ * runtime_error on search failure. Use TIIODeviceIndex to find folders of several channels.
  *
  * @param matchIIO Symlink origin
- * @param sysFsFolder Sys fs folder. By default = /sys
- * @return std::string Found folder or sysFsPrefix + /bus/iio/devices/iio:device0 if matchIIO is
+ * @return std::string Found folder or /sys/bus/iio/devices/iio:device0 if matchIIO is
  * empty or empty string if nothing found
  */
 std::string FindSysfsIIODir(const std::string& matchIIO);
@@ -30,12 +83,34 @@ std::string FindSysfsIIODir(const std::string& matchIIO);
  */
 std::string FindBestScale(const std::vector<std::string>& scales, double desiredScale);
 
+//! Result of a channel measurement
+enum class TMeasureStatus
+{
+    //! A new value is converted
+    Ok,
+
+    //! Not enough readings for the filter yet, the previous value is kept
+    NotReady,
+
+    //! The measurement is interrupted by the stop event
+    Interrupted,
+
+    //! A reading from ADC failed
+    ReadError,
+
+    //! The value is bigger than the maximum or out of the conversion range
+    Overflow
+};
+
 /**
  * @brief The class is responsible for single ADC channel measurements.
  */
 class TChannelReader
 {
 public:
+    //! Clock of sample times, CLOCK_MONOTONIC
+    typedef TSamplingClock::TClock TClock;
+
     //! ADC channel measurement settings
     struct TSettings
     {
@@ -62,6 +137,29 @@ public:
 
         //! Number of figures after point
         uint32_t DecimalPlaces = 3;
+
+        //! Filter of readings, it uses AveragingWindow as window size
+        TFilterType Filter = TFilterType::Average;
+
+        //! Percent of readings dropped from each side of the window by trimmed mean filter
+        uint32_t TrimPercent = 25;
+
+        //! Number of fractional bits of filtered ADC value. Oversampling gives additional effective bits
+        uint32_t FractionalBits = 0;
+
+        //! Non-linear conversion of the value in V. If empty, the value in V is published
+        std::vector<TConversionStage> Conversion;
+
+        /*! Measure RMS, peak-to-peak, DC offset and frequency of AC signal instead of filtered value.
+            The value of the channel is RMS
+        */
+        bool AcMode = false;
+
+        //! Duration of AC measurement window in mS. It should include several periods of the signal
+        uint32_t AcWindowMs = 200;
+
+        //! Rate of readings through sysfs in AC mode in Hz. Buffered channels are sampled at the rate of IIO trigger
+        uint32_t AcSampleRate = 1000;
     };
 
     /**
@@ -74,6 +172,10 @@ public:
      * @param debugLogger Logger for debug messages
      * @param infoLogger Logger for info messages
      * @param sysfsIIODir Sysfs device's folder
+     * @param stopEvent Event to interrupt delays between measurements. If nullptr, delays are not
+     * interruptible
+     * @param scaleFiles Cache of scale files shared by readers of the same IIO device. If nullptr,
+     * the files are read by the reader
      */
     TChannelReader(double                           defaultIIOScale,
                    uint32_t                         maxADCvalue,
@@ -81,13 +183,102 @@ public:
                    uint32_t                         delayBetweenMeasurementsmS,
                    WBMQTT::TLogger&                 debugLogger,
                    WBMQTT::TLogger&                 infoLogger,
-                   const std::string&               sysfsIIODir);
+                   const std::string&               sysfsIIODir,
+                   const TStopEvent*                stopEvent  = nullptr,
+                   TFileContentsCache*              scaleFiles = nullptr);
+
+    //! Get last measured value. The reference is valid until the next measurement
+    const std::string& GetValue() const;
+
+    //! Get last measured value in V as a number
+    double GetNumericValue() const;
 
-    //! Get last measured value
-    std::string GetValue() const;
+    //! Time of the newest sample included in the last measured value
+    TClock::time_point GetMeasurementTime() const;
 
-    //! Read and convert value from ADC
-    void Measure(const std::string& debugMessagePrefix = std::string());
+    /**
+     * @brief Get last measured quantity of AC signal. Valid only in AC mode
+     *
+     * @return double Value in V or frequency in Hz
+     */
+    double GetAcValue(TAcQuantity quantity) const;
+
+    //! Get last measured quantity of AC signal formatted for publication. Valid only in AC mode
+    const std::string& GetAcText(TAcQuantity quantity) const;
+
+    /**
+     * @brief Read and convert value from ADC. If stop event is set, the method returns without conversion.
+     * Failures don't throw, GetLastError() describes them. Readings are taken on absolute deadlines
+     * spaced by the delay between measurements or, in AC mode, at AcSampleRate during the whole window.
+     */
+    TMeasureStatus Measure(const std::string& debugMessagePrefix = std::string());
+
+    /**
+     * @brief Add value read from ADC by other means (e.g. from IIO buffer) to the filter.
+     * ConvertValue must be called to get a new result. The sample is timestamped now.
+     */
+    void AddSample(int32_t adcMeasurement, const std::string& debugMessagePrefix = std::string());
+
+    /**
+     * @brief Add value with given time of reading to the filter. Channels captured in the same scan
+     * get the same timestamp in history and shared memory ring.
+     *
+     * @param timestampUs Time of reading in uS since the epoch for history and shared memory ring
+     * @param sampleTime Time of reading for AC and spectrum analysis and measurement time
+     */
+    void AddSample(int32_t            adcMeasurement,
+                   int64_t            timestampUs,
+                   TClock::time_point sampleTime,
+                   const std::string& debugMessagePrefix = std::string());
+
+    //! Convert filtered value to the resulting one. Returns Ok, NotReady or Overflow
+    TMeasureStatus ConvertValue(const std::string& debugMessagePrefix = std::string());
+
+    //! Description of the last ReadError or Overflow
+    const std::string& GetLastError() const;
+
+    //! IIO channel name of the reader ("voltageX")
+    const std::string& GetChannelNumber() const;
+
+    //! Sysfs device's folder of the reader
+    const std::string& GetSysfsIIODir() const;
+
+    //! Number of value readings during one selection
+    uint32_t GetReadingsNumber() const;
+
+    /**
+     * @brief Enable collection of read latency, sampling jitter, samples and error counters.
+     *
+     * @param statistics Counters to update. If nullptr, collection is disabled
+     */
+    void SetStatistics(std::shared_ptr<TReadStatistics> statistics);
+
+    //! Counters set by SetStatistics or nullptr
+    const std::shared_ptr<TReadStatistics>& GetStatistics() const;
+
+    /**
+     * @brief Enable keeping of raw samples with timestamps of their addition to the filter.
+     *
+     * @param history Storage for samples. If nullptr, samples are not kept
+     */
+    void SetHistory(std::shared_ptr<TSampleStore> history);
+
+    /**
+     * @brief Enable export of raw samples and their values in V to shared memory ring.
+     *
+     * @param writer Writer of the channel ring. If nullptr, samples are not exported
+     */
+    void SetSampleExport(std::shared_ptr<TShmRingWriter> writer);
+
+    /**
+     * @brief Pass raw samples to spectrum analysis thread. Sets input's raw value multiplier.
+     *
+     * @param input Samples of the channel for the analysis. If nullptr, samples are not passed
+     */
+    void SetSpectrumInput(std::shared_ptr<TSpectrumInput> input);
+
+    //! Multiplier to convert raw ADC value to the resulting value in V
+    double GetRawValueMultiplier() const;
 
 private:
     //! Settings for the channel
@@ -96,9 +287,18 @@ private:
     //! Last measured voltage in V
     std::string MeasuredV;
 
+    //! Last measured voltage in V as a number
+    double MeasuredValue;
+
+    //! Description of the last failed measurement
+    std::string LastError;
+
     //! Folder in sysfs corresponding to the channel
     std::string SysfsIIODir;
 
+    //! Opened in_voltageX_raw file of the channel
+    TSysfsAttribute RawFile;
+
     /*! Selected scale for the channel.
 
         The closest value from one of files
@@ -120,11 +320,50 @@ private:
     //! Delay between measurements in mS
     uint32_t DelayBetweenMeasurementsmS;
 
-    TMovingAverageCalculator AverageCounter;
-    WBMQTT::TLogger&         DebugLogger;
+    //! Deadlines of readings through sysfs
+    TSamplingClock Clock;
+
+    //! Time of the newest sample added to the filter
+    TClock::time_point LastSampleTime;
+
+    //! Time of the newest sample of the last measured value
+    TClock::time_point MeasurementTime;
+
+    //! Event to interrupt delays
+    const TStopEvent* StopEvent;
+
+    //! Counters for diagnostics, nullptr if collection is disabled
+    std::shared_ptr<TReadStatistics> Statistics;
+
+    //! Raw samples history, nullptr if it is disabled
+    std::shared_ptr<TSampleStore> History;
+
+    //! Shared memory ring for local consumers, nullptr if it is disabled
+    std::shared_ptr<TShmRingWriter> SampleExport;
+
+    //! Samples for spectrum analysis, nullptr if it is disabled
+    std::shared_ptr<TSpectrumInput> SpectrumInput;
+
+    //! Compiled Cfg.Conversion, nullptr if it is empty
+    std::unique_ptr<TConversionTable> Conversion;
+
+    std::unique_ptr<TValueFilter> Filter;
+    WBMQTT::TLogger&              DebugLogger;
+
+    //! Analyzer of AC signal, nullptr if AC mode is disabled
+    std::unique_ptr<TAcAnalyzer> AcAnalyzer;
+
+    //! AC window is complete, but its result isn't converted yet
+    bool AcResultReady;
+
+    double      AcValues[AC_QUANTITY_COUNT];
+    std::string AcTexts[AC_QUANTITY_COUNT];
+
+    TMeasureStatus MeasureAc(const std::string& debugMessagePrefix);
+    TMeasureStatus ConvertAcValue(const std::string& debugMessagePrefix);
 
-    int32_t ReadFromADC();
-    void    SelectScale(WBMQTT::TLogger& infoLogger);
+    bool    ReadFromADC(int32_t& value);
+    void    SelectScale(WBMQTT::TLogger& infoLogger, TFileContentsCache& scaleFiles);
 
     TChannelReader();
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Base class for filters of values read from ADC. A filter accumulates values and
+ * calculates a result from a window of the last ones.
+ */
+class TValueFilter
+{
+public:
+    virtual ~TValueFilter() = default;
+
+    /**
+     * @brief Add new value to data set.
+     */
+    virtual void AddValue(int32_t value) = 0;
+
+    /**
+     * @brief Get filtered value. The value is valid only if IsReady() == true.
+     */
+    virtual int32_t GetValue() const = 0;
+
+    /**
+     * @brief Get filtered value in fixed-point format with given number of fractional bits.
+     * Filters which calculate the value with better resolution than input values override the method,
+     * so oversampling gives additional effective bits. The value is valid only if IsReady() == true.
+     *
+     * @param fractionalBits Number of fractional bits, must be less than 32
+     */
+    virtual int64_t GetFixedPointValue(uint32_t fractionalBits) const
+    {
+        return static_cast<int64_t>(GetValue()) * (static_cast<int64_t>(1) << fractionalBits);
+    }
+
+    /**
+     * @brief Check if filtered value is valid.
+     *
+     * @return true Filtered value is valid
+     * @return false Filtered value is not valid
+     */
+    virtual bool IsReady() const = 0;
+};
@@ -0,0 +1,101 @@
+#include "value_format.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    //! Integer arithmetic is used while scaled value is exactly representable by double
+    const double MAX_FAST_SCALED_VALUE = 9007199254740992.0; // 2^53
+
+    //! 10^15 * 2^53 doesn't fit into uint64_t, so more decimal places are formatted by snprintf
+    const uint32_t MAX_FAST_DECIMAL_PLACES = 15;
+
+    //! Scaling by 10^decimalPlaces adds relative error about 2^-52
+    const double RELATIVE_SCALING_ERROR = 1e-15;
+
+    const uint64_t POWERS_OF_10[] = {1ull,
+                                     10ull,
+                                     100ull,
+                                     1000ull,
+                                     10000ull,
+                                     100000ull,
+                                     1000000ull,
+                                     10000000ull,
+                                     100000000ull,
+                                     1000000000ull,
+                                     10000000000ull,
+                                     100000000000ull,
+                                     1000000000000ull,
+                                     10000000000000ull,
+                                     100000000000000ull,
+                                     1000000000000000ull};
+
+    size_t FormatWithSnprintf(double value, uint32_t decimalPlaces, char* buf, size_t size)
+    {
+        int res = snprintf(buf, size, "%.*f", static_cast<int>(decimalPlaces), value);
+        return (res < 0) ? 0 : res;
+    }
+} // namespace
+
+size_t FormatDecimal(double value, uint32_t decimalPlaces, char* buf, size_t size)
+{
+    if (decimalPlaces > MAX_FAST_DECIMAL_PLACES || !isfinite(value)) {
+        return FormatWithSnprintf(value, decimalPlaces, buf, size);
+    }
+
+    uint64_t scale  = POWERS_OF_10[decimalPlaces];
+    double   scaled = fabs(value) * scale;
+    if (scaled >= MAX_FAST_SCALED_VALUE) {
+        return FormatWithSnprintf(value, decimalPlaces, buf, size);
+    }
+
+    // snprintf rounds exact binary value, scaled value can differ from it a bit,
+    // so values close to a half are delegated to snprintf
+    double integerPart = floor(scaled);
+    double fraction    = scaled - integerPart;
+    if (fabs(fraction - 0.5) <= scaled * RELATIVE_SCALING_ERROR) {
+        return FormatWithSnprintf(value, decimalPlaces, buf, size);
+    }
+    uint64_t digits = static_cast<uint64_t>(integerPart) + (fraction > 0.5 ? 1 : 0);
+
+    // digits are written from the end of temporary buffer
+    char  tmp[32];
+    char* p = tmp + sizeof(tmp);
+    for (uint32_t i = 0; i < decimalPlaces; ++i) {
+        *--p = '0' + digits % 10;
+        digits /= 10;
+    }
+    if (decimalPlaces) {
+        *--p = '.';
+    }
+    do {
+        *--p = '0' + digits % 10;
+        digits /= 10;
+    } while (digits);
+    // snprintf keeps the sign of negative values rounded to zero
+    if (signbit(value)) {
+        *--p = '-';
+    }
+
+    size_t len = tmp + sizeof(tmp) - p;
+    if (size) {
+        size_t n = (len < size) ? len : size - 1;
+        memcpy(buf, p, n);
+        buf[n] = '\0';
+    }
+    return len;
+}
+
+void FormatDecimal(double value, uint32_t decimalPlaces, std::string& res)
+{
+    char   buf[64];
+    size_t len = FormatDecimal(value, decimalPlaces, buf, sizeof(buf));
+    if (len < sizeof(buf)) {
+        res.assign(buf, len);
+    } else {
+        res.resize(len);
+        FormatDecimal(value, decimalPlaces, &res[0], len + 1);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief Format value with fixed number of digits after point. The result is the same as
+ * std::ostringstream with std::fixed and std::setprecision(decimalPlaces) gives, but the function
+ * doesn't allocate memory. Most values are converted by integer arithmetic, snprintf is used only
+ * if rounding can't be done exactly that way.
+ *
+ * @param value Value to format
+ * @param decimalPlaces Number of digits after point
+ * @param buf Buffer for the result, it is always null terminated
+ * @param size Size of the buffer
+ * @return Length of the result without terminating null. If the result doesn't fit into the buffer,
+ * it is truncated and the length of the full result is returned like snprintf does
+ */
+size_t FormatDecimal(double value, uint32_t decimalPlaces, char* buf, size_t size);
+
+/**
+ * @brief Format value into the string like FormatDecimal does. The string keeps its capacity, so
+ * repeated formatting into the same string doesn't allocate memory.
+ */
+void FormatDecimal(double value, uint32_t decimalPlaces, std::string& res);
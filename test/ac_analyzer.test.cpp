@@ -0,0 +1,129 @@
+#include "src/ac_analyzer.h"
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+namespace
+{
+    //! Synthetic ADC signal: DC offset, fundamental, 3rd harmonic and deterministic noise, quantized to codes
+    class TSignalGenerator
+    {
+    public:
+        double Dc        = 2048;
+        double Amplitude = 1000;
+        double Frequency = 50;
+        double Phase     = 0.3;
+
+        //! Amplitude of 3rd harmonic relative to the fundamental
+        double Harmonic = 0;
+
+        //! Peak amplitude of noise in codes
+        double Noise = 0;
+
+        double Get(int64_t timestampUs)
+        {
+            double t = timestampUs * 1e-6;
+            double w = 2 * M_PI * Frequency * t + Phase;
+            Seed     = Seed * 1103515245 + 12345;
+            double n = Noise * (((Seed >> 16) & 0x7fff) / 16384.0 - 1);
+            return round(Dc + Amplitude * (sin(w) + Harmonic * sin(3 * w)) + n);
+        }
+
+        //! RMS of AC component without noise and quantization
+        double GetRms() const
+        {
+            return Amplitude * sqrt((1 + Harmonic * Harmonic) / 2);
+        }
+
+    private:
+        uint32_t Seed = 1;
+    };
+
+    /**
+     * @brief Feed samples with the period until the second window is complete (the first one has no result)
+     *
+     * @param jitterUs Peak deviation of sampling times from the nominal ones
+     */
+    TAcResult Measure(TAcAnalyzer& analyzer, TSignalGenerator& signal, int64_t periodUs, int64_t jitterUs = 0)
+    {
+        int64_t t = 1000000;
+        for (int i = 0;; ++i) {
+            int64_t ts = t + i * periodUs + ((i * 7919) % (2 * jitterUs + 1)) - jitterUs;
+            if (analyzer.Add(ts, signal.Get(ts))) {
+                return analyzer.GetResult();
+            }
+        }
+    }
+}
+
+TEST(TAcAnalyzerTest, sine)
+{
+    // 50 Hz at 1 kHz sampling, 200 ms window
+    TAcAnalyzer      analyzer(200000);
+    TSignalGenerator signal;
+    auto             res = Measure(analyzer, signal, 1000);
+
+    ASSERT_NEAR(res.Rms, signal.GetRms(), signal.GetRms() * 0.005);
+    ASSERT_NEAR(res.Dc, signal.Dc, 1);
+    ASSERT_NEAR(res.PeakToPeak, 2 * signal.Amplitude, 2 * signal.Amplitude * 0.01);
+    ASSERT_NEAR(res.Frequency, 50, 0.05);
+    ASSERT_GE(res.Periods, 9);
+}
+
+TEST(TAcAnalyzerTest, window_is_not_whole_number_of_periods)
+{
+    // 53.7 Hz, so RMS over the whole window would depend on phase
+    TAcAnalyzer      analyzer(200000);
+    TSignalGenerator signal;
+    signal.Frequency = 53.7;
+    for (double phase : {0.0, 1.0, 2.0, 3.0}) {
+        signal.Phase = phase;
+        auto res     = Measure(analyzer, signal, 1000);
+        ASSERT_NEAR(res.Rms, signal.GetRms(), signal.GetRms() * 0.005);
+        ASSERT_NEAR(res.Frequency, 53.7, 0.05);
+    }
+}
+
+TEST(TAcAnalyzerTest, distorted_noisy_signal)
+{
+    TAcAnalyzer      analyzer(500000);
+    TSignalGenerator signal;
+    signal.Frequency = 60;
+    signal.Harmonic  = 0.2;
+    signal.Noise     = 20;
+    signal.Dc        = 1500;
+    auto res         = Measure(analyzer, signal, 250, 20);
+
+    ASSERT_NEAR(res.Rms, signal.GetRms(), signal.GetRms() * 0.01);
+    ASSERT_NEAR(res.Dc, signal.Dc, 2);
+    ASSERT_NEAR(res.Frequency, 60, 0.1);
+}
+
+TEST(TAcAnalyzerTest, dc_signal)
+{
+    TAcAnalyzer      analyzer(100000);
+    TSignalGenerator signal;
+    signal.Amplitude = 0;
+    auto res         = Measure(analyzer, signal, 1000);
+
+    ASSERT_EQ(res.Rms, 0);
+    ASSERT_EQ(res.PeakToPeak, 0);
+    ASSERT_EQ(res.Dc, signal.Dc);
+    ASSERT_EQ(res.Frequency, 0);
+    ASSERT_EQ(res.Periods, 0);
+}
+
+TEST(TAcAnalyzerTest, first_window)
+{
+    TAcAnalyzer analyzer(10000);
+    for (int64_t t = 0; t < 10000; t += 1000) {
+        ASSERT_FALSE(analyzer.Add(t, 0));
+    }
+    // the first window only measures DC level
+    ASSERT_FALSE(analyzer.Add(10000, 0));
+    ASSERT_FALSE(analyzer.Add(11000, 0));
+    for (int64_t t = 12000; t < 21000; t += 1000) {
+        ASSERT_FALSE(analyzer.Add(t, 0));
+    }
+    ASSERT_TRUE(analyzer.Add(21000, 0));
+}
@@ -0,0 +1,170 @@
+#include "src/calibration.h"
+#include "src/sysfs_adc.h"
+#include <functional>
+#include <gtest/gtest.h>
+#include <math.h>
+
+namespace
+{
+    const uint32_t MAX_CODE = MAX_ADC_VALUE;
+
+    //! 3.3 V reference of a 12-bit ADC
+    const double CODE_TO_VOLTS = 3.3 / 4096;
+
+    TConversionStage MakeNtcStage()
+    {
+        TConversionStage stage;
+        stage.Type             = TConversionType::SteinhartHart;
+        stage.A                = 1.009249522e-3;
+        stage.B                = 2.378405444e-4;
+        stage.C                = 2.019202697e-7;
+        stage.SupplyVoltage    = 3.3;
+        stage.SeriesResistance = 10000;
+        return stage;
+    }
+
+    double NtcTemperature(double v, bool ntcToGround)
+    {
+        double r    = ntcToGround ? 10000 * v / (3.3 - v) : 10000 * (3.3 - v) / v;
+        double lnR  = log(r);
+        double invT = 1.009249522e-3 + 2.378405444e-4 * lnR + 2.019202697e-7 * pow(lnR, 3);
+        return 1 / invT - 273.15;
+    }
+
+    void CompareWithFormula(const TConversionTable& table, const std::function<double(double)>& formula)
+    {
+        ASSERT_EQ(table.GetSize(), MAX_CODE + 1);
+        for (uint32_t code = 0; code <= MAX_CODE; ++code) {
+            double expected = formula(code * CODE_TO_VOLTS);
+            double res;
+            if (std::isfinite(expected)) {
+                ASSERT_TRUE(table.Convert(code, 0, res)) << code;
+                ASSERT_NEAR(res, expected, 1e-9 * std::max(1.0, fabs(expected))) << code;
+            } else {
+                ASSERT_FALSE(table.Convert(code, 0, res)) << code;
+            }
+        }
+    }
+} // namespace
+
+TEST(TCalibrationTest, parse_type)
+{
+    ASSERT_TRUE(ParseConversionType("table") == TConversionType::Table);
+    ASSERT_TRUE(ParseConversionType("polynomial") == TConversionType::Polynomial);
+    ASSERT_TRUE(ParseConversionType("steinhart_hart") == TConversionType::SteinhartHart);
+    ASSERT_THROW(ParseConversionType("beta"), std::runtime_error);
+}
+
+TEST(TCalibrationTest, check_stage)
+{
+    TConversionStage stage;
+    stage.Type = TConversionType::Table;
+    stage.Points = {{0, 0}};
+    ASSERT_THROW(CheckConversionStage(stage), std::runtime_error);
+    stage.Points = {{0, 0}, {0, 1}};
+    ASSERT_THROW(CheckConversionStage(stage), std::runtime_error);
+    stage.Points = {{0, 0}, {1, 1}};
+    ASSERT_NO_THROW(CheckConversionStage(stage));
+
+    stage.Type = TConversionType::Polynomial;
+    ASSERT_THROW(CheckConversionStage(stage), std::runtime_error);
+
+    stage = MakeNtcStage();
+    ASSERT_NO_THROW(CheckConversionStage(stage));
+    stage.SeriesResistance = 0;
+    ASSERT_THROW(CheckConversionStage(stage), std::runtime_error);
+}
+
+TEST(TCalibrationTest, table)
+{
+    // 4-20 mA loop on 100 Ohm shunt, 0-10 bar transducer
+    TConversionStage stage;
+    stage.Type   = TConversionType::Table;
+    stage.Points = {{0.4, 0}, {1.2, 5.5}, {2.0, 10}};
+
+    TConversionTable table({stage}, MAX_CODE, CODE_TO_VOLTS);
+    CompareWithFormula(table, [](double v) {
+        if (v <= 0.4) {
+            return 0.0;
+        }
+        if (v <= 1.2) {
+            return (v - 0.4) * 5.5 / 0.8;
+        }
+        if (v <= 2.0) {
+            return 5.5 + (v - 1.2) * 4.5 / 0.8;
+        }
+        return 10.0;
+    });
+}
+
+TEST(TCalibrationTest, polynomial)
+{
+    TConversionStage stage;
+    stage.Type         = TConversionType::Polynomial;
+    stage.Coefficients = {-1.5, 2, 0.25, -0.125};
+
+    TConversionTable table({stage}, MAX_CODE, CODE_TO_VOLTS);
+    CompareWithFormula(table, [](double v) { return -1.5 + 2 * v + 0.25 * v * v - 0.125 * v * v * v; });
+}
+
+TEST(TCalibrationTest, steinhart_hart)
+{
+    auto stage = MakeNtcStage();
+    TConversionTable table({stage}, MAX_CODE, CODE_TO_VOLTS);
+    CompareWithFormula(table, [](double v) { return (v <= 0 || v >= 3.3) ? NAN : NtcTemperature(v, true); });
+
+    // 10 kOhm thermistor at about 25 C gives half of the supply
+    ASSERT_NEAR(ApplyConversion(stage, 1.65), 25, 0.5);
+
+    stage.NtcToGround = false;
+    TConversionTable highSideTable({stage}, MAX_CODE, CODE_TO_VOLTS);
+    CompareWithFormula(highSideTable, [](double v) { return (v <= 0 || v >= 3.3) ? NAN : NtcTemperature(v, false); });
+}
+
+TEST(TCalibrationTest, stages_chain)
+{
+    // NTC temperature in Fahrenheit
+    TConversionStage fahrenheit;
+    fahrenheit.Type         = TConversionType::Polynomial;
+    fahrenheit.Coefficients = {32, 1.8};
+
+    TConversionTable table({MakeNtcStage(), fahrenheit}, MAX_CODE, CODE_TO_VOLTS);
+    CompareWithFormula(table, [](double v) { return (v <= 0 || v >= 3.3) ? NAN : NtcTemperature(v, true) * 1.8 + 32; });
+}
+
+TEST(TCalibrationTest, fractional_codes)
+{
+    TConversionStage stage;
+    stage.Type         = TConversionType::Polynomial;
+    stage.Coefficients = {0, 0, 1};
+    TConversionTable table({stage}, MAX_CODE, 1);
+
+    // 100.25 is interpolated between 100^2 and 101^2
+    double res;
+    ASSERT_TRUE(table.Convert(401, 2, res));
+    ASSERT_DOUBLE_EQ(res, 10000 + 201 * 0.25);
+    ASSERT_TRUE(table.Convert(static_cast<int64_t>(MAX_CODE) << 4, 4, res));
+    ASSERT_DOUBLE_EQ(res, static_cast<double>(MAX_CODE) * MAX_CODE);
+
+    // codes out of the table
+    ASSERT_FALSE(table.Convert(-1, 0, res));
+    ASSERT_FALSE(table.Convert(MAX_CODE + 1, 0, res));
+    ASSERT_FALSE(table.Convert((static_cast<int64_t>(MAX_CODE) << 4) + 1, 4, res));
+}
+
+TEST(TCalibrationTest, channel_reader)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage1", 1, 10000, 0, 1, 1, 2};
+    channelCfg.Conversion.push_back(MakeNtcStage());
+
+    // no scale files, so 3.3 V / 4096 default scale is used
+    TChannelReader reader(3300.0 / 4096, MAX_ADC_VALUE, channelCfg, 0, logger, logger, "/nonexistent");
+    reader.AddSample(2048);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::Ok);
+    ASSERT_EQ(reader.GetValue(), "24.68");
+
+    // open thermistor
+    reader.AddSample(0);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::Overflow);
+}
@@ -0,0 +1,80 @@
+#include "src/circuit_breaker.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono;
+
+class TCircuitBreakerTest : public testing::Test
+{
+protected:
+    TCircuitBreaker::TClock::time_point Start = TCircuitBreaker::TClock::now();
+
+    TCircuitBreaker::TClock::time_point At(int ms) const
+    {
+        return Start + milliseconds(ms);
+    }
+
+    static TCircuitBreaker::TSettings GetSettings()
+    {
+        TCircuitBreaker::TSettings s;
+        s.FailureThreshold = 3;
+        s.InitialBackoff   = milliseconds(100);
+        s.MaxBackoff       = milliseconds(300);
+        return s;
+    }
+};
+
+TEST_F(TCircuitBreakerTest, threshold)
+{
+    TCircuitBreaker breaker(GetSettings());
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_TRUE(breaker.AllowRequest(At(i)));
+        breaker.RecordFailure(At(i));
+        ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::Closed);
+    }
+
+    // a success resets the series
+    breaker.RecordSuccess();
+    ASSERT_EQ(breaker.GetFailureCount(), 0);
+    breaker.RecordFailure(At(2));
+    breaker.RecordFailure(At(3));
+    ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::Closed);
+    breaker.RecordFailure(At(4));
+    ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::Open);
+    ASSERT_EQ(breaker.GetBackoff(), milliseconds(100));
+    ASSERT_EQ(breaker.GetRetryTime(), At(104));
+    ASSERT_FALSE(breaker.AllowRequest(At(103)));
+}
+
+TEST_F(TCircuitBreakerTest, backoff)
+{
+    TCircuitBreaker breaker(GetSettings());
+    for (int i = 0; i < 3; ++i) {
+        breaker.RecordFailure(At(0));
+    }
+
+    // failed probes double the backoff up to the maximum
+    int now = 0;
+    for (auto backoff : {200, 300, 300}) {
+        now += breaker.GetBackoff().count();
+        ASSERT_TRUE(breaker.AllowRequest(At(now)));
+        ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::HalfOpen);
+        breaker.RecordFailure(At(now));
+        ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::Open);
+        ASSERT_EQ(breaker.GetBackoff(), milliseconds(backoff));
+    }
+
+    // a successful probe closes the breaker
+    now += breaker.GetBackoff().count();
+    ASSERT_TRUE(breaker.AllowRequest(At(now)));
+    breaker.RecordSuccess();
+    ASSERT_EQ(breaker.GetState(), TCircuitBreaker::TState::Closed);
+    ASSERT_EQ(breaker.GetBackoff(), milliseconds(0));
+    ASSERT_TRUE(breaker.AllowRequest(At(now)));
+}
+
+TEST_F(TCircuitBreakerTest, state_names)
+{
+    ASSERT_STREQ(GetStateName(TCircuitBreaker::TState::Closed), "closed");
+    ASSERT_STREQ(GetStateName(TCircuitBreaker::TState::Open), "open");
+    ASSERT_STREQ(GetStateName(TCircuitBreaker::TState::HalfOpen), "half-open");
+}
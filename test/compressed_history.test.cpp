@@ -0,0 +1,101 @@
+#include "src/compressed_history.h"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+
+namespace
+{
+    void ExpectEqual(const std::vector<TSampleStore::TSample>& a, const std::vector<TSampleStore::TSample>& b)
+    {
+        ASSERT_EQ(a.size(), b.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            ASSERT_EQ(a[i].TimestampUs, b[i].TimestampUs) << i;
+            ASSERT_EQ(a[i].Value, b[i].Value) << i;
+        }
+    }
+} // namespace
+
+TEST(TCompressedSampleStoreTest, round_trip)
+{
+    // all field widths: equal values and intervals, small, medium and big differences
+    std::mt19937                           gen(4);
+    std::uniform_int_distribution<int64_t> bits(0, 40);
+    std::vector<TSampleStore::TSample>     samples;
+    int64_t                                ts = 1600000000000000;
+    TCompressedSampleStore                 store(1024 * 1024);
+    for (size_t i = 0; i < 5000; ++i) {
+        ts += 10000 + (i % 3 ? 0 : (gen() % (1ll << bits(gen))));
+        int32_t value = (i % 4) ? 0 : static_cast<int32_t>(gen());
+        if (i % 5 == 0) {
+            value = i % 4096;
+        }
+        samples.push_back({ts, value});
+        store.Add(ts, value);
+    }
+    ASSERT_EQ(store.GetSampleCount(), samples.size());
+    ExpectEqual(store.Get(INT64_MIN, INT64_MAX, SIZE_MAX), samples);
+
+    // range and count limits
+    auto res = store.Get(samples[100].TimestampUs, samples[199].TimestampUs, SIZE_MAX);
+    ExpectEqual(res, std::vector<TSampleStore::TSample>(samples.begin() + 100, samples.begin() + 200));
+    bool truncated = false;
+    res            = store.Get(samples[100].TimestampUs, INT64_MAX, 10, &truncated);
+    ExpectEqual(res, std::vector<TSampleStore::TSample>(samples.begin() + 100, samples.begin() + 110));
+    ASSERT_TRUE(truncated);
+    res = store.Get(samples[100].TimestampUs, samples[109].TimestampUs, 10, &truncated);
+    ASSERT_EQ(res.size(), 10);
+    ASSERT_FALSE(truncated);
+}
+
+TEST(TCompressedSampleStoreTest, regular_sampling)
+{
+    // regular sampling of a slow signal takes about 1 byte per sample
+    TCompressedSampleStore store(1024 * 1024);
+    for (int i = 0; i < 100000; ++i) {
+        store.Add(1000000 + i * 10000, 2000 + (i / 100) % 5);
+    }
+    ASSERT_EQ(store.GetSampleCount(), 100000);
+    ASSERT_LT(store.GetUsedBytes(), 100000 / 2);
+}
+
+TEST(TCompressedSampleStoreTest, block_reuse)
+{
+    // the smallest store has 2 blocks, the oldest one is dropped when both are full
+    TCompressedSampleStore store(0);
+    int64_t                n = 0;
+    while (store.GetUsedBytes() < TCompressedSampleStore::GetBlockSize() * 3 / 2) {
+        store.Add(n, static_cast<int32_t>(n * 1000003));
+        ++n;
+    }
+    uint64_t countBefore = store.GetSampleCount();
+    while (store.GetSampleCount() >= countBefore) {
+        store.Add(n, static_cast<int32_t>(n * 1000003));
+        ++n;
+    }
+    auto res = store.Get(INT64_MIN, INT64_MAX, SIZE_MAX);
+    ASSERT_EQ(res.size(), store.GetSampleCount());
+    ASSERT_GT(res.front().TimestampUs, 0);
+    ASSERT_EQ(res.back().TimestampUs, n - 1);
+    for (size_t i = 1; i < res.size(); ++i) {
+        ASSERT_EQ(res[i].TimestampUs, res[i - 1].TimestampUs + 1);
+        ASSERT_EQ(res[i].Value, static_cast<int32_t>(res[i].TimestampUs * 1000003));
+    }
+}
+
+TEST(TCompressedSampleStoreTest, concurrent_read)
+{
+    TCompressedSampleStore store(0);
+    std::thread            writer([&] {
+        for (int32_t i = 1; i <= 20000; ++i) {
+            store.Add(i, i);
+        }
+    });
+    for (size_t n = 0; n < 50; ++n) {
+        auto res = store.Get(INT64_MIN, INT64_MAX, SIZE_MAX);
+        for (size_t i = 0; i < res.size(); ++i) {
+            ASSERT_EQ(res[i].TimestampUs, res[i].Value);
+        }
+    }
+    writer.join();
+}
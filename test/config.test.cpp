@@ -56,6 +56,21 @@ TEST_F(TConfigTest, optional_config)
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.VoltageMultiplier, 17);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.DesiredScale, 5);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.MaxScaledVoltage, 12500);
+    ASSERT_EQ(cfg.Channels[0].UseIIOBuffer, true);
+    ASSERT_TRUE(cfg.Channels[0].ReaderCfg.AcMode);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.AcWindowMs, 500);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.AcSampleRate, 1000);
+    ASSERT_EQ(cfg.Channels[0].Spectrum.FftSize, 256);
+    ASSERT_EQ(cfg.Channels[0].Spectrum.PublishIntervalMs, 1000);
+    ASSERT_EQ(cfg.Channels[0].Spectrum.SampleRate, 1000);
+    ASSERT_EQ(cfg.Channels[0].Spectrum.Bands.size(), 1);
+    ASSERT_EQ(cfg.Channels[0].Spectrum.Bands[0].Id, "mains");
+    ASSERT_EQ(cfg.Channels[0].Spectrum.Bands[0].MaxHz, 55);
+    ASSERT_TRUE(cfg.Channels[0].PublishTimestamp);
+    ASSERT_EQ(cfg.IIOBufferLength, 128);
+    ASSERT_EQ(cfg.PublisherCfg.QueueSize, 16);
+    ASSERT_EQ(cfg.PublisherCfg.BlockOnOverflow, true);
+    ASSERT_EQ(cfg.StatsIntervalMs, 5000);
 }
 
 TEST_F(TConfigTest, empty_main_config)
@@ -72,6 +87,18 @@ TEST_F(TConfigTest, empty_main_config)
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.ReadingsNumber, 3);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.VoltageMultiplier, 17);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.DesiredScale, 5);
+    ASSERT_EQ(cfg.Channels[0].UseIIOBuffer, false);
+    ASSERT_EQ(cfg.Channels[0].PollIntervalMs, 0);
+    ASSERT_TRUE(cfg.Channels[0].ReaderCfg.Filter == TFilterType::Average);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.TrimPercent, 25);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.FractionalBits, 0);
+    ASSERT_EQ(cfg.IIOBufferLength, 64);
+    ASSERT_EQ(cfg.PublisherCfg.QueueSize, 64);
+    ASSERT_EQ(cfg.PublisherCfg.BlockOnOverflow, false);
+    ASSERT_EQ(cfg.StatsIntervalMs, 0);
+    ASSERT_EQ(cfg.Channels[0].HistorySizeKb, 0);
+    ASSERT_EQ(cfg.Channels[0].CompressHistory, false);
+    ASSERT_EQ(cfg.HistoryMemoryLimitKb, 1024);
 }
 
 TEST_F(TConfigTest, full_main_config)
@@ -91,4 +118,149 @@ TEST_F(TConfigTest, full_main_config)
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.ReadingsNumber, 30);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.VoltageMultiplier, 170);
     ASSERT_EQ(cfg.Channels[0].ReaderCfg.DesiredScale, 50);
+    ASSERT_EQ(cfg.Channels[0].PollIntervalMs, 20);
+    ASSERT_EQ(cfg.Channels[0].PublishCfg.Deadband, 0.1);
+    ASSERT_EQ(cfg.Channels[0].PublishCfg.DeadbandPercent, 2);
+    ASSERT_EQ(cfg.Channels[0].PublishCfg.MinPublishIntervalMs, 100);
+    ASSERT_EQ(cfg.Channels[0].PublishCfg.MaxPublishIntervalMs, 60000);
+    ASSERT_TRUE(cfg.Channels[0].ReaderCfg.Filter == TFilterType::TrimmedMean);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.TrimPercent, 10);
+    ASSERT_EQ(cfg.Channels[0].ReaderCfg.FractionalBits, 8);
+    ASSERT_EQ(cfg.Channels[0].HistorySizeKb, 256);
+    ASSERT_EQ(cfg.Channels[0].CompressHistory, true);
+    ASSERT_EQ(cfg.HistoryMemoryLimitKb, 512);
+
+    const auto& conversion = cfg.Channels[0].ReaderCfg.Conversion;
+    ASSERT_EQ(conversion.size(), 3);
+    ASSERT_TRUE(conversion[0].Type == TConversionType::Table);
+    ASSERT_EQ(conversion[0].Points.size(), 2);
+    ASSERT_EQ(conversion[0].Points[1].first, 2.0);
+    ASSERT_EQ(conversion[0].Points[1].second, 10);
+    ASSERT_TRUE(conversion[1].Type == TConversionType::Polynomial);
+    ASSERT_EQ(conversion[1].Coefficients, std::vector<double>({1, 0.5}));
+    ASSERT_TRUE(conversion[2].Type == TConversionType::SteinhartHart);
+    ASSERT_EQ(conversion[2].C, 2e-7);
+    ASSERT_EQ(conversion[2].SupplyVoltage, 3.3);
+    ASSERT_EQ(conversion[2].SeriesResistance, 4700);
+    ASSERT_FALSE(conversion[2].NtcToGround);
+
+    ASSERT_EQ(cfg.Channels[0].SampleGroup, "power");
+    ASSERT_TRUE(cfg.Channels[0].UseIIOBuffer);
+    const auto* group = cfg.FindSampleGroup("power");
+    ASSERT_NE(group, nullptr);
+    ASSERT_TRUE(group->Trigger.Type == TIIOTriggerType::HrTimer);
+    ASSERT_EQ(group->Trigger.Name, "adc_timer");
+    ASSERT_EQ(group->Trigger.SamplingFrequency, 1000);
+    ASSERT_EQ(cfg.FindSampleGroup("other"), nullptr);
+
+    ASSERT_EQ(cfg.VirtualChannels.size(), 1);
+    const auto& virtualChannel = cfg.VirtualChannels[0];
+    ASSERT_EQ(virtualChannel.Id, "Vin_mV");
+    ASSERT_EQ(virtualChannel.Expression->GetVariables(), std::vector<std::string>({"Vin"}));
+    ASSERT_EQ(virtualChannel.Type, "voltage");
+    ASSERT_EQ(virtualChannel.DecimalPlaces, 0);
+    ASSERT_EQ(virtualChannel.PublishCfg.Deadband, 5);
+}
+
+TEST_F(TConfigTest, bad_virtual_channel)
+{
+    // unknown source, syntax error, id of ADC channel
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/virtual_channel1.conf", "", schemaFile), TBadConfigError);
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/virtual_channel2.conf", "", schemaFile), TBadConfigError);
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/virtual_channel3.conf", "", schemaFile), TBadConfigError);
+}
+
+TEST_F(TConfigTest, unknown_sample_group)
+{
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/sample_group.conf", "", schemaFile), TBadConfigError);
+}
+
+TEST_F(TConfigTest, ac_channel_with_conversion)
+{
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/ac_channel.conf", "", schemaFile), TBadConfigError);
+}
+
+TEST_F(TConfigTest, duplicate_spectrum_band)
+{
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/spectrum.conf", "", schemaFile), TBadConfigError);
+}
+
+TEST_F(TConfigTest, history_memory_limit)
+{
+    ASSERT_THROW(LoadConfig("", testRootDir + "/bad/history_limit.conf", "", schemaFile), TBadConfigError);
+}
+
+TEST_F(TConfigTest, diff)
+{
+    TConfig running = LoadConfig(testRootDir + "/good1/wb-mqtt-adc.conf", "", testRootDir + "/good1/wb-mqtt-adc.conf.d", schemaFile);
+    ASSERT_EQ(running.Channels.size(), 1);
+    running.Channels.resize(3, running.Channels[0]);
+    running.Channels[1].Id = "A2";
+    running.Channels[2].Id = "A3";
+
+    TConfig reloaded = running;
+    ASSERT_TRUE(DiffConfigs(running, reloaded).IsEmpty());
+    ASSERT_FALSE(DiffConfigs(running, reloaded).RestartRequired);
+
+    reloaded.Channels[0].ReaderCfg.AveragingWindow += 1;
+    reloaded.Channels[1].PublishCfg.Deadband += 0.5;
+    reloaded.Channels.back().Id = "new";
+    reloaded.DeviceName         = "Other";
+    reloaded.EnableDebugMessages = !running.EnableDebugMessages;
+
+    auto diff = DiffConfigs(running, reloaded);
+    ASSERT_EQ(diff.Changed, std::vector<std::string>({running.Channels[0].Id, running.Channels[1].Id}));
+    ASSERT_EQ(diff.Added, std::vector<std::string>({"new"}));
+    ASSERT_EQ(diff.Removed, std::vector<std::string>({running.Channels.back().Id}));
+    ASSERT_TRUE(diff.RestartRequired);
+    ASSERT_FALSE(diff.IsEmpty());
+
+    // buffered channels are recreated with the new buffer length
+    reloaded = running;
+    reloaded.Channels[0].UseIIOBuffer = true;
+    running.Channels[0].UseIIOBuffer  = true;
+    reloaded.IIOBufferLength          = running.IIOBufferLength + 1;
+    diff                              = DiffConfigs(running, reloaded);
+    ASSERT_EQ(diff.Changed, std::vector<std::string>({running.Channels[0].Id}));
+    ASSERT_FALSE(diff.RestartRequired);
+
+    // channels of a sample group are recreated with the new trigger
+    TSampleGroupSettings group;
+    group.Id                        = "power";
+    group.Trigger.Type              = TIIOTriggerType::HrTimer;
+    group.Trigger.Name              = "adc_timer";
+    group.Trigger.SamplingFrequency = 1000;
+    TConfig grouped                 = running;
+    grouped.SampleGroups            = {group};
+    grouped.Channels[0].SampleGroup = "power";
+    grouped.Channels[1].SampleGroup = "power";
+    reloaded                        = grouped;
+    ASSERT_TRUE(DiffConfigs(grouped, reloaded).IsEmpty());
+    reloaded.SampleGroups[0].Trigger.SamplingFrequency = 2000;
+    diff = DiffConfigs(grouped, reloaded);
+    ASSERT_EQ(diff.Changed, std::vector<std::string>({running.Channels[0].Id, running.Channels[1].Id}));
+
+    // the group of the channels is added by reload
+    reloaded = grouped;
+    grouped.SampleGroups.clear();
+    diff = DiffConfigs(grouped, reloaded);
+    ASSERT_EQ(diff.Changed, std::vector<std::string>({running.Channels[0].Id, running.Channels[1].Id}));
+
+    // virtual channels are listed with ADC channels
+    reloaded = running;
+    TVirtualChannelSettings virtualChannel;
+    virtualChannel.Id         = "P";
+    virtualChannel.Expression = std::make_shared<TExpression>("A2 * A3");
+    running.VirtualChannels.push_back(virtualChannel);
+    virtualChannel.Id = "Q";
+    running.VirtualChannels.push_back(virtualChannel);
+    reloaded.VirtualChannels = running.VirtualChannels;
+    ASSERT_TRUE(DiffConfigs(running, reloaded).IsEmpty());
+
+    reloaded.VirtualChannels[0].Expression = std::make_shared<TExpression>("A2 / A3");
+    reloaded.VirtualChannels[1].Id         = "R";
+    diff                                   = DiffConfigs(running, reloaded);
+    ASSERT_EQ(diff.Changed, std::vector<std::string>({"P"}));
+    ASSERT_EQ(diff.Added, std::vector<std::string>({"R"}));
+    ASSERT_EQ(diff.Removed, std::vector<std::string>({"Q"}));
 }
@@ -0,0 +1,69 @@
+#include "src/expression.h"
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+namespace
+{
+    double Evaluate(const std::string& text, const std::vector<double>& variables = {})
+    {
+        TExpression         expr(text);
+        std::vector<double> stack(expr.GetStackSize());
+        return expr.Evaluate(variables.data(), stack.data());
+    }
+}
+
+TEST(TExpressionTest, arithmetic)
+{
+    ASSERT_DOUBLE_EQ(Evaluate("1 + 2 * 3"), 7);
+    ASSERT_DOUBLE_EQ(Evaluate("(1 + 2) * 3"), 9);
+    ASSERT_DOUBLE_EQ(Evaluate("10 - 4 - 3"), 3);
+    ASSERT_DOUBLE_EQ(Evaluate("12 / 4 / 3"), 1);
+    ASSERT_DOUBLE_EQ(Evaluate("-2 ^ 2"), -4);
+    ASSERT_DOUBLE_EQ(Evaluate("2 ^ 3 ^ 2"), 512);
+    ASSERT_DOUBLE_EQ(Evaluate("2 * -3"), -6);
+    ASSERT_DOUBLE_EQ(Evaluate("1.5e3 + .5"), 1500.5);
+    ASSERT_DOUBLE_EQ(Evaluate("abs(-3) + sqrt(16) + min(1, 2) + max(1, 2)"), 10);
+    ASSERT_TRUE(isinf(Evaluate("1 / 0")));
+}
+
+TEST(TExpressionTest, variables)
+{
+    TExpression expr("U * I + U / 5Vout - U");
+    ASSERT_EQ(expr.GetVariables(), std::vector<std::string>({"U", "I", "5Vout"}));
+
+    std::vector<double> stack(expr.GetStackSize());
+    double              variables[] = {12, 0.5, 4};
+    ASSERT_DOUBLE_EQ(expr.Evaluate(variables, stack.data()), 12 * 0.5 + 12 / 4.0 - 12);
+}
+
+TEST(TExpressionTest, constant_folding)
+{
+    // (2 * 3 + 1) is computed during compilation
+    TExpression expr("A1 * (2 * 3 + 1)");
+    ASSERT_EQ(expr.GetSize(), 3);
+    ASSERT_EQ(expr.GetStackSize(), 2);
+
+    std::vector<double> stack(expr.GetStackSize());
+    double              variables[] = {2};
+    ASSERT_DOUBLE_EQ(expr.Evaluate(variables, stack.data()), 14);
+
+    ASSERT_EQ(TExpression("-(1 + 2) * 4").GetSize(), 1);
+}
+
+TEST(TExpressionTest, syntax_errors)
+{
+    ASSERT_THROW(TExpression(""), std::runtime_error);
+    ASSERT_THROW(TExpression("A1 +"), std::runtime_error);
+    ASSERT_THROW(TExpression("(A1"), std::runtime_error);
+    ASSERT_THROW(TExpression("A1 A2"), std::runtime_error);
+    ASSERT_THROW(TExpression("A1 $ A2"), std::runtime_error);
+    ASSERT_THROW(TExpression("log(A1)"), std::runtime_error);
+    ASSERT_THROW(TExpression("min(A1)"), std::runtime_error);
+    try {
+        TExpression("A1 * * A2");
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        ASSERT_EQ(std::string(e.what()), "Bad expression \"A1 * * A2\" at 6: operand is expected");
+    }
+}
@@ -57,3 +57,82 @@ TEST_F(TFileUtilsTest, two_matches)
     ASSERT_EQ(res[0], resMatch[0]);
     ASSERT_EQ(res[1], resMatch[1]);
 }
+
+TEST_F(TFileUtilsTest, parse_int)
+{
+    int32_t v = 0;
+    ASSERT_TRUE(ParseInt("254 \n", 5, v));
+    ASSERT_EQ(v, 254);
+    ASSERT_TRUE(ParseInt("  -12", 5, v));
+    ASSERT_EQ(v, -12);
+    ASSERT_TRUE(ParseInt("2147483647", 10, v));
+    ASSERT_EQ(v, 2147483647);
+    ASSERT_TRUE(ParseInt("-2147483648", 11, v));
+    ASSERT_EQ(v, -2147483648LL);
+    ASSERT_TRUE(ParseInt("123456", 3, v));
+    ASSERT_EQ(v, 123);
+
+    ASSERT_FALSE(ParseInt("", 0, v));
+    ASSERT_FALSE(ParseInt(" \n", 2, v));
+    ASSERT_FALSE(ParseInt("-", 1, v));
+    ASSERT_FALSE(ParseInt("12a", 3, v));
+    ASSERT_FALSE(ParseInt("1 2", 3, v));
+    ASSERT_FALSE(ParseInt("2147483648", 10, v));
+    ASSERT_FALSE(ParseInt("99999999999999999999", 20, v));
+}
+
+TEST_F(TFileUtilsTest, sysfs_attribute)
+{
+    std::string fileName(testRootDir + "/sysfs_attribute.tmp");
+    int32_t     v = 0;
+
+    TSysfsAttribute noFile(testRootDir + "/nothing");
+    ASSERT_FALSE(noFile.ReadInt(v));
+
+    WriteToFile(fileName, "10\n");
+    TSysfsAttribute attr(fileName);
+    ASSERT_TRUE(attr.ReadInt(v));
+    ASSERT_EQ(v, 10);
+
+    // the file is read from the beginning every time
+    WriteToFile(fileName, "-20\n");
+    ASSERT_TRUE(attr.ReadInt(v));
+    ASSERT_EQ(v, -20);
+
+    WriteToFile(fileName, "garbage");
+    ASSERT_FALSE(attr.ReadInt(v));
+
+    // the file is reopened after failure
+    WriteToFile(fileName, "30");
+    ASSERT_TRUE(attr.ReadInt(v));
+    ASSERT_EQ(v, 30);
+
+    TSysfsAttribute moved(std::move(attr));
+    ASSERT_TRUE(moved.ReadInt(v));
+    ASSERT_EQ(v, 30);
+
+    remove(fileName.c_str());
+}
+
+TEST_F(TFileUtilsTest, file_contents_cache)
+{
+    std::string        fileName(testRootDir + "/contents_cache.tmp");
+    std::string        contents;
+    TFileContentsCache cache;
+
+    WriteToFile(fileName, "1 2 3");
+    ASSERT_TRUE(cache.Read({testRootDir + "/nothing", fileName}, contents));
+    ASSERT_EQ(contents, "1 2 3");
+    ASSERT_EQ(cache.GetReadCount(), 2);
+
+    // both the missing file and the contents are cached
+    WriteToFile(fileName, "4");
+    ASSERT_TRUE(cache.Read({testRootDir + "/nothing", fileName}, contents));
+    ASSERT_EQ(contents, "1 2 3");
+    ASSERT_EQ(cache.GetReadCount(), 2);
+
+    ASSERT_FALSE(cache.Read({testRootDir + "/nothing"}, contents));
+    ASSERT_EQ(cache.GetReadCount(), 2);
+
+    remove(fileName.c_str());
+}
@@ -0,0 +1,170 @@
+#include "src/filters.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+namespace
+{
+    //! Straightforward calculation of trimmed mean by sorting of the window
+    int32_t TrimmedMean(std::vector<int32_t> window, size_t trimCount)
+    {
+        std::sort(window.begin(), window.end());
+        double sum = 0;
+        for (size_t i = trimCount; i < window.size() - trimCount; ++i) {
+            sum += window[i];
+        }
+        return std::round(sum / (window.size() - 2 * trimCount));
+    }
+} // namespace
+
+TEST(TFiltersTest, parse_type)
+{
+    ASSERT_TRUE(ParseFilterType("average") == TFilterType::Average);
+    ASSERT_TRUE(ParseFilterType("median") == TFilterType::Median);
+    ASSERT_TRUE(ParseFilterType("trimmed_mean") == TFilterType::TrimmedMean);
+    ASSERT_TRUE(ParseFilterType("ema") == TFilterType::Ema);
+    ASSERT_TRUE(ParseFilterType("min") == TFilterType::Min);
+    ASSERT_TRUE(ParseFilterType("max") == TFilterType::Max);
+    ASSERT_THROW(ParseFilterType("mean"), std::runtime_error);
+}
+
+TEST(TFiltersTest, zero_window)
+{
+    for (auto type : {TFilterType::Average,
+                      TFilterType::Median,
+                      TFilterType::TrimmedMean,
+                      TFilterType::Ema,
+                      TFilterType::Min,
+                      TFilterType::Max})
+    {
+        ASSERT_THROW(MakeFilter(type, 0, 25), std::runtime_error);
+    }
+}
+
+TEST(TFiltersTest, median)
+{
+    auto f = MakeFilter(TFilterType::Median, 5, 0);
+    for (auto v : {10, 10, 10, 10}) {
+        f->AddValue(v);
+        EXPECT_FALSE(f->IsReady());
+    }
+    f->AddValue(10);
+    ASSERT_TRUE(f->IsReady());
+    EXPECT_EQ(f->GetValue(), 10);
+
+    // single spike doesn't change the result
+    f->AddValue(4000);
+    EXPECT_EQ(f->GetValue(), 10);
+    f->AddValue(-4000);
+    EXPECT_EQ(f->GetValue(), 10);
+
+    // the result follows step change after a half of the window
+    f->AddValue(20);
+    EXPECT_EQ(f->GetValue(), 10);
+    f->AddValue(20);
+    EXPECT_EQ(f->GetValue(), 20);
+}
+
+TEST(TFiltersTest, median_even_window)
+{
+    auto f = MakeFilter(TFilterType::Median, 4, 0);
+    for (auto v : {1, 100, 3, 10}) {
+        f->AddValue(v);
+    }
+    // average of two middle values
+    EXPECT_EQ(f->GetValue(), 7);
+}
+
+TEST(TFiltersTest, trimmed_mean)
+{
+    auto f = MakeFilter(TFilterType::TrimmedMean, 10, 20);
+    for (auto v : {-1000, 10, 11, 12, 13, 14, 15, 16, 17, 5000}) {
+        f->AddValue(v);
+    }
+    ASSERT_TRUE(f->IsReady());
+    // 2 values are dropped from each side
+    EXPECT_EQ(f->GetValue(), 14);
+
+    // trim is limited by a half of the window, so the filter becomes a median
+    auto m = MakeFilter(TFilterType::TrimmedMean, 3, 100);
+    for (auto v : {1, 100, 3}) {
+        m->AddValue(v);
+    }
+    EXPECT_EQ(m->GetValue(), 3);
+}
+
+TEST(TFiltersTest, trimmed_mean_random)
+{
+    std::mt19937                           gen(1);
+    std::uniform_int_distribution<int32_t> dist(-50, 50);
+    for (size_t windowSize : {1, 2, 5, 16}) {
+        for (size_t trimCount : {0, 1, 3, 7}) {
+            TOrderStatisticFilter f(windowSize, trimCount);
+            std::vector<int32_t>  values;
+            for (size_t i = 0; i < 500; ++i) {
+                // small range gives a lot of equal values
+                values.push_back(dist(gen));
+                f.AddValue(values.back());
+                ASSERT_EQ(f.IsReady(), values.size() >= windowSize);
+                if (f.IsReady()) {
+                    std::vector<int32_t> window(values.end() - windowSize, values.end());
+                    ASSERT_EQ(f.GetValue(), TrimmedMean(window, std::min(trimCount, (windowSize - 1) / 2)))
+                        << "window " << windowSize << ", trim " << trimCount << ", step " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(TFiltersTest, ema)
+{
+    auto f = MakeFilter(TFilterType::Ema, 3, 0);
+    f->AddValue(100);
+    EXPECT_FALSE(f->IsReady());
+    EXPECT_EQ(f->GetValue(), 100);
+    f->AddValue(200);
+    // alpha = 2 / (3 + 1)
+    EXPECT_EQ(f->GetValue(), 150);
+    f->AddValue(200);
+    ASSERT_TRUE(f->IsReady());
+    EXPECT_EQ(f->GetValue(), 175);
+    for (size_t i = 0; i < 50; ++i) {
+        f->AddValue(-10);
+    }
+    EXPECT_EQ(f->GetValue(), -10);
+}
+
+TEST(TFiltersTest, min_max)
+{
+    std::mt19937                           gen(2);
+    std::uniform_int_distribution<int32_t> dist(-1000, 1000);
+    for (size_t windowSize : {1, 3, 8}) {
+        auto                 minFilter = MakeFilter(TFilterType::Min, windowSize, 0);
+        auto                 maxFilter = MakeFilter(TFilterType::Max, windowSize, 0);
+        std::vector<int32_t> values;
+        for (size_t i = 0; i < 200; ++i) {
+            values.push_back(dist(gen));
+            minFilter->AddValue(values.back());
+            maxFilter->AddValue(values.back());
+            ASSERT_EQ(minFilter->IsReady(), values.size() >= windowSize);
+            ASSERT_EQ(maxFilter->IsReady(), values.size() >= windowSize);
+            if (values.size() >= windowSize) {
+                ASSERT_EQ(minFilter->GetValue(), *std::min_element(values.end() - windowSize, values.end()));
+                ASSERT_EQ(maxFilter->GetValue(), *std::max_element(values.end() - windowSize, values.end()));
+            }
+        }
+    }
+}
+
+TEST(TFiltersTest, average)
+{
+    auto f = MakeFilter(TFilterType::Average, 3, 0);
+    f->AddValue(10);
+    f->AddValue(10);
+    EXPECT_FALSE(f->IsReady());
+    f->AddValue(2);
+    ASSERT_TRUE(f->IsReady());
+    EXPECT_EQ(f->GetValue(), 7);
+}
@@ -0,0 +1,169 @@
+#include "src/iio_buffer.h"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+class TIIOBufferTest : public testing::Test
+{
+protected:
+    std::string testRootDir;
+
+    void SetUp()
+    {
+        char* d = getenv("TEST_DIR_ABS");
+        if (d != NULL) {
+            testRootDir = d;
+            testRootDir += '/';
+        }
+        testRootDir += "iio_buffer_test_data";
+    }
+
+    std::string ReadFile(const std::string& fileName)
+    {
+        std::ifstream f(testRootDir + "/" + fileName);
+        std::string   res;
+        f >> res;
+        return res;
+    }
+};
+
+TEST_F(TIIOBufferTest, parse_type)
+{
+    auto t = ParseScanElementType("le:s12/16>>4");
+    ASSERT_FALSE(t.BigEndian);
+    ASSERT_TRUE(t.Signed);
+    ASSERT_EQ(t.Bits, 12);
+    ASSERT_EQ(t.StorageBits, 16);
+    ASSERT_EQ(t.Repeat, 1);
+    ASSERT_EQ(t.Shift, 4);
+
+    t = ParseScanElementType("be:u24/32X2>>0");
+    ASSERT_TRUE(t.BigEndian);
+    ASSERT_FALSE(t.Signed);
+    ASSERT_EQ(t.Bits, 24);
+    ASSERT_EQ(t.StorageBits, 32);
+    ASSERT_EQ(t.Repeat, 2);
+    ASSERT_EQ(t.Shift, 0);
+
+    ASSERT_THROW(ParseScanElementType(""), std::runtime_error);
+    ASSERT_THROW(ParseScanElementType("me:s12/16>>4"), std::runtime_error);
+    ASSERT_THROW(ParseScanElementType("le:x12/16>>4"), std::runtime_error);
+    ASSERT_THROW(ParseScanElementType("le:s12/12>>0"), std::runtime_error);
+    ASSERT_THROW(ParseScanElementType("le:s16/16>>4"), std::runtime_error);
+}
+
+TEST_F(TIIOBufferTest, decode)
+{
+    const uint8_t le[] = {0x64, 0xf0};
+    ASSERT_EQ(DecodeScanElement(le, ParseScanElementType("le:u12/16>>0")), 100);
+    ASSERT_EQ(DecodeScanElement(le, ParseScanElementType("le:u16/16>>0")), 0xf064);
+    ASSERT_EQ(DecodeScanElement(le, ParseScanElementType("be:u16/16>>0")), 0x64f0);
+
+    const uint8_t be[] = {0xff, 0xbf};
+    ASSERT_EQ(DecodeScanElement(be, ParseScanElementType("be:s12/16>>4")), -5);
+    ASSERT_EQ(DecodeScanElement(be, ParseScanElementType("be:u12/16>>4")), 0xffb);
+
+    const uint8_t ts[] = {0xe8, 0x03, 0, 0, 0, 0, 0, 0x80};
+    ASSERT_EQ(DecodeScanElement(ts, ParseScanElementType("le:s64/64>>0")), INT64_MIN + 1000);
+}
+
+TEST_F(TIIOBufferTest, read_file)
+{
+    TIIOBuffer buf(testRootDir, testRootDir + "/scans.bin", {"voltage1", "voltage0"}, 16);
+    ASSERT_EQ(ReadFile("buffer/enable"), "1");
+    ASSERT_EQ(ReadFile("buffer/length"), "16");
+    ASSERT_EQ(ReadFile("scan_elements/in_voltage0_en"), "1");
+    ASSERT_EQ(ReadFile("scan_elements/in_voltage1_en"), "1");
+    ASSERT_EQ(ReadFile("scan_elements/in_voltage2_en"), "0");
+    ASSERT_EQ(ReadFile("scan_elements/in_timestamp_en"), "1");
+    ASSERT_EQ(buf.GetScanSize(), 16);
+
+    std::vector<int32_t> values;
+    ASSERT_TRUE(buf.ReadScan(values, 100));
+    ASSERT_EQ(values, std::vector<int32_t>({-5, 100}));
+    ASSERT_EQ(buf.GetTimestamp(), 1000);
+
+    ASSERT_TRUE(buf.ReadScan(values, 100));
+    ASSERT_EQ(values, std::vector<int32_t>({2047, 4095}));
+    ASSERT_EQ(buf.GetTimestamp(), 2000);
+
+    ASSERT_TRUE(buf.ReadScan(values, 100));
+    ASSERT_EQ(values, std::vector<int32_t>({-2048, 0}));
+    ASSERT_EQ(buf.GetTimestamp(), 3000);
+
+    ASSERT_FALSE(buf.ReadScan(values, 100));
+}
+
+TEST_F(TIIOBufferTest, read_repeat)
+{
+    // in_voltage1 has two 16-bit values and is aligned to 4 bytes
+    std::string dir(testRootDir + "/../iio_buffer_repeat_test_data");
+    TIIOBuffer  buf(dir, dir + "/scans.bin", {"voltage2", "voltage1", "voltage0"}, 16);
+    ASSERT_EQ(buf.GetScanSize(), 12);
+
+    std::vector<int32_t> values;
+    ASSERT_TRUE(buf.ReadScan(values, 100));
+    ASSERT_EQ(values, std::vector<int32_t>({70000, 0x1234, 100}));
+
+    ASSERT_TRUE(buf.ReadScan(values, 100));
+    ASSERT_EQ(values, std::vector<int32_t>({0, 1, 4095}));
+
+    ASSERT_FALSE(buf.ReadScan(values, 100));
+}
+
+TEST_F(TIIOBufferTest, disable_on_destruction)
+{
+    {
+        TIIOBuffer buf(testRootDir, testRootDir + "/scans.bin", {"voltage0"}, 16);
+        ASSERT_EQ(ReadFile("buffer/enable"), "1");
+        ASSERT_EQ(ReadFile("scan_elements/in_voltage1_en"), "0");
+    }
+    ASSERT_EQ(ReadFile("buffer/enable"), "0");
+
+    // restore test data
+    TIIOBuffer buf(testRootDir, testRootDir + "/scans.bin", {"voltage0", "voltage1"}, 16);
+}
+
+TEST_F(TIIOBufferTest, bad_config)
+{
+    ASSERT_THROW(TIIOBuffer(testRootDir, testRootDir + "/scans.bin", {"voltage5"}, 16), std::runtime_error);
+    ASSERT_THROW(TIIOBuffer(testRootDir, testRootDir + "/nothing", {"voltage0", "voltage1"}, 16),
+                 std::runtime_error);
+    ASSERT_EQ(ReadFile("buffer/enable"), "0");
+}
+
+TEST_F(TIIOBufferTest, read_fifo)
+{
+    std::string fifoName(testRootDir + "/scans.fifo");
+    unlink(fifoName.c_str());
+    ASSERT_EQ(mkfifo(fifoName.c_str(), 0600), 0);
+
+    std::ifstream scansFile(testRootDir + "/scans.bin", std::ios::binary);
+    std::string   scans((std::istreambuf_iterator<char>(scansFile)), std::istreambuf_iterator<char>());
+
+    TIIOBuffer buf(testRootDir, fifoName, {"voltage0", "voltage1"}, 16);
+
+    // write the first scan in two parts to check reassembling of records
+    std::thread writer([&] {
+        int fd = open(fifoName.c_str(), O_WRONLY);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(write(fd, scans.data(), 5), 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_EQ(write(fd, scans.data() + 5, scans.size() - 5), scans.size() - 5);
+        close(fd);
+    });
+
+    std::vector<int32_t> values;
+    ASSERT_TRUE(buf.ReadScan(values, 1000));
+    ASSERT_EQ(values, std::vector<int32_t>({100, -5}));
+    ASSERT_TRUE(buf.ReadScan(values, 1000));
+    ASSERT_EQ(values, std::vector<int32_t>({4095, 2047}));
+    ASSERT_TRUE(buf.ReadScan(values, 1000));
+    ASSERT_EQ(values, std::vector<int32_t>({0, -2048}));
+    writer.join();
+    unlink(fifoName.c_str());
+}
@@ -0,0 +1,88 @@
+#include "src/iio_device_monitor.h"
+#include "src/sysfs_adc.h"
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+namespace
+{
+    // the rescan interval is much longer than waits in tests, so a quick wakeup is caused by inotify
+    const milliseconds RESCAN_INTERVAL(10000);
+    const milliseconds MAX_WAKEUP_LATENCY(2000);
+}
+
+class TIIODeviceMonitorTest : public testing::Test
+{
+protected:
+    std::string devicesDir;
+
+    void SetUp()
+    {
+        char* d = getenv("TEST_DIR_ABS");
+        if (d != NULL) {
+            devicesDir = d;
+            devicesDir += '/';
+        }
+        devicesDir += "iio_devices_monitor.tmp";
+        mkdir(devicesDir.c_str(), 0755);
+    }
+
+    void TearDown()
+    {
+        unlink((devicesDir + "/iio:device0").c_str());
+        rmdir(devicesDir.c_str());
+    }
+};
+
+TEST_F(TIIODeviceMonitorTest, hotplug)
+{
+    TIIODeviceMonitor monitor(devicesDir, RESCAN_INTERVAL);
+    TIIODeviceIndex   index(devicesDir);
+    TStopEvent        stopEvent;
+    ASSERT_TRUE(monitor.IsWatching());
+    ASSERT_FALSE(index.Rescan());
+    ASSERT_EQ(index.Find("adc"), std::string());
+
+    // device appears
+    std::thread plug([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        symlink("../../devices/platform/soc/2000000.adc/iio:device0", (devicesDir + "/iio:device0").c_str());
+    });
+    auto start = steady_clock::now();
+    ASSERT_TRUE(monitor.Wait(stopEvent));
+    plug.join();
+    ASSERT_LT(steady_clock::now() - start, MAX_WAKEUP_LATENCY);
+    ASSERT_TRUE(index.Rescan());
+    ASSERT_EQ(index.Find("2000000.adc"), devicesDir + "/iio:device0");
+    ASSERT_EQ(index.Find(""), devicesDir + "/iio:device0");
+    ASSERT_FALSE(index.Rescan());
+
+    // device disappears
+    unlink((devicesDir + "/iio:device0").c_str());
+    start = steady_clock::now();
+    ASSERT_TRUE(monitor.Wait(stopEvent));
+    ASSERT_LT(steady_clock::now() - start, MAX_WAKEUP_LATENCY);
+    ASSERT_TRUE(index.Rescan());
+    ASSERT_EQ(index.Find("2000000.adc"), std::string());
+    ASSERT_EQ(index.Find(""), std::string());
+
+    stopEvent.Set();
+    ASSERT_FALSE(monitor.Wait(stopEvent));
+}
+
+TEST_F(TIIODeviceMonitorTest, no_dir)
+{
+    TIIODeviceMonitor monitor(devicesDir + "/nothing", milliseconds(10));
+    TIIODeviceIndex   index(devicesDir + "/nothing");
+    TStopEvent        stopEvent;
+    ASSERT_FALSE(monitor.IsWatching());
+
+    // the folder is rescanned after the interval
+    ASSERT_TRUE(monitor.Wait(stopEvent));
+    ASSERT_FALSE(index.Rescan());
+    ASSERT_EQ(index.GetDeviceCount(), 0);
+}
@@ -0,0 +1,180 @@
+#include "src/iio_trigger.h"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    std::string ReadFile(const std::string& fileName)
+    {
+        std::ifstream f(fileName);
+        return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::string& fileName, const std::string& value)
+    {
+        std::ofstream f(fileName);
+        f << value;
+    }
+}
+
+class TIIOTriggerTest : public testing::Test
+{
+protected:
+    std::string rootDir;
+    std::string devicesDir;
+    std::string deviceDir;
+    std::string configfsDir;
+
+    void SetUp()
+    {
+        char* d = getenv("TEST_DIR_ABS");
+        if (d != NULL) {
+            rootDir = d;
+            rootDir += '/';
+        }
+        rootDir += "iio_trigger.tmp";
+        devicesDir  = rootDir + "/devices";
+        deviceDir   = devicesDir + "/iio:device0";
+        configfsDir = rootDir + "/configfs";
+        system(("rm -rf " + rootDir).c_str());
+        mkdir(rootDir.c_str(), 0755);
+        mkdir(devicesDir.c_str(), 0755);
+        mkdir(deviceDir.c_str(), 0755);
+        mkdir((deviceDir + "/trigger").c_str(), 0755);
+        WriteFile(deviceDir + "/trigger/current_trigger", "");
+        mkdir(configfsDir.c_str(), 0755);
+        mkdir((configfsDir + "/hrtimer").c_str(), 0755);
+    }
+
+    void TearDown()
+    {
+        system(("rm -rf " + rootDir).c_str());
+    }
+
+    void AddTrigger(const std::string& dirName, const std::string& name)
+    {
+        mkdir((devicesDir + "/" + dirName).c_str(), 0755);
+        WriteFile(devicesDir + "/" + dirName + "/name", name + "\n");
+    }
+};
+
+TEST_F(TIIOTriggerTest, device)
+{
+    AddTrigger("trigger0", "other");
+    AddTrigger("trigger1", "adc-dev0");
+
+    TIIOTriggerSettings settings;
+    settings.Type = TIIOTriggerType::Device;
+    settings.Name = "adc-dev0";
+    {
+        TIIOTrigger trigger(settings, deviceDir, devicesDir, configfsDir);
+        ASSERT_EQ(trigger.GetTriggerDir(), devicesDir + "/trigger1");
+        ASSERT_FALSE(trigger.NeedsFiring());
+        ASSERT_EQ(ReadFile(deviceDir + "/trigger/current_trigger"), "adc-dev0");
+    }
+    ASSERT_EQ(ReadFile(deviceDir + "/trigger/current_trigger"), "\n");
+
+    settings.Name = "missing";
+    ASSERT_THROW(TIIOTrigger(settings, deviceDir, devicesDir, configfsDir), std::runtime_error);
+}
+
+TEST_F(TIIOTriggerTest, hrtimer)
+{
+    TIIOTriggerSettings settings;
+    settings.Type              = TIIOTriggerType::HrTimer;
+    settings.Name              = "adc_timer";
+    settings.SamplingFrequency = 1000;
+
+    // existing trigger is used, nothing is created in configfs
+    AddTrigger("trigger2", "adc_timer");
+    {
+        TIIOTrigger trigger(settings, deviceDir, devicesDir, configfsDir);
+        ASSERT_EQ(trigger.GetTriggerDir(), devicesDir + "/trigger2");
+        ASSERT_EQ(ReadFile(devicesDir + "/trigger2/sampling_frequency"), "1000");
+        ASSERT_EQ(ReadFile(deviceDir + "/trigger/current_trigger"), "adc_timer");
+    }
+
+    // fractional frequency can't be written as an integer
+    settings.SamplingFrequency = 312.5;
+    {
+        TIIOTrigger trigger(settings, deviceDir, devicesDir, configfsDir);
+        ASSERT_EQ(ReadFile(devicesDir + "/trigger2/sampling_frequency"), "312.500000");
+    }
+    struct stat st;
+    ASSERT_NE(stat((configfsDir + "/hrtimer/adc_timer").c_str(), &st), 0);
+}
+
+TEST_F(TIIOTriggerTest, hrtimer_not_created)
+{
+    TIIOTriggerSettings settings;
+    settings.Type = TIIOTriggerType::HrTimer;
+    settings.Name = "adc_timer";
+
+    // the folder is created in configfs, but the kernel doesn't create the trigger in the fake tree,
+    // so the folder is removed
+    ASSERT_THROW(TIIOTrigger(settings, deviceDir, devicesDir, configfsDir), std::runtime_error);
+    struct stat st;
+    ASSERT_NE(stat((configfsDir + "/hrtimer/adc_timer").c_str(), &st), 0);
+}
+
+TEST_F(TIIOTriggerTest, hrtimer_removed_on_failure)
+{
+    TIIOTriggerSettings settings;
+    settings.Type              = TIIOTriggerType::HrTimer;
+    settings.Name              = "adc_timer";
+    settings.SamplingFrequency = 1000;
+
+    // the name of the trigger is readable only after its folder is created in configfs, like the kernel does
+    WriteFile(configfsDir + "/hrtimer/timer_name", "adc_timer\n");
+    mkdir((devicesDir + "/trigger3").c_str(), 0755);
+    ASSERT_EQ(symlink((configfsDir + "/hrtimer/adc_timer/../timer_name").c_str(), (devicesDir + "/trigger3/name").c_str()),
+              0);
+
+    // current_trigger can't be written
+    std::string currentTrigger = deviceDir + "/trigger/current_trigger";
+    unlink(currentTrigger.c_str());
+    mkdir(currentTrigger.c_str(), 0755);
+
+    ASSERT_THROW(TIIOTrigger(settings, deviceDir, devicesDir, configfsDir), std::runtime_error);
+    ASSERT_EQ(ReadFile(devicesDir + "/trigger3/sampling_frequency"), "1000");
+    struct stat st;
+    ASSERT_NE(stat((configfsDir + "/hrtimer/adc_timer").c_str(), &st), 0);
+}
+
+TEST_F(TIIOTriggerTest, sysfs)
+{
+    mkdir((devicesDir + "/iio_sysfs_trigger").c_str(), 0755);
+    WriteFile(devicesDir + "/iio_sysfs_trigger/add_trigger", "");
+    WriteFile(devicesDir + "/iio_sysfs_trigger/remove_trigger", "");
+
+    TIIOTriggerSettings settings;
+    settings.Type = TIIOTriggerType::Sysfs;
+    settings.Name = "sysfstrig5";
+
+    // the kernel doesn't create the trigger in the fake tree, so it is removed
+    ASSERT_THROW(TIIOTrigger(settings, deviceDir, devicesDir, configfsDir), std::runtime_error);
+    ASSERT_EQ(ReadFile(devicesDir + "/iio_sysfs_trigger/add_trigger"), "5");
+    ASSERT_EQ(ReadFile(devicesDir + "/iio_sysfs_trigger/remove_trigger"), "5");
+    WriteFile(devicesDir + "/iio_sysfs_trigger/remove_trigger", "");
+
+    AddTrigger("trigger4", "sysfstrig5");
+    WriteFile(devicesDir + "/trigger4/trigger_now", "");
+    WriteFile(devicesDir + "/iio_sysfs_trigger/add_trigger", "");
+    {
+        TIIOTrigger trigger(settings, deviceDir, devicesDir, configfsDir);
+        ASSERT_TRUE(trigger.NeedsFiring());
+        ASSERT_TRUE(trigger.Fire());
+        ASSERT_EQ(ReadFile(devicesDir + "/trigger4/trigger_now"), "1");
+        ASSERT_EQ(ReadFile(deviceDir + "/trigger/current_trigger"), "sysfstrig5");
+        // existing trigger is not added again
+        ASSERT_EQ(ReadFile(devicesDir + "/iio_sysfs_trigger/add_trigger"), "");
+    }
+    ASSERT_EQ(ReadFile(devicesDir + "/iio_sysfs_trigger/remove_trigger"), "");
+
+    settings.Name = "trig5";
+    ASSERT_THROW(TIIOTrigger(settings, deviceDir, devicesDir, configfsDir), std::runtime_error);
+}
@@ -61,3 +61,66 @@ TEST(TMovingAverageTest, negative)
     c.AddValue(-3);
     EXPECT_EQ(c.GetAverage(), -8);
 }
+
+TEST(TMovingAverageTest, divide_to_fixed_point)
+{
+    EXPECT_EQ(DivideToFixedPoint(7, 2, 0), 4);
+    EXPECT_EQ(DivideToFixedPoint(-7, 2, 0), -4);
+    EXPECT_EQ(DivideToFixedPoint(7, 3, 0), 2);
+    EXPECT_EQ(DivideToFixedPoint(-7, 3, 0), -2);
+    EXPECT_EQ(DivideToFixedPoint(7, 2, 1), 7);
+    EXPECT_EQ(DivideToFixedPoint(-7, 2, 1), -7);
+    // 7 / 3 = 2.333 = 597.33 / 256
+    EXPECT_EQ(DivideToFixedPoint(7, 3, 8), 597);
+    EXPECT_EQ(DivideToFixedPoint(-7, 3, 8), -597);
+    // 1 / 3 = 0.333 = 21845.33 / 65536
+    EXPECT_EQ(DivideToFixedPoint(1, 3, 16), 21845);
+    EXPECT_EQ(DivideToFixedPoint(2, 3, 16), 43691);
+}
+
+TEST(TMovingAverageTest, fixed_point)
+{
+    TMovingAverageCalculator c(4);
+    for (auto v : {10, 11, 11, 11}) {
+        c.AddValue(v);
+    }
+    EXPECT_EQ(c.GetAverage(), 11);
+    // 10.75
+    EXPECT_EQ(c.GetFixedPointValue(0), 11);
+    EXPECT_EQ(c.GetFixedPointValue(2), 43);
+    EXPECT_EQ(c.GetFixedPointValue(8), 2752);
+
+    for (auto v : {-10, -11, -11, -11}) {
+        c.AddValue(v);
+    }
+    EXPECT_EQ(c.GetAverage(), -11);
+    EXPECT_EQ(c.GetFixedPointValue(2), -43);
+}
+
+TEST(TMovingAverageTest, large_window)
+{
+    // sum of the window doesn't fit into 32 bits
+    const size_t             windowSize = 1 << 16;
+    const int32_t            maxValue   = (1 << 23) - 1;
+    TMovingAverageCalculator c(windowSize);
+    for (size_t i = 0; i < windowSize; ++i) {
+        c.AddValue(maxValue);
+    }
+    ASSERT_TRUE(c.IsReady());
+    EXPECT_EQ(c.GetAverage(), maxValue);
+    EXPECT_EQ(c.GetFixedPointValue(16), static_cast<int64_t>(maxValue) << 16);
+
+    for (size_t i = 0; i < windowSize; ++i) {
+        c.AddValue(-maxValue - 1);
+    }
+    EXPECT_EQ(c.GetAverage(), -maxValue - 1);
+    EXPECT_EQ(c.GetFixedPointValue(16), -(static_cast<int64_t>(maxValue) + 1) * 65536);
+
+    // half of the window is the maximum, half is the minimum, average is -0.5
+    for (size_t i = 0; i < windowSize / 2; ++i) {
+        c.AddValue(maxValue);
+    }
+    EXPECT_EQ(c.GetAverage(), -1);
+    EXPECT_EQ(c.GetFixedPointValue(1), -1);
+    EXPECT_EQ(c.GetFixedPointValue(16), -32768);
+}
@@ -0,0 +1,107 @@
+#include "src/publish_policy.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono;
+
+class TPublishPolicyTest : public testing::Test
+{
+protected:
+    TPublishPolicy::TClock::time_point start = TPublishPolicy::TClock::now();
+
+    TPublishPolicy::TClock::time_point At(int ms)
+    {
+        return start + milliseconds(ms);
+    }
+};
+
+TEST_F(TPublishPolicyTest, on_change)
+{
+    TPublishPolicy p(TPublishPolicy::TSettings{});
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1.00", At(0)));
+    ASSERT_FALSE(p.ShouldPublishValue(1.001, "1.00", At(10)));
+    ASSERT_FALSE(p.ShouldPublishValue(1, "1.00", At(100000)));
+    ASSERT_TRUE(p.ShouldPublishValue(1.01, "1.01", At(100010)));
+    ASSERT_EQ(p.GetPublishedCount(), 2);
+    ASSERT_EQ(p.GetSuppressedCount(), 2);
+}
+
+TEST_F(TPublishPolicyTest, deadband)
+{
+    TPublishPolicy::TSettings s;
+    s.Deadband = 0.1;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1.00", At(0)));
+    ASSERT_FALSE(p.ShouldPublishValue(1.05, "1.05", At(10)));
+    ASSERT_FALSE(p.ShouldPublishValue(0.95, "0.95", At(20)));
+    ASSERT_TRUE(p.ShouldPublishValue(1.15, "1.15", At(30)));
+    // deadband is counted from the last published value
+    ASSERT_FALSE(p.ShouldPublishValue(1.06, "1.06", At(40)));
+    ASSERT_TRUE(p.ShouldPublishValue(1.04, "1.04", At(50)));
+}
+
+TEST_F(TPublishPolicyTest, deadband_percent)
+{
+    TPublishPolicy::TSettings s;
+    s.Deadband        = 0.1;
+    s.DeadbandPercent = 10;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishValue(10, "10", At(0)));
+    // percent deadband (1.0) is bigger than absolute one
+    ASSERT_FALSE(p.ShouldPublishValue(10.9, "10.9", At(10)));
+    ASSERT_TRUE(p.ShouldPublishValue(11.1, "11.1", At(20)));
+    ASSERT_TRUE(p.ShouldPublishValue(0.5, "0.5", At(30)));
+    // absolute deadband is bigger for small values
+    ASSERT_FALSE(p.ShouldPublishValue(0.55, "0.55", At(40)));
+}
+
+TEST_F(TPublishPolicyTest, min_interval)
+{
+    TPublishPolicy::TSettings s;
+    s.MinPublishIntervalMs = 100;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(0)));
+    ASSERT_FALSE(p.ShouldPublishValue(2, "2", At(50)));
+    ASSERT_TRUE(p.ShouldPublishValue(3, "3", At(100)));
+    ASSERT_FALSE(p.ShouldPublishValue(3, "3", At(250)));
+}
+
+TEST_F(TPublishPolicyTest, max_interval)
+{
+    TPublishPolicy::TSettings s;
+    s.MaxPublishIntervalMs = 1000;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(0)));
+    ASSERT_FALSE(p.ShouldPublishValue(1, "1", At(500)));
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(1000)));
+    ASSERT_FALSE(p.ShouldPublishValue(1, "1", At(1999)));
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(2000)));
+}
+
+TEST_F(TPublishPolicyTest, errors)
+{
+    TPublishPolicy::TSettings s;
+    s.MinPublishIntervalMs = 100;
+    s.MaxPublishIntervalMs = 1000;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(0)));
+    // state changes are published regardless of intervals
+    ASSERT_TRUE(p.ShouldPublishError(At(10)));
+    ASSERT_FALSE(p.ShouldPublishError(At(20)));
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(30)));
+    ASSERT_TRUE(p.ShouldPublishError(At(40)));
+    ASSERT_TRUE(p.ShouldPublishError(At(1040)));
+    ASSERT_EQ(p.GetPublishedCount(), 5);
+    ASSERT_EQ(p.GetSuppressedCount(), 1);
+}
+
+TEST_F(TPublishPolicyTest, changed_error)
+{
+    TPublishPolicy::TSettings s;
+    s.MaxPublishIntervalMs = 1000;
+    TPublishPolicy p(s);
+    ASSERT_TRUE(p.ShouldPublishError(At(0)));
+    ASSERT_FALSE(p.ShouldPublishError(At(10), "r"));
+    ASSERT_TRUE(p.ShouldPublishError(At(20), "rw"));
+    ASSERT_FALSE(p.ShouldPublishError(At(30), "rw"));
+    ASSERT_TRUE(p.ShouldPublishValue(1, "1", At(40)));
+}
@@ -0,0 +1,231 @@
+#include "src/publisher.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(TBoundedQueueTest, fifo)
+{
+    ASSERT_THROW(TBoundedQueue<int> q(0), std::runtime_error);
+
+    TBoundedQueue<int> q(3);
+    ASSERT_EQ(q.Capacity(), 4);
+    int v;
+    ASSERT_FALSE(q.TryPop(v));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.TryPush(int(i)));
+    }
+    ASSERT_FALSE(q.TryPush(4));
+    ASSERT_EQ(q.Size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.TryPop(v));
+        ASSERT_EQ(v, i);
+    }
+    ASSERT_FALSE(q.TryPop(v));
+    ASSERT_EQ(q.Size(), 0);
+}
+
+TEST(TBoundedQueueTest, producer_consumer)
+{
+    const int          COUNT = 20000;
+    TBoundedQueue<int> q(16);
+
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i) {
+            while (!q.TryPush(int(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    while (expected < COUNT) {
+        int v;
+        if (q.TryPop(v)) {
+            ASSERT_EQ(v, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(TBoundedQueueTest, concurrent_drop_oldest)
+{
+    const int                  COUNT = 20000;
+    TBoundedQueue<std::string> q(4);
+    std::atomic<int>           dropped(0);
+
+    // the producer drops the oldest elements while the consumer reads
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i) {
+            std::string item = std::to_string(i);
+            while (!q.TryPush(std::move(item))) {
+                std::string oldest;
+                if (q.TryPop(oldest)) {
+                    ++dropped;
+                }
+            }
+        }
+    });
+
+    int last     = -1;
+    int received = 0;
+    for (;;) {
+        std::string v;
+        if (q.TryPop(v)) {
+            int n = std::stoi(v);
+            ASSERT_GT(n, last);
+            last = n;
+            ++received;
+            if (n == COUNT - 1) {
+                break;
+            }
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    ASSERT_EQ(received + dropped, COUNT);
+}
+
+TEST(TPublishBatchTest, coalescing)
+{
+    TPublishBatch batch;
+    ASSERT_TRUE(batch.Add(TPublishItem{"A1", "1", false}));
+    ASSERT_TRUE(batch.Add(TPublishItem{"A2", "2", false}));
+    ASSERT_FALSE(batch.Add(TPublishItem{"A1", "3", false}));
+    ASSERT_FALSE(batch.Add(TPublishItem{"A2", "", true}));
+
+    const auto& items = batch.GetItems();
+    ASSERT_EQ(items.size(), 2);
+    ASSERT_EQ(items[0].ControlId, "A1");
+    ASSERT_EQ(items[0].Value, "3");
+    ASSERT_FALSE(items[0].Error);
+    ASSERT_EQ(items[1].ControlId, "A2");
+    ASSERT_TRUE(items[1].Error);
+
+    batch.Clear();
+    ASSERT_TRUE(batch.GetItems().empty());
+    ASSERT_TRUE(batch.Add(TPublishItem{"A1", "1", false}));
+
+    // meta is kept separately from the value of the control
+    TPublishItem meta{"A1", "open", false};
+    meta.Meta = "breaker";
+    ASSERT_TRUE(batch.Add(TPublishItem(meta)));
+    meta.Value = "closed";
+    ASSERT_FALSE(batch.Add(TPublishItem(meta)));
+    ASSERT_EQ(batch.GetItems().size(), 2);
+    ASSERT_EQ(batch.GetItems()[0].Value, "1");
+    ASSERT_EQ(batch.GetItems()[1].Value, "closed");
+}
+
+TEST(TPublishBatchTest, transactions)
+{
+    TPublishBatch batch;
+    ASSERT_TRUE(batch.IsComplete());
+    TPublishItem item{"A1", "1", false};
+    item.More = true;
+    batch.Add(std::move(item), 0);
+    ASSERT_FALSE(batch.IsComplete());
+
+    // items of other queues and clearing don't close the transaction
+    batch.Add(TPublishItem{"B1", "1", false}, 1);
+    ASSERT_FALSE(batch.IsComplete());
+    batch.Clear();
+    ASSERT_FALSE(batch.IsComplete());
+
+    batch.Add(TPublishItem{"A2", "1", false}, 0);
+    ASSERT_TRUE(batch.IsComplete());
+
+    item      = TPublishItem{"B1", "2", false};
+    item.More = true;
+    batch.Add(std::move(item), 1);
+    ASSERT_FALSE(batch.IsComplete());
+    batch.Abort(1);
+    ASSERT_TRUE(batch.IsComplete());
+}
+
+TEST(TPublisherTest, drop_oldest)
+{
+    WBMQTT::TLogger       logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TPublisher::TSettings settings;
+    settings.QueueSize = 4;
+    TPublisher publisher(nullptr, nullptr, settings, logger);
+    auto       queue = publisher.CreateQueue();
+
+    for (int i = 0; i < 6; ++i) {
+        queue->Push(TPublishItem{"A1", std::to_string(i), false});
+    }
+    ASSERT_EQ(publisher.GetStatistics().Dropped, 2);
+    ASSERT_EQ(publisher.GetQueueDepth(), 4);
+
+    TPublishItem item;
+    for (int i = 2; i < 6; ++i) {
+        ASSERT_TRUE(queue->Pop(item));
+        ASSERT_EQ(item.Value, std::to_string(i));
+    }
+    ASSERT_FALSE(queue->Pop(item));
+}
+
+TEST(TPublisherTest, block)
+{
+    WBMQTT::TLogger       logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TPublisher::TSettings settings;
+    settings.QueueSize       = 2;
+    settings.BlockOnOverflow = true;
+    TPublisher publisher(nullptr, nullptr, settings, logger);
+    auto       queue = publisher.CreateQueue();
+
+    queue->Push(TPublishItem{"A1", "0", false});
+    queue->Push(TPublishItem{"A1", "1", false});
+
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        TPublishItem item;
+        ASSERT_TRUE(queue->Pop(item));
+        ASSERT_EQ(item.Value, "0");
+    });
+    queue->Push(TPublishItem{"A1", "2", false});
+    consumer.join();
+
+    auto stats = publisher.GetStatistics();
+    ASSERT_EQ(stats.Blocked, 1);
+    ASSERT_EQ(stats.Dropped, 0);
+
+    TPublishItem item;
+    ASSERT_TRUE(queue->Pop(item));
+    ASSERT_EQ(item.Value, "1");
+    ASSERT_TRUE(queue->Pop(item));
+    ASSERT_EQ(item.Value, "2");
+}
+
+TEST(TPublisherTest, block_until_stop)
+{
+    WBMQTT::TLogger       logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TPublisher::TSettings settings;
+    settings.QueueSize       = 2;
+    settings.BlockOnOverflow = true;
+    TPublisher publisher(nullptr, nullptr, settings, logger);
+    auto       queue     = publisher.CreateQueue();
+    auto       stopEvent = std::make_shared<TStopEvent>();
+    queue->SetStopEvent(stopEvent);
+
+    queue->Push(TPublishItem{"A1", "0", false});
+    queue->Push(TPublishItem{"A1", "1", false});
+
+    // nobody pops the queue, so the push returns only because of the stop event
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        stopEvent->Set();
+    });
+    queue->Push(TPublishItem{"A1", "2", false});
+    stopper.join();
+
+    auto stats = publisher.GetStatistics();
+    ASSERT_EQ(stats.Blocked, 1);
+    ASSERT_EQ(stats.Dropped, 1);
+    ASSERT_EQ(publisher.GetQueueDepth(), 2);
+    ASSERT_TRUE(queue->TakeAborted());
+    ASSERT_FALSE(queue->TakeAborted());
+}
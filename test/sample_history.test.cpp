@@ -0,0 +1,181 @@
+#include "src/history_rpc.h"
+#include "src/sample_history.h"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+
+TEST(TSampleHistoryTest, ring)
+{
+    ASSERT_THROW(TSampleHistory(0), std::runtime_error);
+    ASSERT_EQ(TSampleHistory::GetCapacityForBudget(1024), 1024 / TSampleHistory::GetSampleSize());
+
+    TSampleHistory h(4);
+    ASSERT_TRUE(h.Get(0, 1000, 100).empty());
+    for (int i = 1; i <= 6; ++i) {
+        h.Add(i * 10, -i);
+    }
+    // only the last 4 samples are kept
+    auto res = h.Get(0, 1000, 100);
+    ASSERT_EQ(res.size(), 4);
+    for (size_t i = 0; i < res.size(); ++i) {
+        ASSERT_EQ(res[i].TimestampUs, (i + 3) * 10);
+        ASSERT_EQ(res[i].Value, -static_cast<int32_t>(i + 3));
+    }
+
+    res = h.Get(40, 50, 100);
+    ASSERT_EQ(res.size(), 2);
+    ASSERT_EQ(res[0].TimestampUs, 40);
+    ASSERT_EQ(res[1].TimestampUs, 50);
+
+    bool truncated = true;
+    res            = h.Get(40, 60, 3, &truncated);
+    ASSERT_EQ(res.size(), 3);
+    ASSERT_FALSE(truncated);
+
+    res = h.Get(0, 1000, 1, &truncated);
+    ASSERT_EQ(res.size(), 1);
+    ASSERT_EQ(res[0].TimestampUs, 30);
+    ASSERT_TRUE(truncated);
+}
+
+TEST(TSampleHistoryTest, get_since)
+{
+    TSampleHistory h(4);
+    uint64_t       next = 0;
+    ASSERT_TRUE(h.GetSince(0, 100, next).empty());
+    ASSERT_EQ(next, 0);
+
+    // samples of a burst with equal timestamps are taken once each
+    h.Add(10, 1);
+    h.Add(10, 2);
+    h.Add(10, 3);
+    auto res = h.GetSince(next, 2, next);
+    ASSERT_EQ(res.size(), 2);
+    ASSERT_EQ(res[0].Value, 1);
+    ASSERT_EQ(res[1].Value, 2);
+    res = h.GetSince(next, 100, next);
+    ASSERT_EQ(res.size(), 1);
+    ASSERT_EQ(res[0].Value, 3);
+    ASSERT_EQ(next, 3);
+    ASSERT_TRUE(h.GetSince(next, 100, next).empty());
+
+    // overwritten samples are skipped
+    for (int i = 4; i <= 9; ++i) {
+        h.Add(20, i);
+    }
+    res = h.GetSince(next, 100, next);
+    ASSERT_EQ(res.size(), 4);
+    ASSERT_EQ(res[0].Value, 6);
+    ASSERT_EQ(res[3].Value, 9);
+    ASSERT_EQ(next, 9);
+}
+
+TEST(TSampleHistoryTest, concurrent_read)
+{
+    // values are equal to timestamps, so a torn or overwritten sample is detected
+    TSampleHistory h(64);
+    for (int32_t i = 1; i <= 64; ++i) {
+        h.Add(i, i);
+    }
+    std::thread writer([&] {
+        for (int32_t i = 65; i <= 20000; ++i) {
+            h.Add(i, i);
+        }
+    });
+    for (size_t n = 0; n < 200; ++n) {
+        // overwritten samples are dropped from the result, but newer ones are still in the range
+        bool truncated = false;
+        auto res       = h.Get(0, INT64_MAX, 32, &truncated);
+        ASSERT_TRUE(truncated);
+        ASSERT_LE(res.size(), 32);
+        for (size_t i = 0; i < res.size(); ++i) {
+            ASSERT_EQ(res[i].TimestampUs, res[i].Value);
+            if (i > 0) {
+                ASSERT_EQ(res[i].TimestampUs, res[i - 1].TimestampUs + 1);
+            }
+        }
+    }
+    writer.join();
+}
+
+TEST(TSampleHistoryTest, delta_encoding)
+{
+    ASSERT_TRUE(EncodeSampleDeltas({}).empty());
+
+    std::vector<TSampleHistory::TSample> samples{{1000, 0}, {1001, 1}, {1002, -1}};
+    // zigzag: 0 -> 0, 1 -> 2, -2 -> 3
+    ASSERT_EQ(EncodeSampleDeltas(samples), std::string("\x00\x00\x02\x02\x02\x03", 6));
+
+    std::mt19937                           gen(3);
+    std::uniform_int_distribution<int32_t> values(INT32_MIN, INT32_MAX);
+    std::uniform_int_distribution<int64_t> steps(0, 1000000000);
+    samples.clear();
+    int64_t ts = 1600000000000000;
+    for (size_t i = 0; i < 1000; ++i) {
+        ts += steps(gen);
+        samples.push_back({ts, values(gen)});
+    }
+    auto decoded = DecodeSampleDeltas(EncodeSampleDeltas(samples), samples.front().TimestampUs);
+    ASSERT_EQ(decoded.size(), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        ASSERT_EQ(decoded[i].TimestampUs, samples[i].TimestampUs);
+        ASSERT_EQ(decoded[i].Value, samples[i].Value);
+    }
+
+    ASSERT_THROW(DecodeSampleDeltas("\x80", 0), std::runtime_error);
+}
+
+TEST(TSampleHistoryTest, base64)
+{
+    ASSERT_EQ(EncodeBase64(""), "");
+    ASSERT_EQ(EncodeBase64("f"), "Zg==");
+    ASSERT_EQ(EncodeBase64("fo"), "Zm8=");
+    ASSERT_EQ(EncodeBase64("foo"), "Zm9v");
+    ASSERT_EQ(EncodeBase64("foobar"), "Zm9vYmFy");
+    ASSERT_EQ(EncodeBase64(std::string("\xff\x00\xfe", 3)), "/wD+");
+
+    for (const std::string s : {"", "f", "fo", "foo", "foob", "fooba", "foobar"}) {
+        ASSERT_EQ(DecodeBase64(EncodeBase64(s)), s);
+    }
+    ASSERT_THROW(DecodeBase64("Zg="), std::runtime_error);
+    ASSERT_THROW(DecodeBase64("Z=g="), std::runtime_error);
+    ASSERT_THROW(DecodeBase64("Zg.="), std::runtime_error);
+}
+
+TEST(TSampleHistoryTest, rpc)
+{
+    std::shared_ptr<TSampleHistory> history(new TSampleHistory(100));
+    for (int i = 0; i < 10; ++i) {
+        history->Add(1000 + i * 100, 2000 + i);
+    }
+    THistoryRpcHandler handler;
+    ASSERT_TRUE(handler.IsEmpty());
+    handler.AddChannel("A1", history, 0.5);
+    ASSERT_FALSE(handler.IsEmpty());
+
+    Json::Value request;
+    ASSERT_THROW(handler.GetHistory(request), std::runtime_error);
+    request["channel"] = "A2";
+    ASSERT_THROW(handler.GetHistory(request), std::runtime_error);
+
+    request["channel"]     = "A1";
+    request["from_us"]     = 1150;
+    request["max_samples"] = 3;
+    auto res               = handler.GetHistory(request);
+    ASSERT_EQ(res["channel"].asString(), "A1");
+    ASSERT_EQ(res["count"].asUInt(), 3);
+    ASSERT_EQ(res["first_timestamp_us"].asInt64(), 1200);
+    ASSERT_EQ(res["raw_to_v"].asDouble(), 0.5);
+    ASSERT_TRUE(res["has_more"].asBool());
+    auto samples = DecodeSampleDeltas(DecodeBase64(res["data"].asString()), res["first_timestamp_us"].asInt64());
+    ASSERT_EQ(samples.size(), 3);
+    ASSERT_EQ(samples[2].TimestampUs, 1400);
+    ASSERT_EQ(samples[2].Value, 2004);
+
+    request["from_us"] = 1401;
+    request["to_us"]   = 1600;
+    res                = handler.GetHistory(request);
+    ASSERT_EQ(res["count"].asUInt(), 2);
+    ASSERT_FALSE(res["has_more"].asBool());
+}
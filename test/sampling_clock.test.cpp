@@ -0,0 +1,71 @@
+#include "src/sampling_clock.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace std::chrono;
+
+TEST(TSamplingClockTest, no_drift)
+{
+    TSamplingClock clock(milliseconds(10));
+    auto           start = TSamplingClock::TClock::now();
+    clock.Start();
+    for (int i = 0; i < 10; ++i) {
+        // work done between waits doesn't shift the next deadline
+        std::this_thread::sleep_for(milliseconds(4));
+        ASSERT_TRUE(clock.WaitNext(nullptr));
+        ASSERT_GE(TSamplingClock::TClock::now(), clock.GetDeadline());
+    }
+    auto duration = TSamplingClock::TClock::now() - start;
+    ASSERT_GE(duration, milliseconds(100));
+    ASSERT_LT(duration, milliseconds(130));
+    ASSERT_GE(clock.GetDeadline(), start + milliseconds(100));
+    ASSERT_LT(clock.GetDeadline(), start + milliseconds(101));
+    ASSERT_EQ(clock.GetMissedCount(), 0);
+}
+
+TEST(TSamplingClockTest, missed_deadlines)
+{
+    TSamplingClock    clock(milliseconds(5));
+    TLatencyHistogram jitter;
+    clock.SetJitterHistogram(&jitter);
+    clock.Start();
+
+    // a late reading is followed by the next one without waiting
+    std::this_thread::sleep_for(milliseconds(7));
+    auto deadline = clock.GetDeadline();
+    ASSERT_TRUE(clock.WaitNext(nullptr));
+    ASSERT_EQ(clock.GetDeadline(), deadline + milliseconds(5));
+    ASSERT_EQ(clock.GetMissedCount(), 0);
+
+    // the schedule restarts after a stall longer than the period instead of catching up
+    std::this_thread::sleep_for(milliseconds(30));
+    auto stallEnd = TSamplingClock::TClock::now();
+    ASSERT_TRUE(clock.WaitNext(nullptr));
+    ASSERT_GE(clock.GetDeadline(), stallEnd);
+    ASSERT_EQ(clock.GetMissedCount(), 1);
+
+    auto snapshot = jitter.GetSnapshot();
+    ASSERT_EQ(snapshot.GetCount(), 2);
+    ASSERT_GE(snapshot.GetPercentile(1), 20000000);
+}
+
+TEST(TSamplingClockTest, stop_event)
+{
+    TStopEvent     stopEvent;
+    TSamplingClock clock(milliseconds(5));
+    clock.Start();
+    ASSERT_TRUE(clock.WaitNext(&stopEvent));
+    ASSERT_GE(TSamplingClock::TClock::now(), clock.GetDeadline());
+
+    TSamplingClock longClock(seconds(10));
+    longClock.Start();
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        stopEvent.Set();
+    });
+    auto start = TSamplingClock::TClock::now();
+    ASSERT_FALSE(longClock.WaitNext(&stopEvent));
+    ASSERT_LT(TSamplingClock::TClock::now() - start, milliseconds(500));
+    stopper.join();
+}
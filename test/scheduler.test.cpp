@@ -0,0 +1,125 @@
+#include "src/scheduler.h"
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+
+using namespace std::chrono;
+
+TEST(TSchedulerTest, no_tasks)
+{
+    TScheduler scheduler;
+    size_t     id;
+    auto       start = steady_clock::now();
+    ASSERT_FALSE(scheduler.WaitNext(id, milliseconds(20)));
+    ASSERT_GE(steady_clock::now() - start, milliseconds(20));
+}
+
+TEST(TSchedulerTest, periods)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(10));
+    scheduler.AddTask(2, milliseconds(50));
+
+    std::map<size_t, size_t> runs;
+    auto                     start = steady_clock::now();
+    size_t                   id;
+    while (steady_clock::now() - start < milliseconds(195)) {
+        if (scheduler.WaitNext(id, milliseconds(100))) {
+            ++runs[id];
+        }
+    }
+    ASSERT_EQ(runs.size(), 2);
+    ASSERT_NEAR(runs[1], 20, 2);
+    ASSERT_NEAR(runs[2], 4, 1);
+    ASSERT_EQ(scheduler.GetStatistics().Runs, runs[1] + runs[2]);
+}
+
+TEST(TSchedulerTest, earliest_first)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(1000));
+    scheduler.AddTask(2, milliseconds(10));
+
+    size_t id;
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(id, 1);
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(id, 2);
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(id, 2);
+
+    // task 1 is due after 1 second
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(id, 2);
+}
+
+TEST(TSchedulerTest, max_wait)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(1000));
+
+    size_t id;
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(10)));
+    auto start = steady_clock::now();
+    ASSERT_FALSE(scheduler.WaitNext(id, milliseconds(10)));
+    ASSERT_LT(steady_clock::now() - start, milliseconds(500));
+}
+
+TEST(TSchedulerTest, missed_deadlines)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(10));
+
+    size_t id;
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(scheduler.GetStatistics().MissedDeadlines, 0);
+
+    // the task runs too long and misses 3 periods
+    std::this_thread::sleep_for(milliseconds(45));
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    const auto& stats = scheduler.GetStatistics();
+    ASSERT_EQ(stats.MissedDeadlines, 3);
+    ASSERT_GE(stats.MaxLateness, milliseconds(30));
+    ASSERT_EQ(stats.Runs, 2);
+
+    // next run is not earlier than the next period boundary
+    auto start = steady_clock::now();
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_LT(steady_clock::now() - start, milliseconds(10));
+    ASSERT_EQ(scheduler.GetStatistics().MissedDeadlines, 3);
+}
+
+TEST(TSchedulerTest, continuous)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(0));
+
+    size_t id;
+    auto   start = steady_clock::now();
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    }
+    ASSERT_LT(steady_clock::now() - start, milliseconds(50));
+    ASSERT_EQ(scheduler.GetStatistics().MissedDeadlines, 0);
+}
+
+TEST(TSchedulerTest, postpone)
+{
+    TScheduler scheduler;
+    scheduler.AddTask(1, milliseconds(0));
+    scheduler.AddTask(2, milliseconds(0));
+
+    size_t id;
+    scheduler.Postpone(1, steady_clock::now() + milliseconds(50));
+    // the postponed task doesn't run before the time
+    for (size_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+        ASSERT_EQ(id, 2);
+    }
+
+    // earlier time doesn't change the deadline
+    scheduler.Postpone(1, steady_clock::now());
+    ASSERT_TRUE(scheduler.WaitNext(id, milliseconds(100)));
+    ASSERT_EQ(id, 2);
+}
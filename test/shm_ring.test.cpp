@@ -0,0 +1,122 @@
+#include "src/shm_ring.h"
+#include "src/shm_ring_writer.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    //! Unique id, so parallel test runs don't share objects
+    std::string GetTestChannelId(const std::string& name)
+    {
+        return "test-" + name + "-" + std::to_string(getpid());
+    }
+
+    //! All fields are derived from the index, so a torn read gives inconsistent fields
+    TShmSample MakeSample(uint64_t index)
+    {
+        return TShmSample{static_cast<int64_t>(index) * 1000, static_cast<int32_t>(index), index * 0.5};
+    }
+} // namespace
+
+TEST(TShmRingTest, read_write)
+{
+    std::string id(GetTestChannelId("rw"));
+    ASSERT_THROW(TShmRingReader reader(id), std::runtime_error);
+    {
+        TShmRingWriter writer(id, 5);
+        ASSERT_EQ(writer.GetSlotCount(), 8);
+
+        TShmRingReader reader(id);
+        ASSERT_EQ(reader.GetSlotCount(), 8);
+        ASSERT_TRUE(reader.IsWriterActive());
+        ASSERT_EQ(reader.GetWriteIndex(), 0);
+
+        uint64_t   pos = 0;
+        TShmSample buf[16];
+        ASSERT_EQ(reader.Read(pos, buf, 16), 0);
+
+        for (uint64_t i = 0; i < 5; ++i) {
+            auto s = MakeSample(i);
+            writer.Write(s.TimestampUs, s.Raw, s.Value);
+        }
+        ASSERT_EQ(reader.Read(pos, buf, 3), 3);
+        ASSERT_EQ(pos, 3);
+        ASSERT_EQ(buf[2].Raw, 2);
+        ASSERT_EQ(buf[2].TimestampUs, 2000);
+        ASSERT_EQ(buf[2].Value, 1.0);
+
+        // overwritten samples are skipped and counted
+        for (uint64_t i = 5; i < 20; ++i) {
+            auto s = MakeSample(i);
+            writer.Write(s.TimestampUs, s.Raw, s.Value);
+        }
+        uint64_t lost = 0;
+        ASSERT_EQ(reader.Read(pos, buf, 16, &lost), 8);
+        ASSERT_EQ(lost, 9);
+        ASSERT_EQ(buf[0].Raw, 12);
+        ASSERT_EQ(pos, 20);
+
+        // restarted writer resets the ring
+        TShmRingWriter restarted(id, 8);
+        ASSERT_TRUE(reader.IsWriterActive());
+        auto s = MakeSample(100);
+        restarted.Write(s.TimestampUs, s.Raw, s.Value);
+        ASSERT_EQ(reader.Read(pos, buf, 16), 1);
+        ASSERT_EQ(buf[0].Raw, 100);
+    }
+    // the object is removed by the writer
+    ASSERT_THROW(TShmRingReader reader(id), std::runtime_error);
+}
+
+TEST(TShmRingTest, concurrent_readers)
+{
+    const uint64_t SAMPLES = 50000;
+    const size_t   READERS = 3;
+
+    std::string    id(GetTestChannelId("concurrent"));
+    TShmRingWriter writer(id, 64);
+
+    std::vector<std::thread> readers;
+    std::vector<uint64_t>    received(READERS, 0);
+    std::vector<uint64_t>    lost(READERS, 0);
+    std::vector<int>         failed(READERS, 0);
+    for (size_t r = 0; r < READERS; ++r) {
+        readers.emplace_back([&, r] {
+            TShmRingReader reader(id);
+            uint64_t       pos = 0;
+            TShmSample     buf[16];
+            while (pos < SAMPLES) {
+                uint64_t prev = pos;
+                size_t   n    = reader.Read(pos, buf, 16, &lost[r]);
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t index = pos - n + i;
+                    auto     s     = MakeSample(index);
+                    if (index < prev || buf[i].TimestampUs != s.TimestampUs || buf[i].Raw != s.Raw ||
+                        buf[i].Value != s.Value)
+                    {
+                        failed[r] = 1;
+                        return;
+                    }
+                }
+                received[r] += n;
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (uint64_t i = 0; i < SAMPLES; ++i) {
+        auto s = MakeSample(i);
+        writer.Write(s.TimestampUs, s.Raw, s.Value);
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (size_t r = 0; r < READERS; ++r) {
+        EXPECT_FALSE(failed[r]) << "reader " << r;
+        EXPECT_EQ(received[r] + lost[r], SAMPLES) << "reader " << r;
+    }
+}
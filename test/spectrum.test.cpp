@@ -0,0 +1,89 @@
+#include "src/spectrum.h"
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+namespace
+{
+    TSpectrumSettings MakeSettings(uint32_t fftSize)
+    {
+        TSpectrumSettings settings;
+        settings.FftSize = fftSize;
+        settings.Bands   = {{"low", 40, 60}, {"high", 100, 150}, {"empty", 300, 400}};
+        return settings;
+    }
+}
+
+TEST(TSpectrumTest, fft_matches_dft)
+{
+    const size_t        n = 64;
+    std::vector<double> input(n);
+    for (size_t i = 0; i < n; ++i) {
+        input[i] = sin(i * 0.7) + 0.3 * cos(i * 2.1) + ((i * 37) % 11) * 0.05;
+    }
+    TRealFft            fft(n);
+    std::vector<double> power(n / 2 + 1);
+    fft.GetPowerSpectrum(input.data(), power.data());
+
+    for (size_t k = 0; k <= n / 2; ++k) {
+        double re = 0;
+        double im = 0;
+        for (size_t i = 0; i < n; ++i) {
+            re += input[i] * cos(2 * M_PI * k * i / n);
+            im -= input[i] * sin(2 * M_PI * k * i / n);
+        }
+        ASSERT_NEAR(power[k], re * re + im * im, 1e-9) << "bin " << k;
+    }
+}
+
+TEST(TSpectrumTest, bad_size)
+{
+    ASSERT_THROW(TRealFft(0), std::runtime_error);
+    ASSERT_THROW(TRealFft(2), std::runtime_error);
+    ASSERT_THROW(TRealFft(100), std::runtime_error);
+}
+
+TEST(TSpectrumTest, bands_and_dominant_frequency)
+{
+    TSpectrumAnalyzer analyzer(MakeSettings(1024));
+
+    // 1 kHz sampling, 50 Hz with amplitude 2, 123.4 Hz with amplitude 0.5 and DC offset
+    for (int64_t i = 0; i < 1500; ++i) {
+        double t = i * 1e-3;
+        analyzer.Add(i * 1000, 10 + 2 * sin(2 * M_PI * 50 * t) + 0.5 * sin(2 * M_PI * 123.4 * t + 1));
+        ASSERT_EQ(analyzer.IsReady(), i >= 1023);
+    }
+    const auto& res = analyzer.Compute();
+    ASSERT_NEAR(res.SampleRate, 1000, 1e-6);
+    ASSERT_NEAR(res.DominantFrequency, 50, 0.1);
+    ASSERT_NEAR(res.BandRms[0], 2 / sqrt(2), 0.02);
+    ASSERT_NEAR(res.BandRms[1], 0.5 / sqrt(2), 0.01);
+    ASSERT_NEAR(res.BandRms[2], 0, 0.001);
+
+    // timestamps of samples read in bursts don't reflect the sample rate, so it can be set
+    auto settings       = MakeSettings(1024);
+    settings.SampleRate = 1000;
+    TSpectrumAnalyzer fixedRateAnalyzer(settings);
+    for (int64_t i = 0; i < 1024; ++i) {
+        fixedRateAnalyzer.Add((i / 64) * 64000, 2 * sin(2 * M_PI * 50 * i * 1e-3));
+    }
+    ASSERT_NEAR(fixedRateAnalyzer.Compute().DominantFrequency, 50, 0.1);
+}
+
+TEST(TSpectrumTest, settings)
+{
+    CheckSpectrumSettings(MakeSettings(256));
+    ASSERT_THROW(CheckSpectrumSettings(MakeSettings(300)), std::runtime_error);
+
+    auto settings = MakeSettings(256);
+    settings.Bands.push_back({"low", 1, 2});
+    ASSERT_THROW(CheckSpectrumSettings(settings), std::runtime_error);
+
+    settings = MakeSettings(256);
+    settings.Bands.push_back({"reversed", 20, 10});
+    ASSERT_THROW(CheckSpectrumSettings(settings), std::runtime_error);
+
+    settings = MakeSettings(256);
+    settings.Bands.push_back({"dominant_frequency", 1, 2});
+    ASSERT_THROW(CheckSpectrumSettings(settings), std::runtime_error);
+}
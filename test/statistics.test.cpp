@@ -0,0 +1,144 @@
+#include "src/statistics.h"
+#include <gtest/gtest.h>
+
+#include <map>
+
+using namespace std::chrono;
+
+namespace
+{
+    std::map<std::string, std::string> ToMap(const std::vector<TStatisticsCollector::TControlValue>& values)
+    {
+        return std::map<std::string, std::string>(values.begin(), values.end());
+    }
+} // namespace
+
+TEST(TStatisticsTest, buckets)
+{
+    // every value is not bigger than upper bound of its bucket and bigger than the bound of the previous one
+    for (uint64_t v = 0; v < 100000; v += 1 + v / 64) {
+        size_t i = TLatencyHistogram::GetBucketIndex(v);
+        ASSERT_LT(i, TLatencyHistogram::GetBucketCount());
+        ASSERT_LE(v, TLatencyHistogram::GetBucketUpperBound(i)) << v;
+        if (i > 0) {
+            ASSERT_GT(v, TLatencyHistogram::GetBucketUpperBound(i - 1)) << v;
+        }
+        // relative error is less than 1/16
+        ASSERT_LE(TLatencyHistogram::GetBucketUpperBound(i) - v, v / 16) << v;
+    }
+    // too big values are counted in the last bucket
+    ASSERT_EQ(TLatencyHistogram::GetBucketIndex(UINT64_MAX), TLatencyHistogram::GetBucketCount() - 1);
+}
+
+TEST(TStatisticsTest, percentiles)
+{
+    TLatencyHistogram h;
+    ASSERT_EQ(h.GetSnapshot().GetPercentile(0.5), 0);
+
+    for (int i = 1; i <= 100; ++i) {
+        h.Record(microseconds(i));
+    }
+    auto s = h.GetSnapshot();
+    ASSERT_EQ(s.GetCount(), 100);
+    EXPECT_NEAR(s.GetPercentile(0.5), 50000, 50000 / 16);
+    EXPECT_NEAR(s.GetPercentile(0.99), 99000, 99000 / 16);
+    EXPECT_NEAR(s.GetPercentile(1), 100000, 100000 / 16);
+
+    // the difference contains only new values
+    for (int i = 0; i < 10; ++i) {
+        h.Record(milliseconds(5));
+    }
+    auto d = h.GetSnapshot() - s;
+    ASSERT_EQ(d.GetCount(), 10);
+    EXPECT_NEAR(d.GetPercentile(0.5), 5000000, 5000000 / 16);
+}
+
+TEST(TStatisticsTest, collect)
+{
+    auto                 readStats = std::make_shared<TReadStatistics>();
+    auto                 cycle     = std::make_shared<TLatencyHistogram>();
+    size_t               depth     = 3;
+    TStatisticsCollector collector;
+    collector.AddChannel("A1", readStats);
+    collector.AddCycle("iio:device0", cycle);
+    collector.SetQueueDepthSource([&] { return depth; });
+
+    std::vector<std::string> ids{"A1_read_p50_us",
+                                 "A1_read_p99_us",
+                                 "A1_samples_per_s",
+                                 "A1_errors",
+                                 "A1_retries",
+                                 "iio:device0_cycle_p50_us",
+                                 "iio:device0_cycle_p99_us",
+                                 "iio:device0_cycles_per_s",
+                                 "publish_queue_depth"};
+    ASSERT_EQ(collector.GetControlIds(), ids);
+
+    auto start  = TStatisticsCollector::TClock::now();
+    auto values = collector.Collect(start);
+    ASSERT_EQ(values.size(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT_EQ(values[i].first, ids[i]);
+    }
+    // rates are unknown before the first interval
+    ASSERT_EQ(ToMap(values)["A1_samples_per_s"], "0.0");
+
+    for (int i = 0; i < 20; ++i) {
+        readStats->ReadLatency.Record(microseconds(100));
+        ++readStats->Samples;
+    }
+    readStats->Errors += 2;
+    readStats->Retries += 5;
+    for (int i = 0; i < 4; ++i) {
+        cycle->Record(milliseconds(1));
+    }
+    depth = 7;
+
+    auto v = ToMap(collector.Collect(start + seconds(2)));
+    // upper bound of the bucket containing 100000 nS
+    EXPECT_EQ(v["A1_read_p50_us"], "102.4");
+    EXPECT_EQ(v["A1_samples_per_s"], "10.0");
+    EXPECT_EQ(v["A1_errors"], "2");
+    EXPECT_EQ(v["A1_retries"], "5");
+    EXPECT_EQ(v["iio:device0_cycles_per_s"], "2.0");
+    EXPECT_EQ(v["publish_queue_depth"], "7");
+
+    // percentiles and rates are calculated for the last interval only, counters are totals
+    v = ToMap(collector.Collect(start + seconds(3)));
+    EXPECT_EQ(v["A1_read_p50_us"], "0.0");
+    EXPECT_EQ(v["A1_samples_per_s"], "0.0");
+    EXPECT_EQ(v["A1_errors"], "2");
+}
+
+TEST(TStatisticsTest, jitter)
+{
+    auto                 readStats = std::make_shared<TReadStatistics>();
+    TStatisticsCollector collector;
+    collector.AddChannel("A1", readStats, true);
+
+    std::vector<std::string> ids{"A1_read_p50_us",
+                                 "A1_read_p99_us",
+                                 "A1_samples_per_s",
+                                 "A1_errors",
+                                 "A1_retries",
+                                 "A1_jitter_p50_us",
+                                 "A1_jitter_p99_us"};
+    ASSERT_EQ(collector.GetControlIds(), ids);
+
+    auto start = TStatisticsCollector::TClock::now();
+    collector.Collect(start);
+    for (int i = 0; i < 99; ++i) {
+        readStats->SamplingJitter.Record(microseconds(50));
+    }
+    readStats->SamplingJitter.Record(milliseconds(2));
+
+    auto v = ToMap(collector.Collect(start + seconds(1)));
+    // upper bound of the bucket containing 50000 nS, the only long delay is above 99th percentile
+    EXPECT_EQ(v["A1_jitter_p50_us"], "51.2");
+    EXPECT_EQ(v["A1_jitter_p99_us"], "51.2");
+
+    // percentiles are calculated for the last interval only
+    readStats->SamplingJitter.Record(milliseconds(2));
+    v = ToMap(collector.Collect(start + seconds(2)));
+    EXPECT_EQ(v["A1_jitter_p99_us"], "2031.6");
+}
@@ -0,0 +1,215 @@
+#include "src/iio_buffer.h"
+#include "src/scheduler.h"
+#include "src/stop_event.h"
+#include "src/sysfs_adc.h"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+namespace
+{
+    // waits in tests are much longer, so any result below the limit means the wait is interrupted
+    const milliseconds LONG_WAIT(10000);
+    const milliseconds STOP_DELAY(20);
+
+    //! Valgrind slows the tests down, so the limit is multiplied by STOP_LATENCY_SCALE environment variable
+    milliseconds GetMaxStopLatency()
+    {
+        const milliseconds limit(10);
+        char*              scale = getenv("STOP_LATENCY_SCALE");
+        return (scale != NULL) ? limit * std::max(1, atoi(scale)) : limit;
+    }
+
+    const milliseconds MAX_STOP_LATENCY = GetMaxStopLatency();
+
+    //! Set the event after STOP_DELAY, run fn and return time from setting the event to fn's return
+    template<class Fn> steady_clock::duration MeasureStopLatency(TStopEvent& stopEvent, Fn fn)
+    {
+        steady_clock::time_point setTime;
+        std::thread              stopper([&] {
+            std::this_thread::sleep_for(STOP_DELAY);
+            setTime = steady_clock::now();
+            stopEvent.Set();
+        });
+        fn();
+        auto end = steady_clock::now();
+        stopper.join();
+        return end - setTime;
+    }
+} // namespace
+
+class TStopEventTest : public testing::Test
+{
+protected:
+    std::string testRootDir;
+
+    void SetUp()
+    {
+        char* d = getenv("TEST_DIR_ABS");
+        if (d != NULL) {
+            testRootDir = d;
+            testRootDir += '/';
+        }
+    }
+};
+
+TEST_F(TStopEventTest, wait_for)
+{
+    TStopEvent stopEvent;
+    ASSERT_FALSE(stopEvent.IsSet());
+    ASSERT_TRUE(stopEvent.WaitFor(milliseconds(1)));
+    ASSERT_TRUE(WaitFor(nullptr, milliseconds(1)));
+
+    auto latency = MeasureStopLatency(stopEvent, [&] { ASSERT_FALSE(stopEvent.WaitFor(LONG_WAIT)); });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+    ASSERT_TRUE(stopEvent.IsSet());
+
+    // the event stays set
+    ASSERT_FALSE(stopEvent.WaitFor(LONG_WAIT));
+    ASSERT_FALSE(WaitFor(&stopEvent, LONG_WAIT));
+}
+
+TEST_F(TStopEventTest, reset)
+{
+    TStopEvent stopEvent;
+    stopEvent.Set();
+    stopEvent.Reset();
+    ASSERT_FALSE(stopEvent.IsSet());
+    ASSERT_TRUE(stopEvent.WaitFor(milliseconds(1)));
+
+    auto latency = MeasureStopLatency(stopEvent, [&] { ASSERT_FALSE(stopEvent.WaitFor(LONG_WAIT)); });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+}
+
+TEST_F(TStopEventTest, wait_readable)
+{
+    TStopEvent stopEvent;
+    int        fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    ASSERT_FALSE(stopEvent.WaitReadable(fds[0], milliseconds(1)));
+    ASSERT_EQ(write(fds[1], "1", 1), 1);
+    ASSERT_TRUE(stopEvent.WaitReadable(fds[0], milliseconds(1)));
+    char c;
+    ASSERT_EQ(read(fds[0], &c, 1), 1);
+
+    auto latency = MeasureStopLatency(stopEvent, [&] {
+        ASSERT_FALSE(stopEvent.WaitReadable(fds[0], microseconds(-1)));
+    });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_F(TStopEventTest, channel_reader)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage1", 1000, 10000, 2.54, 10.5, 1, 5};
+    TStopEvent                stopEvent;
+    TChannelReader            reader(2.54,
+                          3100,
+                          channelCfg,
+                          LONG_WAIT.count(),
+                          logger,
+                          logger,
+                          testRootDir + "sysfs_test_data",
+                          &stopEvent);
+
+    auto latency = MeasureStopLatency(stopEvent, [&] { reader.Measure(); });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+}
+
+TEST_F(TStopEventTest, scheduler)
+{
+    TStopEvent stopEvent;
+    TScheduler scheduler(&stopEvent);
+    scheduler.AddTask(1, LONG_WAIT);
+    size_t id;
+    ASSERT_TRUE(scheduler.WaitNext(id, LONG_WAIT));
+
+    auto latency = MeasureStopLatency(stopEvent, [&] { ASSERT_FALSE(scheduler.WaitNext(id, LONG_WAIT)); });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+}
+
+TEST_F(TStopEventTest, channel_readers)
+{
+    // every reader waits for its own long delay, one event stops all of them
+    WBMQTT::TLogger                              logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings                    channelCfg{"voltage1", 1000, 10000, 2.54, 10.5, 1, 5};
+    TStopEvent                                   stopEvent;
+    std::vector<std::unique_ptr<TChannelReader>> readers;
+    for (int i = 0; i < 8; ++i) {
+        readers.emplace_back(new TChannelReader(2.54,
+                                                3100,
+                                                channelCfg,
+                                                LONG_WAIT.count() * (i + 1),
+                                                logger,
+                                                logger,
+                                                testRootDir + "sysfs_test_data",
+                                                &stopEvent));
+    }
+
+    auto latency = MeasureStopLatency(stopEvent, [&] {
+        std::vector<std::thread> threads;
+        for (auto& reader : readers) {
+            threads.emplace_back([&] { reader->Measure(); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+}
+
+TEST_F(TStopEventTest, scheduler_many_tasks)
+{
+    TStopEvent stopEvent;
+    TScheduler scheduler(&stopEvent);
+    const size_t TASK_COUNT = 100;
+    for (size_t i = 0; i < TASK_COUNT; ++i) {
+        scheduler.AddTask(i, LONG_WAIT + milliseconds(i));
+    }
+    // the first runs are due immediately
+    size_t id;
+    for (size_t i = 0; i < TASK_COUNT; ++i) {
+        ASSERT_TRUE(scheduler.WaitNext(id, LONG_WAIT));
+    }
+
+    auto latency = MeasureStopLatency(stopEvent, [&] { ASSERT_FALSE(scheduler.WaitNext(id, LONG_WAIT)); });
+    ASSERT_LT(latency, MAX_STOP_LATENCY);
+}
+
+TEST_F(TStopEventTest, iio_buffer)
+{
+    std::string dataDir(testRootDir + "iio_buffer_test_data");
+    std::string fifoName(dataDir + "/stop.fifo");
+    unlink(fifoName.c_str());
+    ASSERT_EQ(mkfifo(fifoName.c_str(), 0600), 0);
+
+    // keep the writer end open, so the reader gets no EOF
+    int writeFd = open(fifoName.c_str(), O_RDWR);
+    ASSERT_GE(writeFd, 0);
+
+    TStopEvent stopEvent;
+    {
+        TIIOBuffer           buf(dataDir, fifoName, {"voltage0", "voltage1"}, 16, &stopEvent);
+        std::vector<int32_t> values;
+        auto                 latency = MeasureStopLatency(stopEvent, [&] {
+            ASSERT_FALSE(buf.ReadScan(values, LONG_WAIT.count()));
+        });
+        ASSERT_LT(latency, MAX_STOP_LATENCY);
+    }
+
+    close(writeFd);
+    unlink(fifoName.c_str());
+
+    // restore test data
+    TIIOBuffer buf(dataDir, dataDir + "/scans.bin", {"voltage0", "voltage1"}, 16);
+}
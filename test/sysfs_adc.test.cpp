@@ -1,5 +1,8 @@
 #include "src/sysfs_adc.h"
 #include <gtest/gtest.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 class TSysfsTest : public testing::Test
@@ -34,6 +37,155 @@ TEST_F(TSysfsTest, read_value)
     TChannelReader::TSettings channelCfg{"voltage1", 1, 10000, 2.54, 10.5, 1, 5};
     const double              MAX_SCALE = 2.54;
     TChannelReader            reader(MAX_SCALE, 3100, channelCfg, 10, logger, logger, testRootDir);
-    reader.Measure();
+    ASSERT_EQ(reader.Measure(), TMeasureStatus::Ok);
     ASSERT_EQ(reader.GetValue(), "6.77418");
 }
+
+TEST_F(TSysfsTest, measure_errors)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage2", 1, 10000, 2.54, 10.5, 1, 5};
+
+    // there is no in_voltage2_raw
+    TChannelReader missingReader(2.54, 3100, channelCfg, 10, logger, logger, testRootDir);
+    auto           stats = std::make_shared<TReadStatistics>();
+    missingReader.SetStatistics(stats);
+    ASSERT_EQ(missingReader.Measure(), TMeasureStatus::ReadError);
+    ASSERT_EQ(missingReader.GetLastError(), "Can't read from " + testRootDir + "/in_voltage2_raw");
+
+    // the last of 3 attempts isn't followed by a retry
+    ASSERT_EQ(stats->Retries, 2);
+    ASSERT_EQ(stats->Errors, 1);
+
+    channelCfg.ChannelNumber  = "voltage1";
+    channelCfg.AveragingWindow = 2;
+    TChannelReader reader(2.54, 3100, channelCfg, 10, logger, logger, testRootDir);
+    reader.AddSample(100);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::NotReady);
+    reader.AddSample(10000);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::Overflow);
+    ASSERT_FALSE(reader.GetLastError().empty());
+}
+
+TEST_F(TSysfsTest, fractional_bits)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage1", 1, 10000, 2.54, 1, 2, 5};
+
+    // average of 100 and 101 is rounded to 101
+    TChannelReader reader(2.54, 3100, channelCfg, 10, logger, logger, testRootDir);
+    reader.AddSample(100);
+    reader.AddSample(101);
+    reader.ConvertValue();
+    ASSERT_EQ(reader.GetValue(), "0.25654");
+
+    // one fractional bit keeps 100.5
+    channelCfg.FractionalBits = 1;
+    TChannelReader fixedPointReader(2.54, 3100, channelCfg, 10, logger, logger, testRootDir);
+    fixedPointReader.AddSample(100);
+    fixedPointReader.AddSample(101);
+    fixedPointReader.ConvertValue();
+    ASSERT_EQ(fixedPointReader.GetValue(), "0.25527");
+}
+
+TEST_F(TSysfsTest, iio_device_index)
+{
+    std::string devicesDir(testRootDir + "/iio_devices.tmp");
+    mkdir(devicesDir.c_str(), 0755);
+    ASSERT_EQ(symlink("../../devices/platform/soc/2000000.adc/iio:device0", (devicesDir + "/iio:device0").c_str()), 0);
+    ASSERT_EQ(symlink("../../devices/platform/i2c/1-0048/iio:device1", (devicesDir + "/iio:device1").c_str()), 0);
+
+    TIIODeviceIndex index(devicesDir);
+    ASSERT_EQ(index.GetDeviceCount(), 0);
+    ASSERT_EQ(index.Find(""), devicesDir + "/iio:device0");
+    ASSERT_EQ(index.Find("1-0048"), devicesDir + "/iio:device1");
+    ASSERT_EQ(index.GetDeviceCount(), 2);
+    ASSERT_EQ(index.Find("2000000.adc"), devicesDir + "/iio:device0");
+    ASSERT_EQ(index.Find("1-004?"), devicesDir + "/iio:device1");
+    ASSERT_EQ(index.Find("spi"), std::string());
+
+    // the folder is scanned once
+    unlink((devicesDir + "/iio:device1").c_str());
+    ASSERT_EQ(index.Find("1-0048"), devicesDir + "/iio:device1");
+
+    unlink((devicesDir + "/iio:device0").c_str());
+    rmdir(devicesDir.c_str());
+
+    TIIODeviceIndex noDir(devicesDir);
+    ASSERT_THROW(noDir.Find("adc"), TNoDirError);
+}
+
+TEST_F(TSysfsTest, shared_scale_files)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage1", 1, 10000, 2.54, 10.5, 1, 5};
+    TFileContentsCache        scaleFiles;
+
+    // in_voltage_scale is shared by channels, so it is read once
+    TChannelReader reader1(1, 3100, channelCfg, 10, logger, logger, testRootDir, nullptr, &scaleFiles);
+    size_t         readCount = scaleFiles.GetReadCount();
+    TChannelReader reader2(1, 3100, channelCfg, 10, logger, logger, testRootDir, nullptr, &scaleFiles);
+    ASSERT_EQ(scaleFiles.GetReadCount(), readCount);
+
+    reader1.Measure();
+    reader2.Measure();
+    ASSERT_EQ(reader1.GetValue(), "6.77418");
+    ASSERT_EQ(reader2.GetValue(), "6.77418");
+}
+
+TEST_F(TSysfsTest, ac_mode)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg;
+    channelCfg.AcMode            = true;
+    channelCfg.AcWindowMs        = 100;
+
+    // 50 Hz sine sampled at 1 kHz
+    TChannelReader reader(1, 3100, channelCfg, 10, logger, logger, testRootDir);
+    double         k = reader.GetRawValueMultiplier();
+    auto           addPeriods = [&](int64_t& t, int64_t endUs, double amplitude) {
+        for (; t < endUs; t += 1000) {
+            reader.AddSample(static_cast<int32_t>(round(1500 + amplitude * sin(2 * M_PI * 50 * t * 1e-6))),
+                             t,
+                             TChannelReader::TClock::time_point(std::chrono::microseconds(t)));
+        }
+    };
+    int64_t t = 0;
+    addPeriods(t, 200000, 1000);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::NotReady);
+    addPeriods(t, 210000, 1000);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::Ok);
+    ASSERT_NEAR(reader.GetNumericValue(), k * 1000 / sqrt(2), k * 3);
+    ASSERT_NEAR(reader.GetAcValue(TAcQuantity::PeakToPeak), k * 2000, k * 3);
+    ASSERT_NEAR(reader.GetAcValue(TAcQuantity::Dc), k * 1500, k);
+    ASSERT_NEAR(reader.GetAcValue(TAcQuantity::Frequency), 50, 0.05);
+    ASSERT_EQ(reader.GetAcText(TAcQuantity::Frequency), "50.00");
+    ASSERT_EQ(reader.GetMeasurementTime(), TChannelReader::TClock::time_point(std::chrono::microseconds(209000)));
+
+    // the result is converted once per window
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::NotReady);
+
+    // values above the maximum mean that the signal is clipped
+    addPeriods(t, 320000, 2000);
+    ASSERT_EQ(reader.ConvertValue(), TMeasureStatus::Overflow);
+    ASSERT_FALSE(reader.GetLastError().empty());
+}
+
+TEST_F(TSysfsTest, sampling_clock)
+{
+    WBMQTT::TLogger           logger("", WBMQTT::TLogger::StdErr, WBMQTT::TLogger::RED, false);
+    TChannelReader::TSettings channelCfg{"voltage1", 5, 10000, 2.54, 10.5, 1, 5};
+    TChannelReader            reader(2.54, 3100, channelCfg, 20, logger, logger, testRootDir);
+    auto                      stats = std::make_shared<TReadStatistics>();
+    reader.SetStatistics(stats);
+
+    auto start = TChannelReader::TClock::now();
+    ASSERT_EQ(reader.Measure(), TMeasureStatus::Ok);
+    auto end = TChannelReader::TClock::now();
+
+    // readings are taken every 20 mS from the start, the last one is followed by a delay too
+    ASSERT_GE(end - start, std::chrono::milliseconds(100));
+    ASSERT_GE(reader.GetMeasurementTime(), start + std::chrono::milliseconds(80));
+    ASSERT_LT(reader.GetMeasurementTime(), end - std::chrono::milliseconds(10));
+    ASSERT_EQ(stats->SamplingJitter.GetSnapshot().GetCount(), 5);
+}
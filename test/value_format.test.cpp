@@ -0,0 +1,90 @@
+#include "src/value_format.h"
+#include <gtest/gtest.h>
+
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    std::string Format(double value, uint32_t decimalPlaces)
+    {
+        char buf[64];
+        EXPECT_LT(FormatDecimal(value, decimalPlaces, buf, sizeof(buf)), sizeof(buf));
+        return buf;
+    }
+
+    std::string FormatWithStream(double value, uint32_t decimalPlaces)
+    {
+        std::ostringstream out;
+        out << std::setprecision(decimalPlaces) << std::fixed << value;
+        return out.str();
+    }
+} // namespace
+
+TEST(TValueFormatTest, simple)
+{
+    EXPECT_EQ(Format(0, 0), "0");
+    EXPECT_EQ(Format(0, 3), "0.000");
+    EXPECT_EQ(Format(1.5, 0), "2");
+    EXPECT_EQ(Format(12.3456, 2), "12.35");
+    EXPECT_EQ(Format(-12.3456, 2), "-12.35");
+    EXPECT_EQ(Format(0.001, 2), "0.00");
+    EXPECT_EQ(Format(-0.001, 2), "-0.00");
+    EXPECT_EQ(Format(9.999, 2), "10.00");
+    EXPECT_EQ(Format(6.774180, 5), "6.77418");
+}
+
+TEST(TValueFormatTest, ties)
+{
+    // exact binary halves are rounded to even like printf does
+    EXPECT_EQ(Format(0.125, 2), "0.12");
+    EXPECT_EQ(Format(0.375, 2), "0.38");
+    EXPECT_EQ(Format(2.5, 0), "2");
+    EXPECT_EQ(Format(-2.5, 0), "-2");
+    // 1.005 is 1.00499999999999989... in binary
+    EXPECT_EQ(Format(1.005, 2), "1.00");
+}
+
+TEST(TValueFormatTest, long_values)
+{
+    EXPECT_EQ(Format(1e20, 2), FormatWithStream(1e20, 2));
+    EXPECT_EQ(Format(0.1, 20), FormatWithStream(0.1, 20));
+    EXPECT_EQ(Format(12345.678, 17), FormatWithStream(12345.678, 17));
+
+    // truncated result
+    char buf[4];
+    EXPECT_EQ(FormatDecimal(123.456, 2, buf, sizeof(buf)), 6);
+    EXPECT_STREQ(buf, "123");
+    EXPECT_EQ(FormatDecimal(1e30, 2, buf, sizeof(buf)), FormatWithStream(1e30, 2).size());
+    EXPECT_STREQ(buf, "100");
+
+    std::string str;
+    FormatDecimal(0.1, 20, str);
+    EXPECT_EQ(str, FormatWithStream(0.1, 20));
+    FormatDecimal(1e70, 2, str);
+    EXPECT_EQ(str, FormatWithStream(1e70, 2));
+}
+
+TEST(TValueFormatTest, same_as_stream)
+{
+    // values like TChannelReader produces: raw * scale * multiplier / 1000
+    std::mt19937                            gen(1);
+    std::uniform_int_distribution<int32_t>  raw(-4096, 4096);
+    std::uniform_real_distribution<double>  multiplier(0.1, 20);
+    std::uniform_int_distribution<uint32_t> decimalPlaces(0, 10);
+    for (size_t i = 0; i < 20000; ++i) {
+        double   value = raw(gen) * 2.54 * multiplier(gen) / 1000.0;
+        uint32_t dp    = decimalPlaces(gen);
+        ASSERT_EQ(Format(value, dp), FormatWithStream(value, dp)) << value << " " << dp;
+    }
+    // values close to halves
+    for (int32_t i = -2000; i < 2000; ++i) {
+        for (uint32_t dp = 0; dp < 6; ++dp) {
+            double value = (i + 0.5) / std::pow(10, dp);
+            ASSERT_EQ(Format(value, dp), FormatWithStream(value, dp)) << value << " " << dp;
+            ASSERT_EQ(Format(std::nextafter(value, 0), dp), FormatWithStream(std::nextafter(value, 0), dp));
+            ASSERT_EQ(Format(std::nextafter(value, 1e9), dp), FormatWithStream(std::nextafter(value, 1e9), dp));
+        }
+    }
+}